@@ -0,0 +1,72 @@
+#pragma once
+
+// minimal benchmark harness - build with `make -f bench.mk`, run w/ `make -f bench.mk run BENCH="<filters>"`
+// - benchmarks are registered with BENCHMARK(name) { ... } and run in order of registration if name contains
+//  any filter given on command line (or all if none); options are passed as --name=value
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+
+struct BenchCase { const char* name; std::function<void()> fn; };
+std::vector<BenchCase>& benchRegistry();
+struct BenchRegistrar {
+  BenchRegistrar(const char* name, std::function<void()> fn) { benchRegistry().push_back({name, std::move(fn)}); }
+};
+
+#define BENCH_CAT2(a, b) a##b
+#define BENCH_CAT(a, b) BENCH_CAT2(a, b)
+#define BENCHMARK(name) static void BENCH_CAT(bench_, name)(); \
+  static BenchRegistrar BENCH_CAT(benchReg_, name)(#name, BENCH_CAT(bench_, name)); \
+  static void BENCH_CAT(bench_, name)()
+
+// command line options: benchOpt("sizes", "100000") for --sizes=...
+std::string benchOpt(const char* name, const char* dflt);
+std::vector<int64_t> benchOptList(const char* name, const char* dflt);
+// directory for generated data (env BENCH_TMPDIR or /tmp/ascend-bench); created if needed
+std::string benchTempDir();
+// current and peak resident set size
+int64_t benchRSSKB();
+int64_t benchPeakRSSKB();
+// reset peak RSS to current RSS (Linux 4.0+), to measure peak for a single operation
+void benchResetPeakRSS();
+// fail (nonzero exit status) if check is false, e.g. for latency or size budgets
+void benchCheck(bool ok, const char* what);
+
+inline int64_t benchTimeUs()
+{
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// latency samples in microseconds
+struct LatencyStats
+{
+  std::vector<int64_t> samples;
+
+  void add(int64_t us) { samples.push_back(us); }
+  template<typename F> void time(F&& fn) { int64_t t0 = benchTimeUs(); fn(); add(benchTimeUs() - t0); }
+  double mean() const  // ms
+  {
+    int64_t sum = 0;
+    for(int64_t us : samples) { sum += us; }
+    return samples.empty() ? 0 : sum/1000.0/samples.size();
+  }
+  // p in [0, 100]
+  double percentile(double p)
+  {
+    if(samples.empty()) { return 0; }
+    std::sort(samples.begin(), samples.end());
+    size_t idx = std::min(samples.size() - 1, size_t(p/100*samples.size()));
+    return samples[idx]/1000.0;  // ms
+  }
+  void report(const char* label)
+  {
+    printf("  %-32s n=%-6d p50 %8.3f ms  p95 %8.3f ms  p99 %8.3f ms  max %8.3f ms\n", label, int(samples.size()),
+        percentile(50), percentile(95), percentile(99), percentile(100));
+  }
+};
@@ -0,0 +1,109 @@
+#include "bench.h"
+#include <cstring>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::vector<std::string> benchArgs;
+static bool benchFailed = false;
+
+std::vector<BenchCase>& benchRegistry()
+{
+  static std::vector<BenchCase> registry;
+  return registry;
+}
+
+std::string benchOpt(const char* name, const char* dflt)
+{
+  std::string prefix = std::string("--") + name + "=";
+  for(const std::string& arg : benchArgs) {
+    if(arg.compare(0, prefix.size(), prefix) == 0)
+      return arg.substr(prefix.size());
+  }
+  return dflt;
+}
+
+// comma separated integers, with optional k or M suffix
+std::vector<int64_t> benchOptList(const char* name, const char* dflt)
+{
+  std::vector<int64_t> res;
+  std::string s = benchOpt(name, dflt);
+  for(const char* p = s.c_str(); *p;) {
+    char* end = NULL;
+    int64_t n = strtoll(p, &end, 10);
+    if(end == p) { break; }
+    if(*end == 'k') { n *= 1000; ++end; }
+    else if(*end == 'M') { n *= 1000000; ++end; }
+    res.push_back(n);
+    p = *end == ',' ? end + 1 : end;
+  }
+  return res;
+}
+
+std::string benchTempDir()
+{
+  const char* env = getenv("BENCH_TMPDIR");
+  std::string dir = env && env[0] ? env : "/tmp/ascend-bench";
+  mkdir(dir.c_str(), 0755);
+  return dir;
+}
+
+int64_t benchRSSKB()
+{
+  long pages = 0, resident = 0;
+  FILE* f = fopen("/proc/self/statm", "r");
+  if(!f) { return 0; }
+  if(fscanf(f, "%ld %ld", &pages, &resident) != 2) { resident = 0; }
+  fclose(f);
+  return int64_t(resident)*sysconf(_SC_PAGESIZE)/1024;
+}
+
+int64_t benchPeakRSSKB()
+{
+  char line[256];
+  int64_t kb = 0;
+  FILE* f = fopen("/proc/self/status", "r");
+  if(!f) { return 0; }
+  while(fgets(line, sizeof(line), f)) {
+    if(strncmp(line, "VmHWM:", 6) == 0) { kb = atoll(line + 6); break; }
+  }
+  fclose(f);
+  return kb;
+}
+
+void benchResetPeakRSS()
+{
+  FILE* f = fopen("/proc/self/clear_refs", "w");
+  if(!f) { return; }
+  fputs("5", f);
+  fclose(f);
+}
+
+void benchCheck(bool ok, const char* what)
+{
+  printf("  %s: %s\n", ok ? "PASS" : "FAIL", what);
+  if(!ok) { benchFailed = true; }
+}
+
+int main(int argc, char* argv[])
+{
+  std::vector<std::string> filters;
+  for(int ii = 1; ii < argc; ++ii) {
+    if(strncmp(argv[ii], "--", 2) == 0)
+      benchArgs.push_back(argv[ii]);
+    else
+      filters.push_back(argv[ii]);
+  }
+  for(const BenchCase& bc : benchRegistry()) {
+    bool run = filters.empty();
+    for(const std::string& f : filters) { run = run || strstr(bc.name, f.c_str()); }
+    if(!run) { continue; }
+    printf("== %s\n", bc.name);
+    int64_t t0 = benchTimeUs();
+    bc.fn();
+    printf("   (%.1f s, RSS %lld KB, peak %lld KB)\n", (benchTimeUs() - t0)/1E6,
+        (long long)benchRSSKB(), (long long)benchPeakRSSKB());
+    fflush(stdout);
+  }
+  return benchFailed ? 1 : 0;
+}
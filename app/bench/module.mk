@@ -0,0 +1,33 @@
+## benchmarks - app sources w/o GUI dependencies, plus Linux platform for logging (never creates GL context)
+MODULE_BASE := .
+
+MODULE_SOURCES = \
+  app/bench/benchmain.cpp    \
+  app/bench/searchbench.cpp  \
+  app/bench/trackbench.cpp   \
+  app/tests/appstubs.cpp     \
+  app/src/searchdb.cpp       \
+  app/src/gpxfile.cpp        \
+  app/src/plotseries.cpp     \
+  app/src/util.cpp           \
+  tangram-es/platforms/linux/src/linuxPlatform.cpp      \
+  tangram-es/platforms/common/platform_gl.cpp           \
+  tangram-es/platforms/common/urlClient.cpp             \
+  tangram-es/platforms/common/linuxSystemFontHelper.cpp \
+  $(STYLUSLABS_DEPS)/ulib/geom.cpp           \
+  $(STYLUSLABS_DEPS)/ulib/image.cpp          \
+  $(STYLUSLABS_DEPS)/ulib/path2d.cpp         \
+  $(STYLUSLABS_DEPS)/ulib/painter.cpp        \
+  $(STYLUSLABS_DEPS)/usvg/svgnode.cpp        \
+  $(STYLUSLABS_DEPS)/usvg/svgstyleparser.cpp \
+  $(STYLUSLABS_DEPS)/usvg/svgparser.cpp      \
+  $(STYLUSLABS_DEPS)/usvg/svgpainter.cpp     \
+  $(STYLUSLABS_DEPS)/usvg/svgwriter.cpp      \
+  $(STYLUSLABS_DEPS)/usvg/cssparser.cpp      \
+  $(STYLUSLABS_DEPS)/nanovgXC/src/nanovg.c   \
+  $(STYLUSLABS_DEPS)/pugixml/src/pugixml.cpp
+
+MODULE_INC_PRIVATE = $(STYLUSLABS_DEPS) $(STYLUSLABS_DEPS)/nanovgXC/src $(STYLUSLABS_DEPS)/pugixml/src app/src app/include app/bench tangram-es/platforms/common tangram-es/platforms/linux/src
+MODULE_DEFS_PRIVATE = PUGIXML_NO_XPATH PUGIXML_NO_EXCEPTIONS SVGGUI_NO_SDL
+
+include $(ADD_MODULE)
@@ -0,0 +1,1019 @@
+// offline search benchmark: synthetic POI DBs (--sizes=100k,1M,10M) queried w/ fixed workload of map, cluster,
+//  list (w/ paging), category, and autocomplete searches, using the same SQL builders (searchdb.h) as MapsSearch
+// - no GPU or network needed; DBs are cached in benchTempDir() since building 10M POIs takes a while
+
+#include "bench.h"
+#include "searchdb.h"
+#include <random>
+#include <unordered_set>
+#include <thread>
+#include <atomic>
+#include <list>
+#include <cmath>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const std::vector<std::string> searchFields =
+    {"name", "name_en", "amenity", "leisure", "shop", "sport", "tourism", "cuisine", "historic"};
+
+// from MapsSearch
+static constexpr int MAX_MAP_RESULTS = 1000;
+static constexpr int CLUSTER_ZOOM = 13;
+static constexpr size_t FIRST_CHUNK_RESULTS = 50;
+static constexpr int LIST_PAGE = 20;
+static constexpr int INDEX_ZOOM = 14;
+
+struct PoiCategory { const char* key; const char* value; const char* noun; double weight; };
+static const PoiCategory poiCategories[] = {
+  {"amenity", "restaurant", "Restaurant", 12}, {"amenity", "cafe", "Cafe", 8}, {"amenity", "fast_food", "Grill", 6},
+  {"amenity", "bar", "Bar", 3}, {"amenity", "pub", "Tavern", 3}, {"amenity", "bank", "Bank", 3},
+  {"amenity", "pharmacy", "Pharmacy", 3}, {"amenity", "fuel", "Gas", 3}, {"amenity", "school", "School", 5},
+  {"amenity", "place_of_worship", "Church", 5}, {"amenity", "parking", "Parking", 6}, {"amenity", "cinema", "Cinema", 0.5},
+  {"shop", "supermarket", "Market", 3}, {"shop", "convenience", "Mart", 4}, {"shop", "clothes", "Boutique", 4},
+  {"shop", "bakery", "Bakery", 2}, {"shop", "hairdresser", "Salon", 3}, {"shop", "car", "Motors", 1},
+  {"tourism", "hotel", "Hotel", 2}, {"tourism", "guest_house", "Guest House", 1}, {"tourism", "museum", "Museum", 0.5},
+  {"leisure", "park", "Park", 5}, {"leisure", "playground", "Playground", 3}, {"leisure", "pitch", "Field", 3},
+  {"historic", "memorial", "Memorial", 1}
+};
+static constexpr int NUM_CATEGORIES = sizeof(poiCategories)/sizeof(poiCategories[0]);
+
+struct PoiBrand { const char* name; const char* value; };
+static const PoiBrand poiBrands[] = {
+  {"Starbucks", "cafe"}, {"McDonald's", "fast_food"}, {"Subway", "fast_food"}, {"Burger King", "fast_food"},
+  {"KFC", "fast_food"}, {"Shell", "fuel"}, {"Esso", "fuel"}, {"7-Eleven", "convenience"}, {"Tesco", "supermarket"},
+  {"Aldi", "supermarket"}, {"Lidl", "supermarket"}, {"Costa Coffee", "cafe"}, {"Tim Hortons", "cafe"},
+  {"Pizza Hut", "restaurant"}, {"Domino's", "fast_food"}, {"Walgreens", "pharmacy"}, {"CVS Pharmacy", "pharmacy"},
+  {"Holiday Inn", "hotel"}, {"HSBC", "bank"}, {"Santander", "bank"}
+};
+static constexpr int NUM_BRANDS = sizeof(poiBrands)/sizeof(poiBrands[0]);
+
+static const char* cuisines[] = {"pizza", "burger", "chinese", "italian", "mexican", "indian", "thai", "sushi", "kebab"};
+
+// categorical queries as produced by transform-query.js
+static const char* categoryQueries[] = { "restaurant OR fast + food OR food + court", "coffee OR cafe",
+  "gas OR fuel", "hotel OR motel OR hostel OR guest + house", "grocery OR supermarket OR greengrocer", "pharmacy" };
+
+// sample index in [0, n) w/ probability ~ 1/(i+1)^s
+class ZipfDist
+{
+public:
+  ZipfDist(size_t n, double s = 1.0)
+  {
+    double sum = 0;
+    for(size_t ii = 0; ii < n; ++ii)
+      cdf.push_back(sum += 1/std::pow(ii + 1, s));
+  }
+  template<class Rng> size_t operator()(Rng& rng)
+  {
+    double u = std::uniform_real_distribution<double>(0, cdf.back())(rng);
+    return std::min(size_t(std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin()), cdf.size() - 1);
+  }
+private:
+  std::vector<double> cdf;
+};
+
+struct SynthCity { LngLat center; double sigma; int64_t npois; };
+
+// deterministic generator for POI names, categories, and locations - clustered in cities w/ Zipf sizes
+class PoiGenerator
+{
+public:
+  std::mt19937_64 rng;
+  std::vector<std::string> words;
+  ZipfDist wordDist;
+  std::vector<double> catWeights;
+  std::vector<SynthCity> cities;
+  ZipfDist brandDist;
+
+  PoiGenerator(int64_t npois, uint64_t seed = 1) : rng(seed), words(makeWords(rng, 50000)),
+      wordDist(words.size(), 1.0), brandDist(NUM_BRANDS, 0.8)
+  {
+    for(const PoiCategory& cat : poiCategories)
+      catWeights.push_back(cat.weight);
+    int ncities = int(std::max(int64_t(10), npois/20000));
+    ZipfDist cityDist(ncities, 1.0);
+    std::vector<int64_t> counts(ncities, 0);
+    for(int64_t ii = 0; ii < std::min(npois, int64_t(1000000)); ++ii)
+      ++counts[cityDist(rng)];
+    int64_t assigned = 0;
+    for(int ii = 0; ii < ncities; ++ii) {
+      int64_t n = ii + 1 < ncities ? counts[ii]*npois/std::min(npois, int64_t(1000000)) : npois - assigned;
+      assigned += n;
+      LngLat c(std::uniform_real_distribution<double>(-125, 145)(rng), std::uniform_real_distribution<double>(-40, 60)(rng));
+      cities.push_back({c, std::min(0.5, 0.02*std::sqrt(n/1000.0 + 1)), n});
+    }
+  }
+
+  std::string word() { return words[wordDist(rng)]; }
+
+  // POI near city - 10% are spread out over surrounding region
+  LngLat location(const SynthCity& city)
+  {
+    std::normal_distribution<double> norm(0, city.sigma);
+    double f = std::uniform_real_distribution<double>(0, 1)(rng) < 0.1 ? 8 : 1;
+    double lat = std::max(-85.0, std::min(85.0, city.center.latitude + f*norm(rng)));
+    double lng = city.center.longitude + f*norm(rng)/std::cos(lat*M_PI/180);
+    return LngLat(std::max(-179.99, std::min(179.99, lng)), lat);
+  }
+
+  Tangram::Properties props(int64_t osmId)
+  {
+    Tangram::Properties props;
+    std::string name;
+    const PoiCategory* cat = NULL;
+    double r = std::uniform_real_distribution<double>(0, 1)(rng);
+    if(r < 0.12) {
+      const PoiBrand& brand = poiBrands[brandDist(rng)];
+      for(const PoiCategory& c : poiCategories) { if(strcmp(c.value, brand.value) == 0) { cat = &c; break; } }
+      name = brand.name;
+    }
+    else {
+      cat = &poiCategories[std::discrete_distribution<int>(catWeights.begin(), catWeights.end())(rng)];
+      if(r < 0.62) { name = word() + " " + cat->noun; }
+      else if(r < 0.77) { name = word() + " " + word() + " " + cat->noun; }
+      else if(r < 0.87) { name = "The " + word() + " " + cat->noun; }
+      else { name = word(); }
+    }
+    props.set("name", name);
+    props.set(cat->key, cat->value);
+    if(strcmp(cat->value, "restaurant") == 0 || strcmp(cat->value, "fast_food") == 0)
+      props.set("cuisine", cuisines[rng() % (sizeof(cuisines)/sizeof(cuisines[0]))]);
+    if(rng() % 4 == 0)
+      props.set("opening_hours", "Mo-Fr 08:00-18:00; Sa 09:00-14:00");
+    props.set("addr:housenumber", std::to_string(1 + rng() % 400));
+    props.set("addr:street", word() + " Street");
+    props.set("osm_id", double(osmId));
+    props.set("osm_type", "node");
+    return props;
+  }
+
+private:
+  static std::vector<std::string> makeWords(std::mt19937_64& rng, size_t n)
+  {
+    static const char* syllables[] = {"ka", "lo", "ra", "mi", "ten", "bor", "vel", "sa", "na", "dor", "ri", "an",
+        "el", "mar", "tis", "ho", "len", "gra", "fu", "ber", "win", "ston", "ley", "ham", "ford", "dale", "wood",
+        "field", "brook", "ville", "qua", "zen", "ox", "pe", "tru", "ly", "mon", "cal", "vi", "ga"};
+    const size_t nsyl = sizeof(syllables)/sizeof(syllables[0]);
+    std::vector<std::string> res;
+    std::unordered_set<std::string> seen;
+    while(res.size() < n) {
+      std::string w;
+      for(int ii = 0, m = 2 + rng() % 2; ii < m; ++ii) { w += syllables[rng() % nsyl]; }
+      w[0] = toupper(w[0]);
+      if(seen.insert(w).second) { res.push_back(w); }
+    }
+    return res;
+  }
+};
+
+static int64_t fileSize(const std::string& path)
+{
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? int64_t(st.st_size) : -1;
+}
+
+// bytes used by tables and indices w/ name matching LIKE pattern; -1 if SQLite built w/o dbstat
+static int64_t dbObjectBytes(SQLiteDB& db, const char* pattern)
+{
+  int64_t bytes = -1;
+  SQLiteStmt(db.db, "SELECT sum(pgsize) FROM dbstat WHERE name LIKE ?;").bind(pattern).onerow(bytes);
+  return bytes;
+}
+
+static std::string searchDBPath(int64_t npois)
+{
+  return fstring("%s/search-%lld.sqlite", benchTempDir().c_str(), (long long)npois);
+}
+
+// create (or reuse) POI DB - POIs are inserted tile by tile like MapsSearch::indexTileData
+static bool buildSearchDB(int64_t npois)
+{
+  std::string path = searchDBPath(npois);
+  if(benchOpt("rebuild", "0") == "0") {
+    SQLiteDB db;
+    int64_t n = 0;
+    if(db.open(path, SQLITE_OPEN_READONLY) == SQLITE_OK
+        && db.stmt("SELECT value FROM bench_info WHERE key = 'npois';").onerow(n) && n == npois)
+      return true;
+  }
+  removeFile(path);
+  removeFile(path + "-wal");
+  removeFile(path + "-shm");
+  SQLiteDB db;
+  if(db.open(path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE) != SQLITE_OK) {
+    LOGE("Error creating %s", path.c_str());
+    return false;
+  }
+  db.exec("PRAGMA journal_mode=WAL;");
+  db.exec("PRAGMA synchronous=OFF;");
+  if(!db.exec(POI_SCHEMA) || !db.exec(TRIGRAM_SCHEMA)) {
+    LOGE("Error creating search DB schema: %s", db.errMsg());
+    return false;
+  }
+  PoiInsertStmts st;
+  if(!preparePoiInsert(db, "main", "INSERT INTO main.pois (name,tags,props,lng,lat,tile_id) VALUES (?,?,?,?,?,?);", st))
+    return false;
+  auto tileStmt = db.stmt("INSERT OR IGNORE INTO offline_tiles (tile_id, offline_id) VALUES (?, 1);");
+
+  int64_t t0 = benchTimeUs();
+  PoiGenerator gen(npois);
+  int64_t osmId = 1;
+  for(const SynthCity& city : gen.cities) {
+    std::vector<std::pair<int64_t, LngLat>> pts;
+    pts.reserve(city.npois);
+    for(int64_t ii = 0; ii < city.npois; ++ii) {
+      LngLat ll = gen.location(city);
+      pts.push_back({packTileId(lngLatTile(ll, INDEX_ZOOM)), ll});
+    }
+    std::sort(pts.begin(), pts.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+    db.exec("BEGIN;");
+    int64_t tileId = -1;
+    for(auto& pt : pts) {
+      if(pt.first != tileId) {
+        tileId = pt.first;
+        tileStmt.bind(tileId).exec();
+        sqlite3_bind_int64(st.poi, 6, tileId);
+      }
+      Tangram::Properties props = gen.props(osmId++);
+      insertPoi(st, props.getString("name"), pt.second, tileId, searchFields, props);
+    }
+    db.exec("COMMIT;");
+  }
+  st.finalize();
+  double secs = (benchTimeUs() - t0)/1E6;
+  db.exec("CREATE TABLE bench_info(key TEXT PRIMARY KEY, value);");
+  db.stmt("INSERT INTO bench_info VALUES ('build_secs', ?);").bind(secs).exec();
+  db.stmt("INSERT INTO bench_info VALUES ('npois', ?);").bind(npois).exec();
+  db.exec("PRAGMA wal_checkpoint(TRUNCATE);");
+  printf("  built %lld POIs in %.1f s\n", (long long)npois, secs);
+  return true;
+}
+
+// places DB w/ bookmarks and tracks (w/ summaries) near generated cities, indexed w/ PERSONAL_SCHEMA, so list
+//  search includes personal data arm like MapsSearch w/ readPersonal set
+static std::string placesDBPath()
+{
+  return fstring("%s/places.sqlite", benchTempDir().c_str());
+}
+
+static bool buildPlacesDB(int64_t npois)
+{
+  PoiGenerator gen(npois);  // same cities and vocabulary as search DB
+  std::string path = placesDBPath();
+  removeFile(path);
+  SQLiteDB db;
+  if(db.open(path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE) != SQLITE_OK) { return false; }
+  // minimal versions of tables from bookmarks.cpp and tracks.cpp
+  db.exec("CREATE TABLE bookmarks(osm_id TEXT, list_id INTEGER, title TEXT NOT NULL, props TEXT,"
+      " notes TEXT NOT NULL, lng REAL, lat REAL);");
+  db.exec("CREATE TABLE tracks(title TEXT, filename TEXT, notes TEXT);");
+  db.exec("CREATE TABLE track_summary(track_id INTEGER PRIMARY KEY, npts INTEGER,"
+      " min_lng REAL, min_lat REAL, max_lng REAL, max_lat REAL);");
+  if(!db.exec(PERSONAL_SCHEMA)) {
+    LOGE("Error creating personal data index: %s", db.errMsg());
+    return false;
+  }
+  std::mt19937_64 rng(9);
+  db.exec("BEGIN;");
+  auto bkmkStmt = db.stmt("INSERT INTO bookmarks (title, props, notes, lng, lat) VALUES (?,?,?,?,?);");
+  for(int ii = 0; ii < 2000; ++ii) {
+    LngLat ll = gen.location(gen.cities[rng() % std::min(size_t(20), gen.cities.size())]);
+    Tangram::Properties props = gen.props(ii + 1);
+    bkmkStmt.bind(props.getString("name"), propsToBlob(props), rng() % 4 ? "" : gen.word(),
+        ll.longitude, ll.latitude).exec();
+  }
+  auto trackStmt = db.stmt("INSERT INTO tracks (title, filename, notes) VALUES (?,?,'');");
+  auto summaryStmt = db.stmt("INSERT INTO track_summary VALUES (?,1000,?,?,?,?);");
+  for(int ii = 0; ii < 200; ++ii) {
+    LngLat ll = gen.location(gen.cities[rng() % std::min(size_t(20), gen.cities.size())]);
+    trackStmt.bind(gen.word() + " Trail", fstring("track%d.gpx", ii)).exec();
+    // some tracks have no summary yet
+    if(ii % 10 != 0) {
+      summaryStmt.bind(int64_t(sqlite3_last_insert_rowid(db.db)), ll.longitude - 0.02, ll.latitude - 0.02,
+          ll.longitude + 0.02, ll.latitude + 0.02).exec();
+    }
+  }
+  return db.exec("COMMIT;");
+}
+
+// open read connection like MapsSearch::initSearch(); origin is osmSearchRank user data; places DB from
+//  buildPlacesDB() is attached if places is set, like MapsSearch::initPersonalIndex()
+static bool openSearchDB(SQLiteDB& db, const std::string& path, LngLat* origin, bool places = false)
+{
+  if(db.open(path, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX) != SQLITE_OK) { return false; }
+  if(places && !db.exec(fstring("ATTACH DATABASE '%s' AS places;", placesDBPath().c_str()))) { return false; }
+  return sqlite3_create_function(db.db, "osmSearchRank", 3, SQLITE_UTF8, origin, udf_osmSearchRank, 0, 0) == SQLITE_OK;
+}
+
+// bench DB has all POIs in main DB, indexed w/ tags like MapsSearch::indexTileData
+static const std::vector<std::string> benchSchemas = {"main"};
+static bool benchHasTags(const std::string&) { return true; }
+static bool hasPlaces(SQLiteDB& db)
+{
+  int n = 0;
+  db.stmt("SELECT 1 FROM pragma_database_list WHERE name = 'places';").onerow(n);
+  return n > 0;
+}
+
+static void reportDBSize(int64_t npois)
+{
+  SQLiteDB db;
+  if(db.open(searchDBPath(npois), SQLITE_OPEN_READONLY) != SQLITE_OK) { return; }
+  int64_t total = fileSize(searchDBPath(npois));
+  printf("  DB %.1f MB (%.0f bytes/POI): pois %.1f MB, FTS %.1f MB, trigram %.1f MB, tag index %.1f MB\n",
+      total/1E6, double(total)/npois, dbObjectBytes(db, "pois")/1E6 + dbObjectBytes(db, "pois_tile_id")/1E6,
+      dbObjectBytes(db, "pois_fts%")/1E6, dbObjectBytes(db, "pois_trigram%")/1E6,
+      (dbObjectBytes(db, "poi_tags%") + dbObjectBytes(db, "tag_values%"))/1E6);
+}
+
+// random viewport near a (population weighted) city; zoom in [zmin, zmax]
+struct Viewport { LngLat min, max, center; float zoom; };
+static Viewport randomViewport(PoiGenerator& gen, std::mt19937_64& rng, float zmin, float zmax)
+{
+  std::vector<double> w;
+  for(auto& c : gen.cities) { w.push_back(double(c.npois)); }
+  const SynthCity& city = gen.cities[std::discrete_distribution<int>(w.begin(), w.end())(rng)];
+  float zoom = std::uniform_real_distribution<float>(zmin, zmax)(rng);
+  LngLat c = gen.location(city);
+  // ~1000 x 2000 px portrait screen
+  double dlng = 360.0/std::pow(2, zoom) * 1000/256/2;
+  double dlat = dlng*std::cos(c.latitude*M_PI/180)*2;
+  return Viewport{LngLat(c.longitude - dlng, c.latitude - dlat), LngLat(c.longitude + dlng, c.latitude + dlat), c, zoom};
+}
+
+// text query like MapsSearch::searchText() for words from generated names; text is set to words as typed
+static std::string textQuery(PoiGenerator& gen, std::mt19937_64& rng, std::string& text)
+{
+  std::vector<std::string> words;
+  if(rng() % 5 == 0)
+    words = splitStr<std::vector>(poiBrands[gen.brandDist(rng)].name, " ", true);
+  else {
+    words.push_back(gen.word());
+    if(rng() % 3 == 0) { words.push_back(poiCategories[rng() % NUM_CATEGORIES].noun); }
+  }
+  text = joinStr(words, " ");
+  return "\"" + joinStr(words, "\" AND \"") + "\"*";
+}
+
+// all tiles are indexed at INDEX_ZOOM
+static const unsigned int benchTileZooms = 1u << INDEX_ZOOM;
+
+struct SearchWorkload
+{
+  LatencyStats mapFirst, mapTotal, cluster, catMap, listFirst, listPage, catList, autocomplete, fuzzy;
+
+  // all queries except map search first chunk (which is included in map search total)
+  LatencyStats all() const
+  {
+    LatencyStats res;
+    for(const LatencyStats* ls : {&mapTotal, &cluster, &catMap, &listFirst, &listPage, &catList, &autocomplete, &fuzzy})
+      res.samples.insert(res.samples.end(), ls->samples.begin(), ls->samples.end());
+    return res;
+  }
+};
+
+// offlineMapSearch (individual results, streamed in chunks) or clusterMapSearch (low zoom)
+static void mapSearch(SQLiteDB& db, const std::string& query, const Viewport& vp, SearchWorkload& wl)
+{
+  if(vp.zoom < CLUSTER_ZOOM) {
+    int gridZoom = int(vp.zoom);
+    double dlng = CLUSTER_CELL_PX/256 * 360.0/(1 << gridZoom);
+    double dlat = dlng*std::cos(5*std::round((vp.min.latitude + vp.max.latitude)/10)*M_PI/180);
+    int mx0 = int((vp.min.longitude + 180)/dlng), mx1 = int((vp.max.longitude + 180)/dlng);
+    int my0 = int((vp.min.latitude + 90)/dlat), my1 = int((vp.max.latitude + 90)/dlat);
+    int ncells = 0;
+    wl.cluster.time([&](){
+      std::string sql = clusterSearchSql(benchSchemas, benchHasTags, query, LngLat(mx0*dlng - 180, my0*dlat - 90),
+          LngLat((mx1+1)*dlng - 180, (my1+1)*dlat - 90), benchTileZooms);
+      db.stmt(sql).bind(dlng, dlat, query, mx0*dlng - 180, my0*dlat - 90, (mx1+1)*dlng - 180, (my1+1)*dlat - 90)
+          .exec([&](int, int, int, int64_t, double, double, double, const char*){ ++ncells; });
+    });
+    return;
+  }
+  // each schema queried separately, w/ first chunk available as soon as it is produced
+  bool usedTags = false;
+  int64_t t0 = benchTimeUs(), tfirst = -1;
+  size_t n = 0;
+  for(const std::string& schema : benchSchemas) {
+    size_t remaining = MAX_MAP_RESULTS - n;
+    if(remaining == 0) { break; }
+    bool armTags = false;
+    std::string sql = mapSearchSql({schema}, benchHasTags, query, vp.min, vp.max, benchTileZooms, &armTags);
+    usedTags = usedTags || armTags;
+    db.stmt(sql).bind(query, vp.min.longitude, vp.min.latitude, vp.max.longitude, vp.max.latitude, int(remaining))
+        .exec([&](int64_t, double, double, double, const char*){
+          if(++n == FIRST_CHUNK_RESULTS) { tfirst = benchTimeUs(); }
+        });
+    if(n > 0 && tfirst < 0) { tfirst = benchTimeUs(); }
+  }
+  int64_t t1 = benchTimeUs();
+  if(usedTags)
+    wl.catMap.add(t1 - t0);
+  else {
+    wl.mapFirst.add((tfirst < 0 ? t1 : tfirst) - t0);
+    wl.mapTotal.add(t1 - t0);
+  }
+}
+
+// fuzzySearch in mapsearch.cpp: trigram candidates ranked by similarity and distance; returns number of results
+static int fuzzySearch(SQLiteDB& db, const std::string& text, LngLat origin, int limit,
+    std::vector<std::string>* names = NULL)
+{
+  std::vector<std::string> qtris = getTrigrams(trimStr(text));
+  if(qtris.size() < 2) { return 0; }
+  std::vector<std::pair<double, std::string>> cands;
+  db.stmt(fuzzySearchSql(benchSchemas)).bind(trigramMatchStr(qtris), FUZZY_MAX_CANDIDATES)
+      .exec([&](int64_t, const char* name, double lng, double lat, const char*, double){
+        float sim = trigramSimilarity(qtris, name);
+        if(sim < FUZZY_MIN_SIMILARITY) { return; }
+        cands.push_back({-sim/log2(1 + lngLatDist(origin, LngLat(lng, lat))), name});
+      });
+  size_t n = std::min(cands.size(), size_t(limit));
+  std::partial_sort(cands.begin(), cands.begin() + n, cands.end());
+  for(size_t ii = 0; names && ii < n; ++ii)
+    names->push_back(cands[ii].second);
+  return int(n);
+}
+
+// offlineListSearch - first page (w/ fuzzy fallback if few results) and two more pages (scrolling); text is
+//  query w/o FTS syntax, for fuzzy search
+static void listSearch(SQLiteDB& db, const std::string& query, const std::string& text, LngLat origin,
+    SearchWorkload& wl)
+{
+  bool usedTags = false;
+  std::string sql = listSearchSql(benchSchemas, benchHasTags, query, query.back() != '*', hasPlaces(db),
+      LIST_PAGE, &usedTags);
+  for(int page = 0; page < 3; ++page) {
+    int n = 0;
+    int64_t t0 = benchTimeUs();
+    db.stmt(sql).bind(query, page*LIST_PAGE).exec([&](int64_t, double, double, double, const char*, double){ ++n; });
+    int64_t dt = benchTimeUs() - t0;
+    (usedTags ? wl.catList : page == 0 ? wl.listFirst : wl.listPage).add(dt);
+    if(page == 0 && n < FUZZY_MIN_RESULTS && !text.empty())
+      wl.fuzzy.time([&](){ fuzzySearch(db, text, origin, LIST_PAGE); });
+    if(n < LIST_PAGE) { break; }
+  }
+}
+
+// offlineAutocomplete w/o candidate cache - each keystroke is a new query
+static void autocompleteSearch(SQLiteDB& db, const std::string& word, SearchWorkload& wl)
+{
+  std::string sql = autocompleteSql(benchSchemas);
+  std::string sqlRanked = autocompleteRankedSql(benchSchemas, false, LIST_PAGE);
+  for(size_t len = 2; len <= std::min(word.size(), size_t(6)); ++len) {
+    std::string q = "name : \"" + word.substr(0, len) + "\"*";
+    wl.autocomplete.time([&](){
+      int n = 0;
+      db.stmt(sql).bind(q, AC_MAX_CANDIDATES + 1)
+          .exec([&](int64_t, const char*, double, double, double, const char*){ ++n; });
+      if(n > AC_MAX_CANDIDATES)
+        db.stmt(sqlRanked).bind(q).exec([&](int64_t, const char*, double, double, double, const char*, double){});
+    });
+  }
+}
+
+// fixed workload: each query is run as map, list, and (for text queries) autocomplete search; origin is
+//  osmSearchRank user data of db
+static void searchWorkload(SQLiteDB& db, LngLat& origin, PoiGenerator& gen, int nqueries, SearchWorkload& wl)
+{
+  std::mt19937_64 rng(42);
+  for(int ii = 0; ii < nqueries; ++ii) {
+    Viewport vp = randomViewport(gen, rng, 10, 17);
+    origin = vp.center;
+    bool cat = rng() % 4 == 0;
+    std::string text, query;
+    if(cat) {
+      query = categoryQueries[rng() % (sizeof(categoryQueries)/sizeof(categoryQueries[0]))];
+      text = query.substr(0, query.find(' '));  // word typed to get category query
+    }
+    else
+      query = textQuery(gen, rng, text);
+    mapSearch(db, query, vp, wl);
+    listSearch(db, query, text, origin, wl);
+    if(!cat)
+      autocompleteSearch(db, rng() % 5 == 0 ? poiBrands[gen.brandDist(rng)].name : gen.word(), wl);
+  }
+}
+
+BENCHMARK(search)
+{
+  int nqueries = atoi(benchOpt("queries", "200").c_str());
+  for(int64_t npois : benchOptList("sizes", "100k,1M")) {
+    printf(" %lld POIs\n", (long long)npois);
+    if(!buildSearchDB(npois)) { benchCheck(false, "build search DB"); continue; }
+    reportDBSize(npois);
+    if(!buildPlacesDB(npois)) { benchCheck(false, "build places DB"); continue; }
+
+    LngLat origin;
+    SQLiteDB db;
+    if(!openSearchDB(db, searchDBPath(npois), &origin, true)) { benchCheck(false, "open search DB"); continue; }
+    int64_t rss0 = benchRSSKB();
+    PoiGenerator gen(npois);  // same cities and vocabulary as DB
+    SearchWorkload wl;
+    searchWorkload(db, origin, gen, nqueries, wl);
+    wl.mapFirst.report("map search first 50");
+    wl.mapTotal.report("map search all");
+    wl.cluster.report("cluster map search");
+    wl.catMap.report("category map search");
+    wl.listFirst.report("list search first page");
+    wl.listPage.report("list search next page");
+    wl.catList.report("category list search");
+    wl.autocomplete.report("autocomplete keystroke");
+    wl.fuzzy.report("fuzzy fallback");
+    sqlite3_int64 cur = 0, hi = 0;
+    sqlite3_status64(SQLITE_STATUS_MEMORY_USED, &cur, &hi, 0);
+    printf("  memory: RSS +%lld KB during workload, SQLite %.1f MB (peak %.1f MB)\n",
+        (long long)(benchRSSKB() - rss0), cur/1E6, hi/1E6);
+  }
+}
+
+// compact props blob vs JSON text (Properties::toJson) for pois.props: DB size and time to hydrate results
+BENCHMARK(props)
+{
+  for(int64_t npois : benchOptList("sizes", "100k")) {
+    printf(" %lld POIs\n", (long long)npois);
+    PoiGenerator gen(npois);
+    std::vector<std::string> jsons, blobs;
+    int64_t jsonBytes = 0, blobBytes = 0;
+    for(int64_t ii = 0; ii < npois; ++ii) {
+      Tangram::Properties props = gen.props(ii + 1);
+      jsons.push_back(props.toJson());
+      blobs.push_back(propsToBlob(props));
+      jsonBytes += jsons.back().size();
+      blobBytes += blobs.back().size();
+    }
+    printf("  props: JSON %.1f bytes/POI, blob %.1f bytes/POI\n", double(jsonBytes)/npois, double(blobBytes)/npois);
+
+    int64_t dbBytes[2];
+    for(int blob = 0; blob < 2; ++blob) {
+      std::string path = fstring("%s/props-%s.sqlite", benchTempDir().c_str(), blob ? "blob" : "json");
+      removeFile(path);
+      {
+        SQLiteDB db;
+        db.open(path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+        db.exec("CREATE TABLE pois(props TEXT);");
+        db.exec("BEGIN;");
+        sqlite3_stmt* stmt = NULL;
+        sqlite3_prepare_v2(db.db, "INSERT INTO pois (props) VALUES (?);", -1, &stmt, NULL);
+        for(int64_t ii = 0; ii < npois; ++ii) {
+          // as in insertPoi()
+          if(blob)
+            sqlite3_bind_blob(stmt, 1, blobs[ii].data(), blobs[ii].size(), SQLITE_STATIC);
+          else
+            sqlite3_bind_text(stmt, 1, jsons[ii].c_str(), -1, SQLITE_STATIC);
+          sqlite3_step(stmt);
+          sqlite3_reset(stmt);
+        }
+        sqlite3_finalize(stmt);
+        db.exec("COMMIT;");
+      }
+      dbBytes[blob] = fileSize(path);
+      removeFile(path);
+    }
+    printf("  pois.props table: JSON %.1f MB, blob %.1f MB (%.0f%%)\n",
+        dbBytes[0]/1E6, dbBytes[1]/1E6, 100.0*dbBytes[1]/dbBytes[0]);
+
+    // hydrating results: full Properties (place info), name only (result list), and JSON view (plugins)
+    size_t sink = 0;
+    auto timeEach = [&](const char* label, const std::vector<std::string>& strs, const std::function<size_t(const char*)>& fn){
+      int64_t t0 = benchTimeUs();
+      for(const std::string& s : strs) { sink += fn(s.c_str()); }
+      printf("  %-36s %8.3f us/result\n", label, double(benchTimeUs() - t0)/strs.size());
+    };
+    timeEach("jsonToProps(JSON)", jsons, [](const char* s){ return jsonToProps(s).getString("name").size(); });
+    timeEach("propsBlobToProps(blob)", blobs, [](const char* s){ return propsBlobToProps(s).getString("name").size(); });
+    timeEach("name from blob (PropsView)", blobs, [](const char* s){
+      PropsView view(s);
+      return view.find("name") ? view.strLen : 0;
+    });
+    timeEach("propsBlobToJson(blob)", blobs, [](const char* s){ return propsBlobToJson(s).size(); });
+    if(!sink) { printf("  (no names)\n"); }
+  }
+}
+
+static bool copyFile(const std::string& src, const std::string& dst)
+{
+  FILE* fin = fopen(src.c_str(), "rb");
+  FILE* fout = fin ? fopen(dst.c_str(), "wb") : NULL;
+  bool ok = fin && fout;
+  char buf[1 << 16];
+  for(size_t n; ok && (n = fread(buf, 1, sizeof(buf), fin)) > 0;)
+    ok = fwrite(buf, 1, n, fout) == n;
+  if(fin) { fclose(fin); }
+  if(fout) { fclose(fout); }
+  return ok;
+}
+
+// search workload on read connection while writer indexes a new region tile by tile, one transaction per tile
+//  like MapsSearch::indexTileData; p95 of all queries must stay within --p95-ms (default 3x idle p95 + 5 ms, or
+//  5x on a single core)
+BENCHMARK(concurrent)
+{
+  int nqueries = atoi(benchOpt("queries", "200").c_str());
+  for(int64_t npois : benchOptList("sizes", "100k")) {
+    printf(" %lld POIs\n", (long long)npois);
+    if(!buildSearchDB(npois)) { benchCheck(false, "build search DB"); continue; }
+    std::string path = fstring("%s/stress-%lld.sqlite", benchTempDir().c_str(), (long long)npois);
+    removeFile(path + "-wal");
+    removeFile(path + "-shm");
+    if(!copyFile(searchDBPath(npois), path)) { benchCheck(false, "copy search DB"); continue; }
+
+    if(!buildPlacesDB(npois)) { benchCheck(false, "build places DB"); continue; }
+
+    PoiGenerator gen(npois);
+    LngLat origin;
+    SQLiteDB readDB;
+    if(!openSearchDB(readDB, path, &origin, true)) { benchCheck(false, "open search DB"); continue; }
+    SearchWorkload idle;
+    searchWorkload(readDB, origin, gen, nqueries, idle);
+    LatencyStats idleAll = idle.all();
+    idleAll.report("idle: all queries");
+
+    SQLiteDB writeDB;
+    PoiInsertStmts st;
+    if(writeDB.open(path, SQLITE_OPEN_READWRITE) != SQLITE_OK || !writeDB.exec("PRAGMA journal_mode=WAL;")
+        || !preparePoiInsert(writeDB, "main",
+            "INSERT INTO main.pois (name,tags,props,lng,lat,tile_id) VALUES (?,?,?,?,?,?);", st)) {
+      benchCheck(false, "open search DB for writing");
+      continue;
+    }
+    int pauseMs = atoi(benchOpt("writer-pause-ms", "5").c_str());
+    std::atomic_bool stop(false);
+    std::atomic<int64_t> ntiles(0), nwritten(0);
+    LatencyStats commits;
+    std::thread writer([&](){
+      PoiGenerator wgen(npois, 2);  // new region
+      auto tileStmt = writeDB.stmt("INSERT OR IGNORE INTO offline_tiles (tile_id, offline_id) VALUES (?, 2);");
+      int64_t osmId = int64_t(1) << 40;
+      while(!stop) {
+        // generate a tile's worth of POIs near a city
+        const SynthCity& city = wgen.cities[wgen.rng() % wgen.cities.size()];
+        LngLat ll0 = wgen.location(city);
+        int64_t tileId = packTileId(lngLatTile(ll0, INDEX_ZOOM));
+        sqlite3_bind_int64(st.poi, 6, tileId);
+        int64_t t0 = benchTimeUs();
+        writeDB.exec("BEGIN TRANSACTION");
+        for(int ii = 0; ii < 200; ++ii) {
+          Tangram::Properties props = wgen.props(osmId++);
+          LngLat ll(ll0.longitude + 0.001*(ii % 10), ll0.latitude + 0.001*(ii / 20));
+          insertPoi(st, props.getString("name"), ll, tileId, searchFields, props);
+        }
+        writeDB.exec("COMMIT TRANSACTION");
+        tileStmt.bind(tileId).exec();
+        commits.add(benchTimeUs() - t0);
+        nwritten += 200;
+        ++ntiles;
+        std::this_thread::sleep_for(std::chrono::milliseconds(pauseMs));  // fetching and parsing next tile
+      }
+    });
+    int64_t t0 = benchTimeUs();
+    SearchWorkload busy;
+    searchWorkload(readDB, origin, gen, nqueries, busy);
+    stop = true;
+    writer.join();
+    double secs = (benchTimeUs() - t0)/1E6;
+    st.finalize();
+    LatencyStats busyAll = busy.all();
+    busyAll.report("indexing: all queries");
+    busy.mapTotal.report("indexing: map search");
+    busy.listFirst.report("indexing: list search");
+    busy.autocomplete.report("indexing: autocomplete");
+    commits.report("writer: tile transaction");
+    printf("  writer indexed %lld tiles, %lld POIs (%.0f POIs/s)\n",
+        (long long)ntiles.load(), (long long)nwritten.load(), nwritten/secs);
+    std::string bound = benchOpt("p95-ms", "");
+    // on a single core, reader and writer also compete for CPU
+    int factor = std::thread::hardware_concurrency() > 1 ? 3 : 5;
+    double maxp95 = bound.empty() ? factor*idleAll.percentile(95) + 5 : atof(bound.c_str());
+    benchCheck(busyAll.percentile(95) <= maxp95, fstring("p95 %.2f ms while indexing <= %.2f ms",
+        busyAll.percentile(95), maxp95).c_str());
+    benchCheck(ntiles > 0, "writer made progress");
+  }
+}
+
+// incremental autocomplete (MapsSearch::autocompleteQuery): candidates for complete (not truncated) prefix
+//  queries are kept in LRU and refined in memory as query is extended, vs. querying DB on every keystroke
+struct AcCandidates {
+  std::string query;
+  std::vector<std::string> names;
+  std::vector<std::pair<LngLat, double>> results;  // pos, FTS rank
+  bool complete;
+};
+
+static size_t acKeystroke(SQLiteDB& db, const std::string& typed, LngLat origin, std::list<AcCandidates>& cache,
+    bool& fromDB)
+{
+  std::vector<std::string> words, tokens;
+  bool ascii = acTokenize(typed, words);
+  std::string normq = joinStr(words, " ");
+  auto hit = std::find_if(cache.begin(), cache.end(), [&](const AcCandidates& c){ return ascii && c.query == normq; });
+  if(hit == cache.end() && ascii) {
+    auto prev = cache.end();
+    for(auto it = cache.begin(); it != cache.end(); ++it) {
+      if(it->complete && normq.compare(0, it->query.size(), it->query) == 0
+          && (prev == cache.end() || it->query.size() > prev->query.size()))
+        prev = it;
+    }
+    if(prev != cache.end()) {
+      AcCandidates refined{normq, {}, {}, true};
+      for(size_t ii = 0; ii < prev->names.size(); ++ii) {
+        acTokenize(prev->names[ii], tokens);
+        if(acMatches(words, tokens)) {
+          refined.names.push_back(prev->names[ii]);
+          refined.results.push_back(prev->results[ii]);
+        }
+      }
+      cache.push_front(std::move(refined));
+      hit = cache.begin();
+    }
+  }
+  fromDB = hit == cache.end();
+  if(fromDB) {
+    std::vector<std::string> qwords = splitStr<std::vector>(typed, " ", true);
+    std::string queryStr = "name : \"" + joinStr(qwords, "\" AND \"") + "\"*";
+    AcCandidates cands{normq, {}, {}, true};
+    bool namesascii = true;
+    db.stmt(autocompleteSql(benchSchemas)).bind(queryStr, AC_MAX_CANDIDATES + 1)
+        .exec([&](int64_t, const char* name, double lng, double lat, double score, const char*){
+          cands.names.push_back(name ? name : "");
+          cands.results.push_back({LngLat(lng, lat), score});
+          namesascii = namesascii && acTokenize(cands.names.back(), tokens);
+        });
+    if(int(cands.names.size()) > AC_MAX_CANDIDATES) {
+      cands.complete = false;
+      cands.names.clear();
+      cands.results.clear();
+      db.stmt(autocompleteRankedSql(benchSchemas, false, LIST_PAGE)).bind(queryStr).exec([&](int64_t, const char* name, double lng, double lat, double score,
+          const char*, double){
+        cands.names.push_back(name ? name : "");
+        cands.results.push_back({LngLat(lng, lat), score});
+      });
+    }
+    cands.complete = cands.complete && namesascii && ascii;
+    cache.push_front(std::move(cands));
+    hit = cache.begin();
+  }
+  else
+    cache.splice(cache.begin(), cache, hit);
+  if(cache.size() > 8)  // AC_CACHE_SIZE
+    cache.pop_back();
+  if(!hit->complete) { return hit->results.size(); }
+  // rank candidates - same as ORDER BY osmSearchRank(rank, lng, lat)
+  std::vector<std::pair<double, size_t>> order;
+  for(size_t ii = 0; ii < hit->results.size(); ++ii)
+    order.emplace_back(hit->results[ii].second/log2(1 + lngLatDist(origin, hit->results[ii].first)), ii);
+  size_t n = std::min(order.size(), size_t(LIST_PAGE));
+  std::partial_sort(order.begin(), order.begin() + n, order.end());
+  return n;
+}
+
+// keystroke latency for typing names w/ and w/o candidate reuse; checks p95 against --ac-target-ms (20 ms)
+BENCHMARK(autocomplete)
+{
+  int nqueries = atoi(benchOpt("queries", "200").c_str());
+  double target = atof(benchOpt("ac-target-ms", "20").c_str());
+  for(int64_t npois : benchOptList("sizes", "100k,1M")) {
+    printf(" %lld POIs\n", (long long)npois);
+    if(!buildSearchDB(npois)) { benchCheck(false, "build search DB"); continue; }
+    LngLat origin;
+    SQLiteDB db;
+    if(!openSearchDB(db, searchDBPath(npois), &origin)) { benchCheck(false, "open search DB"); continue; }
+    PoiGenerator gen(npois);
+    std::vector<std::string> typed;
+    std::vector<LngLat> origins;
+    std::mt19937_64 rng(7);
+    for(int ii = 0; ii < nqueries; ++ii) {
+      std::string name = rng() % 5 == 0 ? poiBrands[gen.brandDist(rng)].name
+          : rng() % 3 == 0 ? gen.word() + " " + poiCategories[rng() % NUM_CATEGORIES].noun : gen.word();
+      LngLat org = randomViewport(gen, rng, 12, 16).center;
+      // search starts after 2 chars (see MapsSearch::searchText)
+      for(size_t len = 2; len <= name.size(); ++len) {
+        if(name[len-1] == ' ') { continue; }
+        typed.push_back(name.substr(0, len));
+        origins.push_back(org);
+      }
+    }
+    LatencyStats cold, incr, incrDB, incrMem;
+    std::list<AcCandidates> cache;
+    for(int reuse = 0; reuse < 2; ++reuse) {
+      for(size_t ii = 0; ii < typed.size(); ++ii) {
+        origin = origins[ii];
+        bool fromDB = true;
+        int64_t t0 = benchTimeUs();
+        if(!reuse) { cache.clear(); }
+        acKeystroke(db, typed[ii], origin, cache, fromDB);
+        int64_t dt = benchTimeUs() - t0;
+        if(!reuse) { cold.add(dt); continue; }
+        incr.add(dt);
+        (fromDB ? incrDB : incrMem).add(dt);
+      }
+    }
+    cold.report("keystroke, no reuse");
+    incr.report("keystroke, w/ reuse");
+    incrDB.report("  DB query");
+    incrMem.report("  refined in memory");
+    benchCheck(incr.percentile(95) < target, fstring("autocomplete p95 %.2f ms < %.0f ms",
+        incr.percentile(95), target).c_str());
+  }
+}
+
+// one random edit (substitution, deletion, insertion, or transposition) in word
+static std::string misspell(const std::string& word, std::mt19937_64& rng)
+{
+  std::string s = word;
+  size_t pos = 1 + rng() % (s.size() - 1);  // keep first char, as users usually get it right
+  char c = 'a' + rng() % 26;
+  switch(rng() % 4) {
+    case 0: s[pos] = c; break;
+    case 1: s.erase(pos, 1); break;
+    case 2: s.insert(pos, 1, c); break;
+    default: if(pos + 1 < s.size()) { std::swap(s[pos], s[pos+1]); } else { s[pos] = c; } break;
+  }
+  return s;
+}
+
+// typo-tolerant fallback (fuzzySearch in mapsearch.cpp): misspelled names are searched w/ primary FTS query,
+//  then trigram index; checks latency against FUZZY_BUDGET_MS and index size against --trigram-ratio (trigram
+//  index size / FTS index size, default 2)
+BENCHMARK(fuzzy)
+{
+  int nqueries = atoi(benchOpt("queries", "200").c_str());
+  double maxRatio = atof(benchOpt("trigram-ratio", "2").c_str());
+  for(int64_t npois : benchOptList("sizes", "100k,1M")) {
+    printf(" %lld POIs\n", (long long)npois);
+    if(!buildSearchDB(npois)) { benchCheck(false, "build search DB"); continue; }
+    LngLat origin;
+    SQLiteDB db;
+    if(!openSearchDB(db, searchDBPath(npois), &origin)) { benchCheck(false, "open search DB"); continue; }
+    int64_t ftsBytes = dbObjectBytes(db, "pois_fts%"), triBytes = dbObjectBytes(db, "pois_trigram%");
+    if(ftsBytes > 0) {
+      printf("  trigram index %.1f MB (%.1f bytes/POI), FTS index %.1f MB\n",
+          triBytes/1E6, double(triBytes)/npois, ftsBytes/1E6);
+      benchCheck(triBytes <= maxRatio*ftsBytes, fstring("trigram index <= %.1fx FTS index", maxRatio).c_str());
+    }
+
+    PoiGenerator gen(npois);
+    std::mt19937_64 rng(11);
+    LatencyStats primary, fuzzy;
+    int nfound = 0, nfallback = 0;
+    std::string ftsSql = listSearchSql(benchSchemas, benchHasTags, "", false, false, LIST_PAGE);
+    for(int ii = 0; ii < nqueries; ++ii) {
+      std::string word;
+      while(word.size() < 5) { word = gen.word(); }  // need at least 4 chars for any tolerance
+      std::string text = misspell(word, rng);
+      origin = randomViewport(gen, rng, 12, 16).center;
+      int nprimary = 0;
+      primary.time([&](){
+        db.stmt(ftsSql).bind("\"" + text + "\"*", 0).exec([&](int64_t, double, double, double, const char*, double){
+          ++nprimary;
+        });
+      });
+      if(nprimary >= FUZZY_MIN_RESULTS) { continue; }
+      ++nfallback;
+      std::vector<std::string> names;
+      fuzzy.time([&](){ fuzzySearch(db, text, origin, LIST_PAGE, &names); });
+      for(const std::string& name : names) {
+        if(name.find(word) != std::string::npos) { ++nfound; break; }
+      }
+    }
+    primary.report("primary FTS query");
+    fuzzy.report("trigram fallback");
+    printf("  fallback for %d/%d misspellings, intended word in top %d for %d\n",
+        nfallback, nqueries, LIST_PAGE, nfound);
+    benchCheck(fuzzy.percentile(95) <= FUZZY_BUDGET_MS, fstring("fuzzy p95 %.2f ms <= %d ms",
+        fuzzy.percentile(95), FUZZY_BUDGET_MS).c_str());
+  }
+}
+
+// Morton vs legacy (z<<48|x<<24|y) tile ids: POIs for viewport are read from a table clustered by tile id,
+//  like poi_tags, w/ OS file cache dropped and new connection before each read so every page comes from disk
+static int64_t legacyTileId(const TileID& t) { return int64_t(t.z) << 48 | int64_t(t.x) << 24 | t.y; }
+
+static void dropFileCache(const std::string& path)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if(fd >= 0) {
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+}
+
+BENCHMARK(tileids)
+{
+  int nqueries = atoi(benchOpt("queries", "200").c_str());
+  const int64_t step = int64_t(1) << (2*(24 - INDEX_ZOOM) + 5);  // between adjacent Morton ids at INDEX_ZOOM
+  for(int64_t npois : benchOptList("sizes", "100k,1M")) {
+    printf(" %lld POIs\n", (long long)npois);
+    if(!buildSearchDB(npois)) { benchCheck(false, "build search DB"); continue; }
+    std::string paths[2];
+    for(int morton = 0; morton < 2; ++morton) {
+      paths[morton] = fstring("%s/tiles-%s-%lld.sqlite", benchTempDir().c_str(), morton ? "morton" : "legacy",
+          (long long)npois);
+      removeFile(paths[morton]);
+      SQLiteDB src, db;
+      db.open(paths[morton], SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+      db.exec("CREATE TABLE pois_by_tile(tile_id INTEGER, poi_id INTEGER, name TEXT, props, lng REAL, lat REAL,"
+          " PRIMARY KEY(tile_id, poi_id)) WITHOUT ROWID;");
+      db.exec("BEGIN;");
+      auto ins = db.stmt("INSERT INTO pois_by_tile VALUES (?,?,?,?,?,?);");
+      src.open(searchDBPath(npois), SQLITE_OPEN_READONLY);
+      // POIs are inserted in DB order, so only the tile id scheme differs
+      src.stmt("SELECT rowid, tile_id, name, props, lng, lat FROM pois ORDER BY rowid;")
+          .exec([&](int64_t rowid, int64_t tileId, const char* name, const char* props, double lng, double lat){
+            ins.bind(morton ? tileId : legacyTileId(unpackTileId(tileId)), rowid, name, props, lng, lat).exec();
+          });
+      db.exec("COMMIT;");
+    }
+
+    PoiGenerator gen(npois);
+    std::mt19937_64 rng(5);
+    LatencyStats times[2];
+    int64_t pages[2] = {0, 0}, nranges[2] = {0, 0}, nrows[2] = {0, 0};
+    for(int ii = 0; ii < nqueries; ++ii) {
+      Viewport vp = randomViewport(gen, rng, 13, 16);
+      TileID t00 = lngLatTile(vp.min, INDEX_ZOOM), t11 = lngLatTile(vp.max, INDEX_ZOOM);
+      for(int morton = 0; morton < 2; ++morton) {
+        // id ranges covering viewport tiles: contiguous Morton ids, or columns of constant x for legacy ids
+        std::vector<std::pair<int64_t, int64_t>> ranges;
+        if(morton) {
+          std::vector<int64_t> ids;
+          for(int x = t00.x; x <= t11.x; ++x) {
+            for(int y = t11.y; y <= t00.y; ++y)
+              ids.push_back(packTileId(TileID(x, y, INDEX_ZOOM)));
+          }
+          std::sort(ids.begin(), ids.end());
+          for(int64_t id : ids) {
+            if(!ranges.empty() && ranges.back().second + step == id) { ranges.back().second = id; }
+            else { ranges.push_back({id, id}); }
+          }
+        }
+        else {
+          for(int x = t00.x; x <= t11.x; ++x)
+            ranges.push_back({legacyTileId(TileID(x, t11.y, INDEX_ZOOM)), legacyTileId(TileID(x, t00.y, INDEX_ZOOM))});
+        }
+        dropFileCache(paths[morton]);
+        SQLiteDB db;
+        db.open(paths[morton], SQLITE_OPEN_READONLY);
+        times[morton].time([&](){
+          auto stmt = db.stmt("SELECT lng, lat, props FROM pois_by_tile WHERE tile_id >= ? AND tile_id <= ?;");
+          for(auto& r : ranges)
+            stmt.bind(r.first, r.second).exec([&](double, double, const char*){ ++nrows[morton]; });
+        });
+        int cur = 0, hi = 0;
+        sqlite3_db_status(db.db, SQLITE_DBSTATUS_CACHE_MISS, &cur, &hi, 0);
+        pages[morton] += cur;
+        nranges[morton] += ranges.size();
+      }
+    }
+    times[0].report("legacy ids, cold");
+    times[1].report("Morton ids, cold");
+    for(int morton = 0; morton < 2; ++morton) {
+      printf("  %s: %.1f pages read, %.1f range scans per viewport (%lld rows)\n", morton ? "Morton" : "legacy",
+          double(pages[morton])/nqueries, double(nranges[morton])/nqueries, (long long)nrows[morton]);
+      removeFile(paths[morton]);
+    }
+    benchCheck(nrows[0] == nrows[1], "same POIs read w/ both schemes");
+  }
+}
+
+// category queries w/ tag index (tagMatchSql) vs. FTS over tags column, for viewport (map) and nearest (list)
+BENCHMARK(category)
+{
+  int nqueries = atoi(benchOpt("queries", "200").c_str());
+  const int ncats = sizeof(categoryQueries)/sizeof(categoryQueries[0]);
+  for(int64_t npois : benchOptList("sizes", "100k,1M")) {
+    printf(" %lld POIs\n", (long long)npois);
+    if(!buildSearchDB(npois)) { benchCheck(false, "build search DB"); continue; }
+    LngLat origin;
+    SQLiteDB db;
+    if(!openSearchDB(db, searchDBPath(npois), &origin)) { benchCheck(false, "open search DB"); continue; }
+    PoiGenerator gen(npois);
+    std::mt19937_64 rng(3);
+    LatencyStats mapTimes[2], listTimes[2];
+    int64_t nmap[2] = {0, 0}, nlist[2] = {0, 0};
+    for(int ii = 0; ii < nqueries; ++ii) {
+      Viewport vp = randomViewport(gen, rng, 13, 17);
+      origin = vp.center;
+      std::string query = categoryQueries[rng() % ncats];
+      for(int tags = 0; tags < 2; ++tags) {
+        // as in offlineMapSearch and offlineListSearch, w/ and w/o complete tag index
+        auto hasTags = [tags](const std::string&){ return tags != 0; };
+        mapTimes[tags].time([&](){
+          db.stmt(mapSearchSql(benchSchemas, hasTags, query, vp.min, vp.max, benchTileZooms)).bind(query,
+              vp.min.longitude, vp.min.latitude, vp.max.longitude, vp.max.latitude, MAX_MAP_RESULTS)
+              .exec([&](int64_t, double, double, double, const char*){ ++nmap[tags]; });
+        });
+        listTimes[tags].time([&](){
+          db.stmt(listSearchSql(benchSchemas, hasTags, query, true, false, LIST_PAGE)).bind(query, 0).exec([&](int64_t, double, double, double, const char*, double){ ++nlist[tags]; });
+        });
+      }
+    }
+    mapTimes[0].report("map, FTS");
+    mapTimes[1].report("map, tag index");
+    listTimes[0].report("list, FTS");
+    listTimes[1].report("list, tag index");
+    printf("  results: map FTS %lld, tag index %lld; list FTS %lld, tag index %lld\n", (long long)nmap[0],
+        (long long)nmap[1], (long long)nlist[0], (long long)nlist[1]);
+  }
+}
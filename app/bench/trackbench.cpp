@@ -0,0 +1,637 @@
+// track benchmarks w/ synthetic tracks: GPX loading and saving, recording, storage, and indexing
+// - uses gpxfile.cpp w/o the rest of the app (MapsApp statics from app/tests/appstubs.cpp)
+
+#include "bench.h"
+#include "gpxfile.h"
+#include "util.h"
+#include "plotseries.h"
+#include "linuxPlatform.h"
+#include "util/mapProjection.h"
+#include "pugixml.hpp"
+#include "ulib/stringutil.h"
+#include "ulib/fileutil.h"
+#include <random>
+#include <sstream>
+#include <iomanip>
+#include <ctime>
+#include <cmath>
+#include <list>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// random walk w/ 1 s between points and slowly varying heading, speed, and altitude, as from recording
+static std::vector<Waypoint> syntheticTrack(size_t npts, unsigned int seed, LngLat origin = LngLat(-122.4, 37.8))
+{
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> norm(0, 1);
+  std::vector<Waypoint> pts;
+  pts.reserve(npts);
+  Location loc{1.6E9 + seed*1E7, origin.latitude, origin.longitude, 5, 100, 4, 0, 0, 1.5, 0};
+  double heading = 0;
+  for(size_t ii = 0; ii < npts; ++ii) {
+    pts.emplace_back(loc);
+    heading += 0.2*norm(rng);
+    loc.spd = float(std::max(0.2, std::min(15.0, loc.spd + 0.1*norm(rng))));
+    double meters = loc.spd;  // 1 s
+    loc.lat += meters*std::cos(heading)/111E3;
+    loc.lng += meters*std::sin(heading)/(111E3*std::cos(loc.lat*M_PI/180));
+    loc.alt += 0.3*norm(rng);
+    loc.poserr = float(3 + std::abs(3*norm(rng)));
+    loc.dir = float(std::fmod(heading*180/M_PI + 3600, 360));
+    loc.time += 1;
+  }
+  return pts;
+}
+
+// same as TrackMarker::setTrack() w/o MapsApp
+struct TrackTiler
+{
+  Tangram::LinuxPlatform platform;
+  std::shared_ptr<ClientDataSource> source;
+  uint64_t featureId = -1;
+
+  TrackTiler() : source(std::make_shared<ClientDataSource>(
+      platform, "tracks", "", false, TileSource::ZoomOptions(-1, -1, 14, 0))) {}
+
+  void setTrack(GpxWay& way)
+  {
+    double tol = 0.5*MapProjection::metersPerPixelAtZoom(TrackMarker::defaultSimplifyZoom);
+    const std::vector<float>& tols = way.simplifier.levels(way);
+    Tangram::ClientDataSource::PolylineBuilder builder;
+    builder.beginPolyline(std::count_if(tols.begin(), tols.end(), [tol](float t){ return t > tol; }));
+    for(size_t ii = 0; ii < way.size(); ++ii) {
+      if(tols[ii] > tol)
+        builder.addPoint(way.lngLat(ii));
+    }
+    featureId = source->addPolylineFeature(Properties(), std::move(builder), featureId);
+    source->generateTiles();
+  }
+};
+
+// per-point cost of recording: rebuilding and retiling the whole track for each point (as before
+//  TrackMarker::appendTrack()) vs. retiling every MAX_TAIL_PTS points and drawing the rest as a tail polyline
+// - cost of updating tail marker on the map is not included (needs a Map), only building its points
+BENCHMARK(recording)
+{
+  int nappend = atoi(benchOpt("append", "1024").c_str());
+  int nrebuild = atoi(benchOpt("rebuilds", "8").c_str());
+  for(int64_t npts : benchOptList("sizes", "1k,100k,1M")) {
+    printf(" %lld points\n", (long long)npts);
+    std::vector<Waypoint> src = syntheticTrack(npts + std::max(nappend, nrebuild), 42);
+    double speedInvTau = 0.5;
+
+    GpxWay way;
+    way.pts.assign(src.begin(), src.begin() + npts);
+    way.stats.update(way.pts, true, true, speedInvTau);
+    TrackTiler tiler;
+    tiler.setTrack(way);
+    LatencyStats full;
+    for(int ii = 0; ii < nrebuild; ++ii) {
+      full.time([&](){
+        way.pts.push_back(src[npts + ii]);
+        way.stats.update(way.pts, true, true, speedInvTau);
+        tiler.setTrack(way);
+      });
+    }
+    full.report("full rebuild per point");
+
+    GpxWay way2;
+    way2.pts.assign(src.begin(), src.begin() + npts);
+    way2.stats.update(way2.pts, true, true, speedInvTau);
+    TrackTiler tiler2;
+    tiler2.setTrack(way2);
+    size_t nTiledPts = way2.pts.size(), sink = 0;
+    LatencyStats tail;
+    for(int ii = 0; ii < nappend; ++ii) {
+      tail.time([&](){
+        way2.pts.push_back(src[npts + ii]);
+        way2.stats.update(way2.pts, true, true, speedInvTau);
+        if(way2.pts.size() - nTiledPts >= TrackMarker::MAX_TAIL_PTS) {
+          tiler2.setTrack(way2);
+          nTiledPts = way2.pts.size();
+        }
+        else {
+          std::vector<LngLat> pts;
+          for(size_t jj = nTiledPts - 1; jj < way2.pts.size(); ++jj)
+            pts.push_back(way2.pts[jj].lngLat());
+          sink += pts.size();
+        }
+      });
+    }
+    tail.report("append w/ tail per point");
+    printf("  mean per point: full rebuild %.3f ms, append %.3f ms (%lld tail points)\n",
+        full.mean(), tail.mean(), (long long)sink);
+    benchCheck(tail.mean() < full.mean(), "append path cheaper per point than full rebuild");
+  }
+}
+
+// std::get_time and strftime, as used for GPX times before parseGpxTime and formatGpxTime
+static double parseTimeStd(const char* s)
+{
+  if(!s || !s[0]) return 0;
+  std::tm tmb;
+  std::stringstream(s) >> std::get_time(&tmb, "%Y-%m-%dT%TZ");
+  return timegm(&tmb);
+}
+
+static size_t formatTimeStd(char* buf, double time)
+{
+  time_t t = time_t(time);
+  struct tm tmb;
+  return strftime(buf, 32, "%FT%TZ", gmtime_r(&t, &tmb));
+}
+
+BENCHMARK(gpxtime)
+{
+  int n = int(benchOptList("points", "1M").front());
+  std::mt19937 rng(45);
+  std::uniform_int_distribution<int64_t> dist(946684800000LL, 2524608000000LL);  // 2000 - 2050 in ms
+  std::vector<double> times;
+  std::vector<std::string> strs[2];  // whole seconds (as std::get_time supports) and w/ milliseconds
+  char buf[32];
+  for(int ii = 0; ii < n; ++ii) {
+    times.push_back(dist(rng)/1000.0);
+    strs[0].push_back(formatGpxTime(buf, std::floor(times.back())));
+    strs[1].push_back(formatGpxTime(buf, times.back()));
+  }
+
+  double sink = 0;
+  auto timeEach = [&](const char* label, const std::function<double(int)>& fn){
+    int64_t t0 = benchTimeUs();
+    for(int ii = 0; ii < n; ++ii) { sink += fn(ii); }
+    printf("  %-36s %8.1f ns/time\n", label, 1000.0*(benchTimeUs() - t0)/n);
+  };
+  printf(" %d times\n", n);
+  timeEach("std::get_time", [&](int ii){ return parseTimeStd(strs[0][ii].c_str()); });
+  timeEach("parseGpxTime", [&](int ii){ return parseGpxTime(strs[0][ii].c_str()); });
+  timeEach("parseGpxTime (ms)", [&](int ii){ return parseGpxTime(strs[1][ii].c_str()); });
+  timeEach("strftime", [&](int ii){ return formatTimeStd(buf, times[ii]); });
+  timeEach("formatGpxTime", [&](int ii){ return formatGpxTime(buf, times[ii])[0]; });
+
+  int mismatch = 0;
+  for(int ii = 0; ii < n; ++ii) {
+    mismatch += parseGpxTime(strs[0][ii].c_str()) != parseTimeStd(strs[0][ii].c_str());
+    formatTimeStd(buf, times[ii]);
+    mismatch += strs[0][ii] != buf;
+  }
+  benchCheck(mismatch == 0, "parseGpxTime and formatGpxTime match std::get_time and strftime");
+  if(!sink) { printf("  (no times)\n"); }
+}
+
+// pugixml DOM loading and saving of track points, as used for GPX before streaming parser and writer
+static Waypoint loadWaypointDOM(const pugi::xml_node& trkpt)
+{
+  double lat = trkpt.attribute("lat").as_double();
+  double lng = trkpt.attribute("lon").as_double();
+  double ele = atof(trkpt.child_value("ele"));
+  float speed = atof(trkpt.child_value("speed"));
+  float course = atof(trkpt.child_value("course"));
+  double time = parseGpxTime(trkpt.child_value("time"));
+  return Waypoint({time, lat, lng, 0, ele, 0, course, 0, speed, 0}, trkpt.child_value("name"), trkpt.child_value("desc"));
+}
+
+static bool loadGPXDOM(GpxFile* track)
+{
+  pugi::xml_document doc;
+  doc.load_file(track->filename.c_str());
+  pugi::xml_node gpx = doc.child("gpx");
+  if(!gpx) { return false; }
+  for(pugi::xml_node trk = gpx.child("trk"); trk; trk = trk.next_sibling("trk")) {
+    track->tracks.emplace_back(trk.child_value("name"), trk.child_value("desc"));
+    for(pugi::xml_node seg = trk.child("trkseg"); seg; seg = seg.next_sibling("trkseg")) {
+      for(pugi::xml_node trkpt = seg.child("trkpt"); trkpt; trkpt = trkpt.next_sibling("trkpt"))
+        track->tracks.back().pts.push_back(loadWaypointDOM(trkpt));
+    }
+  }
+  return true;
+}
+
+static bool saveGPXDOM(GpxFile* track, const char* filename)
+{
+  char timebuf[32];
+  pugi::xml_document doc;
+  pugi::xml_node gpx = doc.append_child("gpx");
+  gpx.append_attribute("version").set_value("1.1");
+  gpx.append_attribute("creator").set_value("Ascend Maps");
+  gpx.append_attribute("xmlns").set_value("http://www.topografix.com/GPX/1/1");
+  for(const GpxWay& t : track->tracks) {
+    pugi::xml_node trk = gpx.append_child("trk");
+    trk.append_child("name").append_child(pugi::node_pcdata).set_value(t.title.c_str());
+    pugi::xml_node seg = trk.append_child("trkseg");
+    for(const Waypoint& wpt : t.pts) {
+      pugi::xml_node trkpt = seg.append_child("trkpt");
+      trkpt.append_attribute("lat").set_value(fstring("%.7f", wpt.loc.lat).c_str());
+      trkpt.append_attribute("lon").set_value(fstring("%.7f", wpt.loc.lng).c_str());
+      trkpt.append_child("ele").append_child(pugi::node_pcdata).set_value(fstring("%.1f", wpt.loc.alt).c_str());
+      if(track->hasSpeed)
+        trkpt.append_child("speed").append_child(pugi::node_pcdata).set_value(fstring("%.2f", wpt.loc.spd).c_str());
+      trkpt.append_child("time").append_child(pugi::node_pcdata).set_value(formatGpxTime(timebuf, wpt.loc.time));
+    }
+  }
+  return doc.save_file(filename, "  ");
+}
+
+// streaming loadGPX()/saveGPX() vs. pugixml DOM: time and peak memory above baseline for a single track
+BENCHMARK(gpxio)
+{
+  for(int64_t npts : benchOptList("sizes", "1M")) {
+    printf(" %lld points\n", (long long)npts);
+    std::string path = fstring("%s/track-%lld.gpx", benchTempDir().c_str(), (long long)npts);
+    std::string dompath = fstring("%s/track-%lld-dom.gpx", benchTempDir().c_str(), (long long)npts);
+    int64_t t0, rss0;
+    {
+      GpxFile gpx("Synthetic", "", path);
+      gpx.hasSpeed = true;
+      gpx.tracks.emplace_back("Synthetic", "");
+      gpx.tracks.back().pts = syntheticTrack(npts, 44);
+      t0 = benchTimeUs();
+      benchCheck(saveGPX(&gpx), "saveGPX");
+      printf("  %-36s %8.1f ms\n", "saveGPX (streaming)", (benchTimeUs() - t0)/1000.0);
+      benchResetPeakRSS();
+      rss0 = benchRSSKB();
+      t0 = benchTimeUs();
+      benchCheck(saveGPXDOM(&gpx, dompath.c_str()), "save GPX w/ DOM");
+      printf("  %-36s %8.1f ms, peak +%lld KB\n", "save w/ pugixml DOM", (benchTimeUs() - t0)/1000.0,
+          (long long)(benchPeakRSSKB() - rss0));
+    }
+    struct stat st;
+    printf("  GPX file %.1f MB\n", stat(path.c_str(), &st) == 0 ? st.st_size/1E6 : 0.0);
+
+    size_t npts0 = 0, npts1 = 0;
+    int64_t peak0 = 0, peak1 = 0;
+    {
+      GpxFile gpx("", "", path);
+      benchResetPeakRSS();
+      rss0 = benchRSSKB();
+      t0 = benchTimeUs();
+      benchCheck(loadGPX(&gpx), "loadGPX");
+      peak0 = benchPeakRSSKB() - rss0;
+      npts0 = gpx.tracks.empty() ? 0 : gpx.tracks.front().pts.size();
+      printf("  %-36s %8.1f ms, peak +%lld KB\n", "loadGPX (streaming)", (benchTimeUs() - t0)/1000.0, (long long)peak0);
+    }
+    {
+      GpxFile gpx("", "", path);
+      benchResetPeakRSS();
+      rss0 = benchRSSKB();
+      t0 = benchTimeUs();
+      benchCheck(loadGPXDOM(&gpx), "load GPX w/ DOM");
+      peak1 = benchPeakRSSKB() - rss0;
+      npts1 = gpx.tracks.empty() ? 0 : gpx.tracks.front().pts.size();
+      printf("  %-36s %8.1f ms, peak +%lld KB\n", "load w/ pugixml DOM", (benchTimeUs() - t0)/1000.0, (long long)peak1);
+    }
+    benchCheck(npts0 == size_t(npts) && npts1 == size_t(npts), "all points loaded");
+    benchCheck(peak0 < peak1, "streaming load peak memory below DOM");
+    removeFile(path);
+    removeFile(dompath);
+  }
+}
+
+// memory for track points as Waypoint vector vs. TrackColumns (GpxWay::compact()), from memUsage() and RSS
+BENCHMARK(trackmem)
+{
+  for(int64_t npts : benchOptList("sizes", "100k,1M")) {
+    printf(" %lld points\n", (long long)npts);
+    int64_t rss0 = benchRSSKB();
+    GpxWay way("Synthetic", "");
+    way.pts = syntheticTrack(npts, 46);
+    for(size_t ii = 0; ii < way.pts.size(); ii += 10000)
+      way.pts[ii].name = fstring("Waypoint %d", int(ii/10000));
+    int64_t rssPts = benchRSSKB() - rss0;
+    size_t bytesPts = way.pts.capacity()*sizeof(Waypoint);
+
+    double sink = 0;
+    int64_t t0 = benchTimeUs();
+    for(size_t ii = 0; ii < way.size(); ++ii) { sink += way.lngLat(ii).latitude; }
+    double scanPts = double(benchTimeUs() - t0)/npts;
+
+    t0 = benchTimeUs();
+    benchCheck(way.compact(), "compact()");
+    double compactMs = (benchTimeUs() - t0)/1000.0;
+    int64_t rssCols = benchRSSKB() - rss0;
+    size_t bytesCols = way.cols.memUsage();
+
+    t0 = benchTimeUs();
+    for(size_t ii = 0; ii < way.size(); ++ii) { sink += way.lngLat(ii).latitude; }
+    double scanCols = double(benchTimeUs() - t0)/npts;
+
+    t0 = benchTimeUs();
+    way.expand();
+    double expandMs = (benchTimeUs() - t0)/1000.0;
+
+    printf("  Waypoint vector: %.1f MB (%.0f bytes/point), RSS +%.1f MB\n",
+        bytesPts/1E6, double(bytesPts)/npts, rssPts/1E3);
+    printf("  TrackColumns:    %.1f MB (%.0f bytes/point), RSS +%.1f MB\n",
+        bytesCols/1E6, double(bytesCols)/npts, rssCols/1E3);
+    printf("  compact() %.1f ms, expand() %.1f ms; lngLat() scan %.2f ns/point for Waypoints, %.2f ns/point for columns\n",
+        compactMs, expandMs, scanPts*1000, scanCols*1000);
+    if(!sink) { printf("  (no points)\n"); }
+    benchCheck(bytesCols*4 < bytesPts, "columnar storage less than 1/4 of Waypoint vector");
+    benchCheck(way.size() == size_t(npts) && way.pts[10000].name == "Waypoint 1", "expand() restores points");
+  }
+}
+
+// tracks list from places DB w/ persisted track_summary (MapsTracks::loadTracks() and populateArchived()) vs.
+//  loading every GPX file to get summary, as needed before track_summary
+BENCHMARK(tracklist)
+{
+  int trackPts = atoi(benchOpt("track-pts", "200").c_str());
+  double listBudgetMs = atof(benchOpt("list-ms", "100").c_str());
+  for(int64_t ntracks : benchOptList("tracks", "5000")) {
+    printf(" %lld tracks of %d points\n", (long long)ntracks, trackPts);
+    std::string dir = fstring("%s/tracks-%lld", benchTempDir().c_str(), (long long)ntracks);
+    std::string dbpath = dir + "/places.sqlite";
+    mkdir(dir.c_str(), 0755);
+    removeFile(dbpath);
+    SQLiteDB db;
+    if(db.open(dbpath, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE) != SQLITE_OK) {
+      benchCheck(false, "create places DB");
+      continue;
+    }
+    // from MapsTracks::createPanel()
+    db.exec("CREATE TABLE IF NOT EXISTS tracks(title TEXT, filename TEXT, style TEXT,"
+        " notes TEXT, timestamp INTEGER DEFAULT (CAST(strftime('%s') AS INTEGER)), archived INTEGER DEFAULT 0);");
+    db.exec("CREATE TABLE IF NOT EXISTS track_summary(track_id INTEGER PRIMARY KEY,"
+        " gpx_mtime INTEGER, gpx_size INTEGER, npts INTEGER, dist REAL, duration REAL, ascent REAL, descent REAL,"
+        " start_time REAL, min_lng REAL, min_lat REAL, max_lng REAL, max_lat REAL);");
+
+    // tracks spread over ~200 km like a user's archive
+    std::mt19937 rng(48);
+    std::uniform_real_distribution<double> offset(-1, 1);
+    double speedInvTau = 0.5;
+    int64_t t0 = benchTimeUs();
+    db.exec("BEGIN;");
+    auto trackStmt = db.stmt("INSERT INTO tracks (title, filename, timestamp, archived) VALUES (?,?,?,1);");
+    auto summaryStmt = db.stmt("INSERT OR REPLACE INTO track_summary (track_id, gpx_mtime, gpx_size, npts, dist,"
+        " duration, ascent, descent, start_time, min_lng, min_lat, max_lng, max_lat) VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?);");
+    for(int64_t ii = 0; ii < ntracks; ++ii) {
+      GpxFile gpx(fstring("Track %lld", (long long)ii), "", fstring("%s/track%lld.gpx", dir.c_str(), (long long)ii));
+      gpx.tracks.emplace_back(gpx.title, "");
+      gpx.tracks.back().pts = syntheticTrack(trackPts, unsigned(ii), LngLat(-122.4 + offset(rng), 37.8 + offset(rng)));
+      gpx.timestamp = gpx.tracks.back().pts.front().loc.time;
+      saveGPX(&gpx);
+      trackStmt.bind(gpx.title, gpx.filename, int64_t(gpx.timestamp)).exec();
+      const TrackSummary s = calcTrackSummary(&gpx, speedInvTau);
+      summaryStmt.bind(int64_t(sqlite3_last_insert_rowid(db.db)), s.gpxMTime, s.gpxSize, s.npts, s.dist, s.duration, s.ascent,
+          s.descent, s.startTime, s.minLngLat.longitude, s.minLngLat.latitude, s.maxLngLat.longitude,
+          s.maxLngLat.latitude).exec();
+    }
+    db.exec("COMMIT;");
+    printf("  created tracks in %.1f s\n", (benchTimeUs() - t0)/1E6);
+
+    // loadTracks() + sort by date (populateArchived()) + build index (updateTracksIndex())
+    std::list<GpxFile> tracks;
+    LatencyStats list;
+    list.time([&](){
+      const char* query = "SELECT t.rowid, t.title, t.filename, t.notes, t.style, t.timestamp, IFNULL(s.npts, -1),"
+          " s.gpx_mtime, s.gpx_size, s.dist, s.duration, s.ascent, s.descent, s.start_time,"
+          " s.min_lng, s.min_lat, s.max_lng, s.max_lat FROM tracks AS t"
+          " LEFT JOIN track_summary AS s ON s.track_id = t.rowid WHERE t.archived = ? ORDER BY t.timestamp;";
+      SQLiteStmt(db.db, query).bind(true).exec([&](int rowid, std::string title, std::string filename,
+          const char* desc, const char* style, int64_t timestamp, int64_t npts, int64_t mtime, int64_t size,
+          double dist, double duration, double ascent, double descent, double starttime,
+          double lng0, double lat0, double lng1, double lat1) {
+        tracks.emplace_back(title, desc ? desc : "", filename, style ? style : "", rowid, true);
+        GpxFile& track = tracks.back();
+        track.timestamp = double(timestamp);
+        TrackSummary& s = track.summary;
+        s.npts = npts;  s.gpxMTime = mtime;  s.gpxSize = size;
+        s.dist = dist;  s.duration = duration;  s.ascent = ascent;  s.descent = descent;  s.startTime = starttime;
+        s.minLngLat = LngLat(lng0, lat0);  s.maxLngLat = LngLat(lng1, lat1);
+      });
+    });
+    list.report("load list from DB");
+
+    std::vector<GpxFile*> sorted;
+    LatencyStats sort;
+    sort.time([&](){
+      auto trackDate = [](const GpxFile* t){ return t->summary.startTime > 0 ? t->summary.startTime : t->timestamp; };
+      for(GpxFile& track : tracks) { sorted.push_back(&track); }
+      std::sort(sorted.begin(), sorted.end(), [&](const GpxFile* a, const GpxFile* b){ return trackDate(a) > trackDate(b); });
+      std::sort(sorted.begin(), sorted.end(), [](const GpxFile* a, const GpxFile* b){ return a->summary.dist > b->summary.dist; });
+    });
+    sort.report("sort by date and distance");
+
+    BoxIndex index;
+    std::vector<GpxFile*> indexed;
+    LatencyStats build;
+    build.time([&](){
+      std::vector<BoxIndex::Box> boxes;
+      for(GpxFile* track : sorted) { boxes.emplace_back(track->summary.minLngLat, track->summary.maxLngLat); }
+      for(size_t ii : BoxIndex::sortSTR(boxes)) {
+        index.append(boxes[ii]);
+        indexed.push_back(sorted[ii]);
+      }
+    });
+    build.report("build tracks index");
+
+    // "tracks in map area" filter for random ~20 km viewports
+    LatencyStats filter;
+    size_t nfound = 0;
+    for(int ii = 0; ii < 200; ++ii) {
+      LngLat ll00(-122.4 + offset(rng) - 0.1, 37.8 + offset(rng) - 0.1), ll11(ll00.longitude + 0.2, ll00.latitude + 0.2);
+      filter.time([&](){
+        index.search(BoxIndex::Box(ll00, ll11), [&](size_t jj){ nfound += indexed[jj]->summary.intersects(ll00, ll11); });
+      });
+    }
+    filter.report("map area filter");
+    double listMs = list.mean() + sort.mean() + build.mean() + filter.mean();
+    printf("  total %.1f ms for list, sort, and filter (%.1f tracks per viewport)\n", listMs, nfound/200.0);
+    benchCheck(listMs < listBudgetMs, fstring("list, sort, and filter %lld tracks within %.0f ms",
+        (long long)ntracks, listBudgetMs).c_str());
+
+    // before track_summary: each GPX file loaded to get distance, date, and bounds
+    LatencyStats gpxload;
+    gpxload.time([&](){
+      for(GpxFile& track : tracks) {
+        GpxFile gpx(track.title, "", track.filename);
+        loadGPX(&gpx);
+        track.summary = calcTrackSummary(&gpx, speedInvTau);
+      }
+    });
+    gpxload.report("load all GPX for summaries");
+    printf("  summary table vs. loading GPX: %.0fx faster\n", gpxload.mean()/std::max(0.001, list.mean() + sort.mean()));
+
+    sqlite3_close(db.release());
+    for(int64_t ii = 0; ii < ntracks; ++ii)
+      removeFile(fstring("%s/track%lld.gpx", dir.c_str(), (long long)ii));
+    removeFile(dbpath);
+    rmdir(dir.c_str());
+  }
+}
+
+// tap picking and viewport queries over many tracks: global index of track bounds (MapsTracks::findTracks())
+//  plus per-track TrackSegIndex (nearestTrack()) vs. scanning all points of all tracks
+BENCHMARK(trackpick)
+{
+  int trackPts = atoi(benchOpt("track-pts", "500").c_str());
+  int ntaps = atoi(benchOpt("taps", "100").c_str());
+  double maxDist = 0.05;  // km, ~10 px at zoom 15
+  for(int64_t ntracks : benchOptList("tracks", "1000,5000")) {
+    printf(" %lld tracks of %d points\n", (long long)ntracks, trackPts);
+    std::mt19937 rng(49);
+    std::uniform_real_distribution<double> offset(-1, 1);
+    std::vector<GpxWay> ways(ntracks);
+    std::vector<BoxIndex::Box> bounds(ntracks);
+    for(int64_t ii = 0; ii < ntracks; ++ii) {
+      ways[ii].pts = syntheticTrack(trackPts, unsigned(ii), LngLat(-122.4 + offset(rng), 37.8 + offset(rng)));
+      for(const Waypoint& wpt : ways[ii].pts) { bounds[ii].add(BoxIndex::Box(wpt.lngLat())); }
+      ways[ii].compact();
+    }
+
+    LatencyStats build;
+    BoxIndex index;
+    std::vector<size_t> order;
+    build.time([&](){
+      order = BoxIndex::sortSTR(bounds);
+      for(size_t ii : order) { index.append(bounds[ii]); }
+    });
+    build.report("build tracks index");
+    LatencyStats segbuild;
+    segbuild.time([&](){
+      for(GpxWay& way : ways) { way.segIndex.nearest(way, way.lngLat(0), maxDist); }
+    });
+    segbuild.report("build all segment indexes");
+
+    // taps near random points of random tracks, and some in empty areas
+    std::uniform_int_distribution<int64_t> trackDist(0, ntracks - 1);
+    std::uniform_int_distribution<int> ptDist(0, trackPts - 1);
+    std::uniform_real_distribution<double> jitter(-3E-4, 3E-4);
+    LatencyStats linear, indexed;
+    int mismatch = 0, hits = 0;
+    for(int ii = 0; ii < ntaps; ++ii) {
+      LngLat pos;
+      if(ii%4 == 3)
+        pos = LngLat(-122.4 + 1.5*offset(rng), 37.8 + 1.5*offset(rng));
+      else {
+        LngLat r = ways[trackDist(rng)].lngLat(ptDist(rng));
+        pos = LngLat(r.longitude + jitter(rng), r.latitude + jitter(rng));
+      }
+      double best0 = maxDist, best1 = maxDist;
+      linear.time([&](){
+        for(GpxWay& way : ways) {
+          for(size_t jj = 0; jj < way.size(); ++jj)
+            best0 = std::min(best0, lngLatDist(way.lngLat(jj), pos));
+        }
+      });
+      indexed.time([&](){
+        double dlat = maxDist/111.2;
+        double dlng = dlat/std::max(0.01, std::cos(pos.latitude*M_PI/180));
+        BoxIndex::Box q(LngLat(pos.longitude - dlng, pos.latitude - dlat), LngLat(pos.longitude + dlng, pos.latitude + dlat));
+        index.search(q, [&](size_t jj){
+          GpxWay& way = ways[order[jj]];
+          if(!bounds[order[jj]].intersects(q)) { return; }
+          int idx = way.segIndex.nearest(way, pos, best1);
+          if(idx >= 0) { best1 = std::min(best1, lngLatDist(way.lngLat(idx), pos)); }
+        });
+      });
+      hits += best0 < maxDist;
+      mismatch += std::abs(best0 - best1) > 1E-9;
+    }
+    linear.report("tap: scan all points");
+    indexed.report("tap: indexes");
+    printf("  %d of %d taps within %.0f m of a track\n", hits, ntaps, maxDist*1000);
+    benchCheck(mismatch == 0, "indexed nearest point matches full scan");
+
+    // viewport queries (tracks list filter)
+    LatencyStats vlinear, vindexed;
+    mismatch = 0;
+    for(int ii = 0; ii < 200; ++ii) {
+      LngLat ll00(-122.4 + offset(rng) - 0.1, 37.8 + offset(rng) - 0.1), ll11(ll00.longitude + 0.2, ll00.latitude + 0.2);
+      BoxIndex::Box q(ll00, ll11);
+      size_t n0 = 0, n1 = 0;
+      vlinear.time([&](){ for(const BoxIndex::Box& b : bounds) { n0 += b.intersects(q); } });
+      vindexed.time([&](){ index.search(q, [&](size_t jj){ n1 += bounds[order[jj]].intersects(q); }); });
+      mismatch += n0 != n1;
+    }
+    vlinear.report("viewport: scan all tracks");
+    vindexed.report("viewport: index");
+    benchCheck(mismatch == 0, "indexed viewport query matches full scan");
+  }
+}
+
+// TrackPlot refresh: PlotSeries min/max pyramid vs. full-length Path2D decimated on every draw (sparseDrawPath()
+//  before PlotSeries) for full, 10%, and 1% x ranges of altitude vs. distance
+BENCHMARK(plotrefresh)
+{
+  real npx = real(atof(benchOpt("width", "800").c_str()));
+  for(int64_t npts : benchOptList("sizes", "100k,1M")) {
+    printf(" %lld points\n", (long long)npts);
+    std::vector<Waypoint> locs = syntheticTrack(npts, 50);
+    TrackStats stats;
+    stats.update(locs, true, true, 0.5);
+
+    // TrackPlot::setTrack()
+    Path2D fullPath;
+    PlotSeries series;
+    LatencyStats buildFull, buildSeries;
+    buildFull.time([&](){
+      for(const Waypoint& wpt : locs) { fullPath.addPoint(wpt.dist, wpt.loc.alt); }
+    });
+    buildSeries.time([&](){
+      for(const Waypoint& wpt : locs) { series.addPoint(wpt.dist, wpt.loc.alt); }
+      series.update();
+    });
+    buildFull.report("setTrack: full Path2D");
+    buildSeries.report("setTrack: PlotSeries");
+
+    std::mt19937 rng(50);
+    double maxDist = locs.back().dist;
+    for(double frac : {1.0, 0.1, 0.01}) {
+      LatencyStats full, pyramid;
+      size_t nfull = 0, npyramid = 0;
+      int bad = 0;
+      for(int ii = 0; ii < 20; ++ii) {
+        real x0 = real(std::uniform_real_distribution<double>(0, maxDist*(1 - frac))(rng));
+        real x1 = real(x0 + maxDist*frac);
+        real xscale = npx/(x1 - x0);
+        // sparseDrawPath() iterated over all points, skipping those < 0.5 px from previous
+        std::vector<Point> drawn;
+        full.time([&](){
+          int previdx = 0;
+          drawn.push_back(fullPath.point(0));
+          for(int jj = 1; jj < fullPath.size(); ++jj) {
+            if((fullPath.point(jj).x - fullPath.point(previdx).x)*xscale > 0.5) {
+              drawn.push_back(fullPath.point(jj));
+              previdx = jj;
+            }
+          }
+        });
+        Path2D path;
+        pyramid.time([&](){ series.getPath(path, x0, x1, npx); });
+        nfull += drawn.size();
+        npyramid += path.size();
+        // pyramid must preserve extremes of points in range
+        real ymin = FLT_MAX, ymax = -FLT_MAX, pmin = FLT_MAX, pmax = -FLT_MAX;
+        for(const Waypoint& wpt : locs) {
+          if(wpt.dist < x0 || wpt.dist > x1) { continue; }
+          ymin = std::min(ymin, real(wpt.loc.alt));
+          ymax = std::max(ymax, real(wpt.loc.alt));
+        }
+        for(int jj = 0; jj < path.size(); ++jj) {
+          pmin = std::min(pmin, path.point(jj).y);
+          pmax = std::max(pmax, path.point(jj).y);
+        }
+        bad += pmin > ymin + 1E-3 || pmax < ymax - 1E-3 || path.size() > 2*npx + 8;
+      }
+      full.report(fstring("refresh %g%%: full path", frac*100).c_str());
+      pyramid.report(fstring("refresh %g%%: pyramid", frac*100).c_str());
+      printf("  path points per refresh: full %.0f, pyramid %.0f\n", nfull/20.0, npyramid/20.0);
+      benchCheck(bad == 0, fstring("pyramid path for %g%% range keeps min/max w/ <= 2 points per pixel", frac*100).c_str());
+    }
+
+    // recording: TrackPlot::appendTrack() replaces last point and adds new one
+    std::vector<Waypoint> more = syntheticTrack(1000, 51, locs.back().lngLat());
+    LatencyStats append;
+    double dist = maxDist;
+    for(const Waypoint& wpt : more) {
+      append.time([&](){
+        series.truncate(series.size() - 1);
+        series.addPoint(dist, wpt.loc.alt);
+        series.addPoint(dist + 1, wpt.loc.alt);
+        series.update();
+      });
+      dist += 1;
+    }
+    append.report("append point while recording");
+  }
+}
@@ -8,7 +8,9 @@ add_library(maps-app
   app/src/touchhandler.cpp
   app/src/tracks.cpp
   app/src/trackwidgets.cpp
+  app/src/plotseries.cpp
   app/src/gpxfile.cpp
+  app/src/searchdb.cpp
   app/src/util.cpp
   app/src/plugins.cpp
   app/src/mapwidgets.cpp
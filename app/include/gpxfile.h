@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cfloat>
 #include "mapscomponent.h"
 #include "ulib/platformutil.h"
 
@@ -38,14 +39,164 @@ struct Waypoint
   LngLat lngLat() const { return loc.lngLat(); }
 };
 
+// incremental track statistics - update() only processes points added since the previous call (plus the
+//  previous last point, which is handled specially), or points after the nearest checkpoint preceding an
+//  index passed to invalidate(), giving the same result as processing all points
+struct TrackStats
+{
+  struct State {
+    size_t next = 1;  // index of next point to process
+    size_t prevDistLoc = 0, prevVertLoc = 0;
+    double trackDist = 0, rawDist = 0, movingTime = 0, movingTimeGps = 0;
+    double trackAscent = 0, trackDescent = 0, ascentTime = 0, descentTime = 0;
+    double estSpeed = 0, maxSpeed = 0;
+  };
+
+  State res;
+
+  // sets Waypoint::dist for all points and Location::spd if !hasSpeed
+  void update(std::vector<Waypoint>& locs, bool isTrack, bool hasSpeed, double speedInvTau);
+  // call when points at index >= idx have been changed, inserted, or removed
+  void invalidate(size_t idx = 0) { dirtyIdx = std::min(dirtyIdx, idx); }
+
+private:
+  static constexpr size_t CHECKPOINT_STEP = 256;
+  std::vector<State> checkpoints;  // checkpoints[k] is state before processing point (k+1)*CHECKPOINT_STEP
+  State lastState;  // state before processing last point
+  size_t dirtyIdx = 0;
+  size_t npts = 0;
+  // to detect changes to points w/o call to invalidate()
+  double lastTime = 0;
+  LngLat lastPos;
+  bool isTrack = false;
+  bool hasSpeed = false;
+  double speedInvTau = 0;
+};
+
+// Douglas-Peucker simplification for all tolerances at once: point ii is retained in simplified track for
+//  any tolerance (in projected meters) less than tols[ii]; recalculated if track endpoints or size change or
+//  after invalidate(), which must be called for edits that keep both (e.g. reversing a loop)
+struct GpxWay;
+struct TrackSimplifier
+{
+  const std::vector<float>& levels(const GpxWay& way);
+  void invalidate() { tols.clear(); }
+
+private:
+  std::vector<float> tols;
+  LngLat ends[2];
+};
+
+// compact structure-of-arrays storage for points of inactive tracks: coordinates are int32 in units of 1E-7
+//  degrees (same precision as saved GPX) and time is int32 ms offset from first point; other columns are only
+//  allocated if some point has a nonzero value; points w/ name, desc, etc. are stored separately; dist is not
+//  stored since it is recalculated by TrackStats
+struct TrackColumns
+{
+  std::vector<int32_t> lat, lng, dtime;
+  std::vector<float> alt, spd, dir, poserr, alterr;
+  std::vector<std::pair<size_t, Waypoint>> extras;  // sorted by index
+  double time0 = 0;
+
+  size_t size() const { return lat.size(); }
+  LngLat lngLat(size_t ii) const { return LngLat(lng[ii]*1E-7, lat[ii]*1E-7); }
+  Waypoint get(size_t ii) const;
+  bool encode(const std::vector<Waypoint>& pts);
+  void decode(std::vector<Waypoint>& pts);
+  size_t memUsage() const;
+};
+
+// packed R-tree: items are grouped NODE_SIZE at a time in the order added, so they should be spatially
+//  coherent - consecutive track segments already are, other items can be ordered w/ sortSTR(); only boxes for
+//  groups of items are stored, so search() reports all items in intersecting groups and caller must test them
+struct BoxIndex
+{
+  struct Box {
+    double x0 = DBL_MAX, y0 = DBL_MAX, x1 = -DBL_MAX, y1 = -DBL_MAX;
+
+    Box() {}
+    Box(LngLat a) : x0(a.longitude), y0(a.latitude), x1(a.longitude), y1(a.latitude) {}
+    Box(LngLat a, LngLat b) : Box(a) { add(Box(b)); }
+    void add(const Box& b) {
+      x0 = std::min(x0, b.x0);  y0 = std::min(y0, b.y0);  x1 = std::max(x1, b.x1);  y1 = std::max(y1, b.y1);
+    }
+    bool intersects(const Box& b) const { return x0 <= b.x1 && x1 >= b.x0 && y0 <= b.y1 && y1 >= b.y0; }
+  };
+
+  size_t size() const { return nitems; }
+  void clear() { levels.clear();  nitems = 0; }
+  void append(const Box& b);
+  template<class Fn> void search(const Box& q, Fn&& fn) const;  // calls fn(item index)
+  // Sort-Tile-Recursive ordering of boxes
+  static std::vector<size_t> sortSTR(const std::vector<Box>& boxes);
+  // nodes can be saved and restored w/ setNodes() (e.g. in track cache) instead of rebuilding index
+  const std::vector< std::vector<Box> >& nodes() const { return levels; }
+  bool setNodes(std::vector< std::vector<Box> >&& nodes, size_t n);
+
+private:
+  static constexpr size_t NODE_SIZE = 16;
+  std::vector< std::vector<Box> > levels;  // levels[0][ii] bounds items ii*NODE_SIZE to (ii+1)*NODE_SIZE - 1
+  size_t nitems = 0;
+
+  template<class Fn> void searchNode(size_t level, size_t idx, const Box& q, Fn& fn) const;
+};
+
+template<class Fn> void BoxIndex::search(const Box& q, Fn&& fn) const
+{
+  if(levels.empty()) { return; }
+  for(size_t ii = 0; ii < levels.back().size(); ++ii)
+    searchNode(levels.size() - 1, ii, q, fn);
+}
+
+template<class Fn> void BoxIndex::searchNode(size_t level, size_t idx, const Box& q, Fn& fn) const
+{
+  if(!levels[level][idx].intersects(q)) { return; }
+  size_t end = std::min((idx + 1)*NODE_SIZE, level > 0 ? levels[level-1].size() : nitems);
+  for(size_t ii = idx*NODE_SIZE; ii < end; ++ii) {
+    if(level > 0)
+      searchNode(level - 1, ii, q, fn);
+    else
+      fn(ii);
+  }
+}
+
+// index of track segments for finding point nearest a location; points appended to track (e.g. while
+//  recording) are added incrementally, other changes to track cause the index to be rebuilt; index is saved
+//  in binary track cache, so it is only built when GPX is parsed
+struct TrackSegIndex
+{
+  // returns index of point nearest pos within maxDist (km), or -1 if none
+  int nearest(const GpxWay& way, LngLat pos, double maxDist);
+  // must be called if existing points are changed; appended points are indexed incrementally
+  void invalidate() { index.clear(); }
+  // index for all points of way, building it if needed
+  const BoxIndex& boxIndex(const GpxWay& way) { update(way);  return index; }
+  void restore(BoxIndex&& idx) { index = std::move(idx); }
+
+private:
+  void update(const GpxWay& way);
+  BoxIndex index;  // item ii is segment from point ii to ii+1
+};
+
 struct GpxWay
 {
   std::string title;
   std::string desc;
-  std::vector<Waypoint> pts;
+  std::vector<Waypoint> pts;  // empty if compacted
+  TrackColumns cols;
+  TrackStats stats;
+  TrackSimplifier simplifier;
+  TrackSegIndex segIndex;
 
   GpxWay() {}
   GpxWay(const std::string& _title, const std::string& _desc) : title(_title), desc(_desc) {}
+
+  // these work whether or not way is compacted
+  size_t size() const { return pts.empty() ? cols.size() : pts.size(); }
+  LngLat lngLat(size_t ii) const { return pts.empty() ? cols.lngLat(ii) : pts[ii].lngLat(); }
+  // compact() moves pts to cols (if they can be encoded); expand() must be called before accessing pts
+  bool compact();
+  void expand();
 };
 
 struct TrackMarker
@@ -57,6 +208,35 @@ struct TrackMarker
   ~TrackMarker();
   void setProperties(Properties&& props, bool replace = false);
   void setTrack(GpxWay* way, size_t nways = 1);
+  // track geometry is simplified to be visually lossless at this zoom (and below); <= 0 for full resolution
+  int simplifyZoom = defaultSimplifyZoom;
+  static int defaultSimplifyZoom;
+  // for points appended to last way (i.e. recording); regenerates tiles only every MAX_TAIL_PTS points
+  void appendTrack(GpxWay* way, size_t nways = 1);
+  static constexpr size_t MAX_TAIL_PTS = 256;
+
+private:
+  // points after those added to data source are drawn w/ a polyline marker
+  UniqueMarkerID tailMarker = 0;
+  size_t nTiledWays = 0;
+  size_t nTiledPts = 0;
+  bool hasTail = false;
+};
+
+// summary values stored in places DB (track_summary table) so track lists can be sorted and filtered w/o
+//  loading GPX; gpxMTime and gpxSize are used to detect changes to GPX file made outside the app
+struct TrackSummary
+{
+  LngLat minLngLat, maxLngLat;
+  double dist = 0, duration = 0, ascent = 0, descent = 0, startTime = 0;
+  int64_t gpxMTime = 0, gpxSize = 0;
+  int64_t npts = -1;  // < 0 if summary not available
+
+  bool valid() const { return npts >= 0; }
+  bool intersects(LngLat lngLat00, LngLat lngLat11) const {
+    return valid() && minLngLat.longitude <= lngLat11.longitude && maxLngLat.longitude >= lngLat00.longitude
+        && minLngLat.latitude <= lngLat11.latitude && maxLngLat.latitude >= lngLat00.latitude;
+  }
 };
 
 struct GpxFile
@@ -71,6 +251,7 @@ struct GpxFile
   std::vector<Waypoint> waypoints;
   std::vector<GpxWay> routes;
   std::vector<GpxWay> tracks;
+  TrackSummary summary;
 
   double timestamp = mSecSinceEpoch()/1000.0;
   int rowid = -1;
@@ -87,13 +268,23 @@ struct GpxFile
       : title(_title), desc(_desc), filename(_file), style(_style), rowid(_rowid), archived(_archived) {}
 
   GpxWay* activeWay() { return !routes.empty() ? &routes.back() : !tracks.empty()? &tracks.back() : NULL; }
+  void compact() { for(GpxWay& way : tracks) { way.compact(); } }
+  void expand() { for(GpxWay& way : tracks) { way.expand(); } }
 
   std::vector<Waypoint>::iterator findWaypoint(const std::string& uid);
   std::vector<Waypoint>::iterator addWaypoint(Waypoint wpt, const std::string& nextuid = {});
 };
 
-namespace pugi { class xml_node; }
-void saveWaypoint(pugi::xml_node trkpt, const Waypoint& wpt, bool savespd = false, bool savedist = false);
+void saveWaypoint(std::string& out, const char* tag, const Waypoint& wpt,
+    bool savespd = false, bool savedist = false, int depth = 0);
 bool loadGPX(GpxFile* track, const char* gpxSrc = NULL);
+bool loadGPXCached(GpxFile* track);  // track points are left compacted if loaded from cache
+void removeGPXCache(const std::string& gpxfile);
 bool saveGPX(GpxFile* track, const char* filename = NULL);
+// does not require track to be expanded; GPX file mtime and size are only set if file exists
+TrackSummary calcTrackSummary(GpxFile* track, double speedInvTau);
+bool gpxFileInfo(const std::string& filename, int64_t& mtime, int64_t& size);  // mtime in ns
 std::vector<Waypoint> decodePolylineStr(const std::string& encoded, double precision = 1E6);
+// ISO-8601 time <-> seconds since epoch; parse returns 0 if invalid, format buf must hold at least 32 chars
+double parseGpxTime(const char* s);
+const char* formatGpxTime(char* buf, double time);
@@ -110,6 +110,7 @@ public:
   LngLat pickResultCoord = {NAN, NAN};
   PickResultStepper pickResultStepper;
   LngLat tapLocation = {NAN, NAN};
+  bool tapPickedFeature = false;  // tap hit a map feature which was not handled
   bool searchActive = false;
   int placeInfoProviderIdx = 0;
   //int gpsSatsUsed = 0;
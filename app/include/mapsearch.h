@@ -3,11 +3,14 @@
 #include "mapscomponent.h"
 #include "scene/filters.h"
 #include "util/asyncWorker.h"
+#include <set>
 
 using Tangram::TileTask;
 using Tangram::AsyncWorker;
 class MarkerGroup;
 class SQLiteDB;
+struct Timer;
+struct GpxFile;
 
 namespace YAML { class Node; }
 
@@ -33,6 +36,7 @@ public:
   void clearSearch();
   void addListResult(int64_t id, double lng, double lat, float rank, const char* json);
   void addMapResult(int64_t id, double lng, double lat, float rank, const char* json);
+  void replaceCachedResults(int flags);
   void searchPluginError(const char* err);
 
   enum SearchPhase { NO_SEARCH = 0, EDITING, RETURN, REFRESH };
@@ -40,10 +44,15 @@ public:
   void onMapEvent(MapEvent_t event);
   void resultsUpdated(int flags);
   void doSearch(std::string query);
+  void reverseGeocode(LngLat pos, double radius);
+  void cancelReverseGeocode() { ++placeSearchGen; }
+  void initPersonalIndex();
+  static void indexTrack(const GpxFile* track);
 
   Button* createPanel();
   Widget* searchPanel = NULL;
   std::unique_ptr<MarkerGroup> markers;
+  std::unique_ptr<MarkerGroup> clusterMarkers;
   int providerIdx = 0;
   bool moreMapResultsAvail = false;
   bool moreListResultsAvail = false;
@@ -52,10 +61,15 @@ public:
   enum { MAP_SEARCH = 0x1, LIST_SEARCH = 0x2, SORT_BY_DIST = 0x4, FLY_TO = 0x8, NEXTPAGE = 0x10,
          AUTOCOMPLETE = 0x20, PLACE_HISTORY = 0x40, UPDATE_RESULTS = 0x4000, MORE_RESULTS = 0x8000 };
   static constexpr size_t MAX_MAP_RESULTS = 1000;
+  static constexpr double MAX_REVERSE_GEOCODE_KM = 0.25;
 
   static void indexTileData(TileTask* task, int mapId, const std::vector<SearchData>& searchData);
   static void importPOIs(std::string srcuri, int offlineId);
   static void onDelOfflineMap(int mapId);
+  static bool hasTileData(Tangram::TileID tileId);
+  static void trimEphemeralTiles(int maxTiles);
+  static std::string shardFile(int mapId);
+  static constexpr int EPHEMERAL_MAP_ID = -2;  // offline_tiles.offline_id for tiles indexed from cache
   static std::vector<SearchData> parseSearchFields(const YAML::Node& node);
 
   static SQLiteDB searchDB;
@@ -63,11 +77,14 @@ public:
 private:
   std::vector<SearchResult> listResults;
   std::vector<SearchResult> mapResults;
+  std::vector<int> mapResultCounts;  // if not empty, mapResults[i] represents mapResultCounts[i] POIs
+  size_t mapResultOffset = 0;  // mapResults before this already have markers
 
   //float markerRadius = 50;  // in pixels
   float prevZoom = 0;
   LngLat dotBounds00, dotBounds11;
   std::string searchStr;
+  std::string searchQueryText;  // query as entered, for fuzzy search
   struct {
     bool autocomplete = false;
     bool unified = false;
@@ -76,19 +93,36 @@ private:
   } providerFlags;
   bool flyingToResults = false;
   bool newMapSearch = true;
+  bool newListSearch = false;
   bool isCurrLocDistOrigin = true;
   bool sortByDist = false;
   int selectedResultIdx = -1;
 
   AsyncWorker searchWorker = {"Ascend MapsSearch worker"};
+  // separate read connection for searchWorker so searches aren't blocked by indexing (searchDB is WAL)
+  std::unique_ptr<SQLiteDB> readDB;
+  LngLat readRankOrigin;  // osmSearchRank origin for readDB - only accessed on searchWorker thread
+  std::set<int> readShards;  // search shards attached to readDB
+  int readShardsVersion = -1;
+  bool readPersonal = false;  // places DB (personal data index) attached to readDB
   std::atomic_int_fast64_t mapSearchGen = {0};
   std::atomic_int_fast64_t listSearchGen = {0};
+  std::atomic_int_fast64_t placeSearchGen = {0};  // reverse geocode for long press
 
   bool initSearch();
+  std::vector<std::string> searchSchemas(SQLiteDB& db, bool trigram = false);
   void offlineListSearch(std::string queryStr, LngLat, LngLat, int flags = 0);
-  void offlineMapSearch(std::string queryStr, LngLat lnglat00, LngLat lngLat11);
+  void offlineAutocomplete(std::string query, std::string queryStr);
+  void autocompleteQuery(int64_t gen, std::string query, std::string queryStr, LngLat origin, bool bydist, int limit);
+  Timer* acTimer = NULL;
+  void indexViewportTiles();
+  void buildTagIndex();
+  LngLat ephemeralIndexCenter = {NAN, NAN};
+  void offlineMapSearch(std::string queryStr, LngLat lnglat00, LngLat lngLat11, float zoom);
   void updateMapResultBounds(LngLat lngLat00, LngLat lngLat11);
   void updateMapResults(LngLat lngLat00, LngLat lngLat11, int flags);
+  void postMapResults(int64_t gen, std::vector<SearchResult>&& res, bool first, int flags);
+  void postListResults(int64_t gen, std::vector<SearchResult>&& res, int flags);
   void clearSearchResults();
 
   // GUI
@@ -2,8 +2,11 @@
 
 #include "mapscomponent.h"
 
+#include <deque>
+
 struct OfflineMapInfo;
 class PlatformFile;
+namespace YAML { class Node; }
 
 class MapsOffline : public MapsComponent
 {
@@ -22,6 +25,8 @@ public:
   static void queueOfflineTask(int mapid, std::function<void()>&& fn);
   static int64_t shrinkCache(int64_t maxbytes);
   static void runSQL(std::string dbpath, std::string sql);
+  static void indexCachedTiles(std::string cacheFile, std::deque<Tangram::TileID> tiles,
+      std::shared_ptr<YAML::Node> searchYaml, int maxTiles);
 
   Widget* offlinePanel = NULL;
 
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include "ulib/path2d.h"
+
+// min/max pyramid so that drawing any x range of a series takes time proportional to plot width instead of
+//  number of points: bin j of level k holds min and max y of points j*4^k to (j+1)*4^k - 1; points can be
+//  added and removed at end (for recording), after which update() must be called; x must be nondecreasing
+class PlotSeries
+{
+public:
+  void clear() { xs.clear();  ys.clear();  levels.clear();  nValid = 0; }
+  void addPoint(real x, real y) { xs.push_back(x);  ys.push_back(y); }
+  void truncate(size_t n) { if(n < xs.size()) { xs.resize(n);  ys.resize(n);  nValid = std::min(nValid, n); } }
+  void update();
+  size_t size() const { return xs.size(); }
+  bool empty() const { return xs.empty(); }
+  void yRange(double& ymin, double& ymax) const;
+  // adds ~2 points per pixel (npx total) covering x range x0 to x1 to path
+  void getPath(Path2D& path, real x0, real x1, real npx) const;
+
+private:
+  static constexpr int SHIFT = 2;  // 4 bins (or points) per bin
+  struct Bin { float ymin = FLT_MAX, ymax = -FLT_MAX; };
+  std::vector<float> xs, ys;
+  std::vector< std::vector<Bin> > levels;  // levels[k-1] is level k
+  size_t nValid = 0;  // number of points (unchanged since) included in levels
+
+  Bin aggregate(size_t k, size_t j) const;
+};
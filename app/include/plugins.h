@@ -1,6 +1,7 @@
 #pragma once
 
 #include <list>
+#include <unordered_map>
 #include "mapscomponent.h"
 //#include "js/JavaScript.h"
 #include "duktape/duktape.h"
@@ -30,6 +31,8 @@ public:
   void jsSearch(int fnIdx, std::string queryStr, LngLat lngLat00, LngLat lngLat11, int flags);
   void jsPlaceInfo(int fnIdx, std::string props, Tangram::LngLat pos);
   void jsRoute(int fnIdx, std::string routeMode, const std::vector<LngLat>& waypts);
+  std::string getPlaceType(const Properties& props, const char* propstr);
+  std::vector<std::string> getPlaceTypes(const std::vector<Properties>& props, const std::vector<const char*>& propstrs);
   static bool dukTryCall(duk_context* ctx, int nargs);
 
   template <typename... Types>
@@ -63,6 +66,8 @@ public:
   struct UrlRequest { UrlReqType type; UrlRequestHandle handle; int serial; };
   std::list<UrlRequest> pendingRequests;
   std::string onMapEventFn;
+  bool nativePlaceType = false;  // getPlaceType() not overridden by a plugin, so native version can be used
+  std::unordered_map<std::string, std::string> placeTypeCache;
 
   static PluginManager* inst;
 };
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "util.h"
+#include <functional>
+
+// offline search DB schema and SQL helpers - no GUI dependencies, so also used by benchmarks (app/bench)
+
+extern const char* POI_SCHEMA;
+extern const char* TAG_SCHEMA;
+extern const char* MORTON_MIGRATION;
+extern const char* TRIGRAM_SCHEMA;
+extern const char* PERSONAL_SCHEMA;
+
+static constexpr int64_t PERSONAL_TRACK_ID = int64_t(1) << 40;  // personal_fts rowid = PERSONAL_TRACK_ID + tracks.rowid
+static constexpr int64_t PERSONAL_WAYPOINT_ID = int64_t(2) << 40;  // ... + (tracks.rowid << 16) + waypoint index
+static constexpr int PERSONAL_RANK_SCALE = 2;  // boost personal results relative to POIs
+
+static constexpr int AC_MAX_CANDIDATES = 2000;  // autocomplete candidates fetched for refining in memory
+static constexpr int FUZZY_MIN_RESULTS = 5;  // run fuzzy search if primary search returns fewer results
+static constexpr int FUZZY_MAX_CANDIDATES = 250;
+static constexpr float FUZZY_MIN_SIMILARITY = 0.5f;
+static constexpr int FUZZY_BUDGET_MS = 50;
+static constexpr double CLUSTER_CELL_PX = 64;
+
+// statements for inserting POIs and their tag postings into main DB or a shard
+struct PoiInsertStmts {
+  sqlite3_stmt* poi = NULL;
+  sqlite3_stmt* tag = NULL;
+  sqlite3_stmt* posting = NULL;
+  void finalize() { sqlite3_finalize(poi); sqlite3_finalize(tag); sqlite3_finalize(posting); }
+};
+
+std::string schemaSql(std::string sql, const std::string& schema);
+std::string unionSql(const std::vector<std::string>& schemas, const std::string& arm, const char* tail);
+std::string tagTokens(const std::string& value);
+bool preparePoiInsert(SQLiteDB& db, const std::string& schema, const std::string& poisql, PoiInsertStmts& st);
+void insertPoiTags(const PoiInsertStmts& st, int64_t poiId, int64_t tileId,
+    const std::vector<std::string>& fields, const Tangram::Properties& props);
+bool insertPoi(const PoiInsertStmts& st, const std::string& name, LngLat lnglat, int64_t tileId,
+    const std::vector<std::string>& fields, const Tangram::Properties& props);
+bool parseCategoryQuery(const std::string& queryStr, std::vector<std::string>& patterns);
+std::string tagMatchSql(const std::vector<std::string>& patterns, const std::vector<std::string>& tileRanges,
+    const char* nameParam);
+std::vector<std::string> tileRangeSql(LngLat lngLat00, LngLat lngLat11, int maxTiles, unsigned int zooms);
+std::vector<std::string> getTrigrams(const std::string& s);
+bool acTokenize(const std::string& s, std::vector<std::string>& tokens);
+bool acMatches(const std::vector<std::string>& words, const std::vector<std::string>& tokens);
+
+// offline search queries, used by MapsSearch and benchmarks; hasTags(schema) is true if schema has complete tag
+//  index, so categorical queries use it instead of FTS
+typedef std::function<bool(const std::string&)> SchemaFilter;
+std::string categoryUnionSql(const std::vector<std::string>& schemas, const SchemaFilter& hasTags,
+    const std::string& ftsArm, const std::string& tagArm, const char* tail, bool* usedTags = NULL);
+std::string mapSearchSql(const std::vector<std::string>& schemas, const SchemaFilter& hasTags,
+    const std::string& queryStr, LngLat lngLat00, LngLat lngLat11, unsigned int zooms, bool* usedTags = NULL);
+std::string clusterSearchSql(const std::vector<std::string>& schemas, const SchemaFilter& hasTags,
+    const std::string& queryStr, LngLat lngLat00, LngLat lngLat11, unsigned int zooms);
+std::string listSearchSql(const std::vector<std::string>& schemas, const SchemaFilter& hasTags,
+    const std::string& queryStr, bool rankByDist, bool personal, int limit, bool* usedTags = NULL);
+std::string autocompleteSql(const std::vector<std::string>& schemas);
+std::string autocompleteRankedSql(const std::vector<std::string>& schemas, bool rankByDist, int limit);
+std::string fuzzySearchSql(const std::vector<std::string>& schemas);
+std::string trigramMatchStr(const std::vector<std::string>& trigrams);
+float trigramSimilarity(const std::vector<std::string>& qtris, const char* name);
@@ -24,6 +24,7 @@ public:
   void addRouteStep(const char* instr, int rteptidx);
   bool onPickResult();
   bool tapEvent(LngLat location);
+  bool openNearestTrack(LngLat location);
   void fingerEvent(int action, LngLat pos);
   void routePluginError(const char* err);
   bool onFeaturePicked(const Tangram::FeaturePickResult* result);
@@ -54,6 +55,7 @@ private:
   void setTrackVisible(GpxFile* track, bool visible);
   void populateArchived();
   void populateTrackList();
+  void filterMapAreaTracks(Widget* content);
   void populateTrack(GpxFile* track);
   Widget* createTrackEntry(GpxFile* track);
   Waypoint interpTrack(const std::vector<Waypoint>& locs, double s, size_t* idxout = NULL);
@@ -64,6 +66,11 @@ private:
   void removeWaypoint(GpxFile* track, const std::string& uid);
   void viewEntireTrack(GpxFile* track);
   void updateDB(GpxFile* track);
+  void saveSummary(int rowid, const TrackSummary& summary);
+  void refreshSummaries(std::vector<GpxFile*> tracklist);
+  void updateTracksIndex();
+  std::vector<GpxFile*> findTracks(LngLat lngLat00, LngLat lngLat11);
+  GpxFile* nearestTrack(LngLat pos, double maxDist);
   Waypoint* addWaypoint(Waypoint wpt);
   void removeTrackMarkers(GpxFile* track);
   void updateStats(GpxFile* track);
@@ -148,6 +155,7 @@ private:
   bool plotDirty = true;
   bool showAllWaypts = false;
   bool archiveLoaded = false;
+  bool mapAreaTracks = false;  // only show tracks in map area
   bool tapToAddWaypt = false;
   bool autoInsertWaypt = false;
   bool replaceWaypt = false;  // replacing waypt from search or bookmarks
@@ -157,6 +165,12 @@ private:
   std::unique_ptr<Dialog> newTrackDialog;
   std::unique_ptr<Dialog> editTrackDialog;
 
+  // spatial index of track bounds (from track summaries)
+  BoxIndex tracksIndex;
+  std::vector<GpxFile*> indexedTracks;
+  std::vector<GpxFile*> unboundedTracks;  // tracks w/o summary
+  bool tracksIndexDirty = true;
+
   isect2d::ISect2D<glm::vec2> routeCollider;
   glm::dvec2 routeOrigin;
 };
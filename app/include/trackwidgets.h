@@ -2,6 +2,7 @@
 
 #include "tracks.h"
 #include "ugui/widgets.h"
+#include "plotseries.h"
 
 class TrackPlot : public CustomWidget
 {
@@ -9,13 +10,15 @@ public:
   TrackPlot();
   void draw(SvgPainter* svgp) const override;
   void setTrack(const std::vector<Waypoint>& locs, const std::vector<Waypoint>& wpts);
+  // for points appended to locs (i.e. recording); falls back to setTrack() if locs was otherwise changed
+  void appendTrack(const std::vector<Waypoint>& locs, const std::vector<Waypoint>& wpts);
   real plotPosToTrackPos(real s) const;
   real trackPosToPlotPos(real s) const;
 
   std::function<void(real)> onHovered;
   std::function<void()> onPanZoom;
 
-  Path2D altDistPlot, altTimePlot, spdDistPlot, spdTimePlot;
+  PlotSeries altDistPlot, altTimePlot, spdDistPlot, spdTimePlot;
   std::vector<Waypoint> waypoints;
   double minAlt = 0, maxAlt = 0;
   double minSpd = 0, maxSpd = 0;
@@ -40,6 +43,9 @@ private:
   real prevCOM = 0;
   real prevPinchDist = 0;
   mutable real plotWidth = 100;
+  size_t nTrackPts = 0;  // number of points of track added to plots
+  size_t nDistPts = 0;  // number of points in *DistPlot before last track point
+  LngLat trackStart;
 
   void updateZoomOffset(real dx);
 };
@@ -50,11 +56,15 @@ public:
   //TrackSparkline() {}
   void draw(SvgPainter* svgp) const override;
   void setTrack(const std::vector<Waypoint>& locs);
+  void appendTrack(const std::vector<Waypoint>& locs);
 
-  Path2D altDistPlot;
+  PlotSeries altDistPlot;
   double minAlt, maxAlt;
   double maxDist;
   bool darkMode = false;
+
+private:
+  LngLat trackStart;
 };
 
 class SliderHandle : public Button
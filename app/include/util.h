@@ -27,6 +27,8 @@ std::pair<LngLat, LngLat> tileCoveringBounds(LngLat minLngLat, LngLat maxLngLat,
 LngLat parseLngLat(const char* s);
 std::string lngLatToStr(LngLat ll);
 int64_t packTileId(const TileID& tile);
+TileID unpackTileId(int64_t id);
+void tileIdRange(const TileID& tile, int64_t& lo, int64_t& hi);
 
 // flowLevel = 0 to get flow YAML; flowLevel = 0 and indent = 0 to get JSON
 std::string yamlToStr(const YAML::Node& node, int flowLevel = 0, int indent = 2);
@@ -40,6 +42,38 @@ Tangram::Properties jsonToProps(const char* json);
 Tangram::Properties jsonToProps(const std::string& json);
 Tangram::Properties jsonToProps(const YAML::Node& tags);
 
+// compact encoding for flat props (see util.cpp); JSON view is still used for plugins, history, and export
+bool isPropsBlob(const char* s);
+std::string propsToBlob(const Tangram::Properties& props);
+std::string jsonToPropsBlob(const std::string& json);
+Tangram::Properties propsBlobToProps(const char* blob);
+std::string propsBlobToJson(const char* blob);
+std::string propsJsonView(const std::string& propstr);
+
+// zero-copy iteration over props blob; key and str are not NUL terminated!
+class PropsView
+{
+public:
+  PropsView(const char* _blob) : blob(isPropsBlob(_blob) ? _blob + 2 : NULL), p(blob) {}
+  bool next();
+  bool find(const char* k);
+  void rewind() { p = blob; }
+  bool isString() const { return type == 's'; }
+  std::string keyStr() const { return std::string(key, keyLen); }
+  std::string strValue() const { return std::string(str, strLen); }
+
+  const char* key = NULL;
+  size_t keyLen = 0;
+  char type = 0;
+  const char* str = NULL;
+  size_t strLen = 0;
+  double num = 0;
+
+private:
+  const char* blob;
+  const char* p;
+};
+
 std::string ftimestr(const char* fmt, int64_t msec_epoch = 0);
 std::string colorToStr(const Color& c);
 
@@ -52,6 +86,7 @@ struct sqlite3_context;
 struct sqlite3_value;
 extern LngLat searchRankOrigin;
 void udf_osmSearchRank(sqlite3_context* context, int argc, sqlite3_value** argv);
+void udf_mortonTileId(sqlite3_context* context, int argc, sqlite3_value** argv);
 
 class MarkerGroup
 {
@@ -26,7 +26,8 @@ int MapsBookmarks::addBookmark(int list_id, const std::string& osm_id, const std
 {
   if(timestamp <= 0) timestamp = int(mSecSinceEpoch()/1000);
   const char* query = "INSERT INTO bookmarks (list_id,osm_id,title,props,notes,lng,lat,timestamp) VALUES (?,?,?,?,?,?,?,?);";
-  SQLiteStmt(app->bkmkDB, query).bind(list_id, osm_id, name, props, note, pos.longitude, pos.latitude, timestamp).exec();
+  std::string propblob = jsonToPropsBlob(props);
+  SQLiteStmt(app->bkmkDB, query).bind(list_id, osm_id, name, propblob, note, pos.longitude, pos.latitude, timestamp).exec();
   int rowid = sqlite3_last_insert_rowid(app->bkmkDB);
 
   bkmkPanelDirty = true;
@@ -561,19 +562,21 @@ void MapsBookmarks::createFromSearch(const std::string& title, const std::vector
 
   const char* query = "INSERT INTO bookmarks (list_id,osm_id,title,props,notes,lng,lat) VALUES (?,?,?,?,?,?,?);";
   SQLiteStmt insbkmk(app->bkmkDB, query);
+  DB_exec(app->bkmkDB, "BEGIN;");  // index personal data (via triggers) in one batch
   for(auto& res : results) {
     // cut and paste from MapsSearch::populateResults()
     auto json = strToJson(res.tags.c_str());
     Properties props = jsonToProps(json);
     std::string namestr = app->getPlaceTitle(props);
-    std::string placetype = !res.tags.empty() ? app->pluginManager->jsCallFn("getPlaceType", res.tags) : "";
+    std::string placetype = app->pluginManager->getPlaceType(props, res.tags.c_str());
     if(namestr.empty()) namestr.swap(placetype);  // we can show type instead of name if present
     if(namestr.empty())
       namestr = lngLatToStr(res.pos);
     std::string osm_id = osmIdFromJson(json);
 
-    insbkmk.bind(list_id, osm_id, namestr, res.tags, placetype, res.pos.longitude, res.pos.latitude).exec();
+    insbkmk.bind(list_id, osm_id, namestr, jsonToPropsBlob(res.tags), placetype, res.pos.longitude, res.pos.latitude).exec();
   }
+  DB_exec(app->bkmkDB, "COMMIT;");
   //populateLists(false);
   listsDirty = true;
 }
@@ -593,12 +596,14 @@ void MapsBookmarks::importGpx(const char* filename, const char* gpxsrc)
   //if(timestamp <= 0) timestamp = int(mSecSinceEpoch()/1000);
   const char* query = "INSERT INTO bookmarks (list_id,osm_id,title,props,notes,lng,lat,timestamp) VALUES (?,?,?,?,?,?,?,?);";
   SQLiteStmt insbkmk(app->bkmkDB, query);
+  DB_exec(app->bkmkDB, "BEGIN;");
   for(auto& wpt : gpx.waypoints) {
     std::string osm_id = osmIdFromJson(strToJson(wpt.props.c_str()));
     if(wpt.name.empty())
       wpt.name = lngLatToStr(wpt.lngLat());
-    insbkmk.bind(list_id, osm_id, wpt.name, wpt.props, wpt.desc, wpt.loc.lng, wpt.loc.lat, int64_t(wpt.loc.time)).exec();
+    insbkmk.bind(list_id, osm_id, wpt.name, jsonToPropsBlob(wpt.props), wpt.desc, wpt.loc.lng, wpt.loc.lat, int64_t(wpt.loc.time)).exec();
   }
+  DB_exec(app->bkmkDB, "COMMIT;");
   populateLists(false);
 }
 
@@ -665,7 +670,9 @@ void MapsBookmarks::importImages(int64_t list_id, const char* path)
   const char* query = "INSERT INTO bookmarks (list_id,osm_id,title,props,notes,lng,lat,timestamp) "
       "VALUES (?,?,?,?,?,?,?, CAST(strftime('%s', datetime(?)) AS INTEGER));";
   SQLiteStmt insbkmk(app->bkmkDB, query);
+  DB_exec(app->bkmkDB, "BEGIN;");
   nimages = importImageFolder(insbkmk, list_id, path);
+  DB_exec(app->bkmkDB, "COMMIT;");
   std::string errmsg = fstring("No geotagged images found in %s", path);
 #endif
   MapsApp::runOnMainThread([=](){
@@ -696,7 +703,7 @@ void MapsBookmarks::exportGpx(const char* filename, int listid)
   SQLiteStmt(app->bkmkDB, q).bind(listid).exec([&](int id, std::string namestr,
       std::string propstr, const char* notestr, double lng, double lat, int64_t timestamp){
     gpx.waypoints.push_back(Waypoint(Location{double(timestamp), lat, lng, 0,0,0,0,0,0,0}, namestr, notestr));
-    gpx.waypoints.back().props = propstr;
+    gpx.waypoints.back().props = propsJsonView(propstr);
   });
   saveGPX(&gpx);
 }
@@ -1,9 +1,13 @@
 #include "gpxfile.h"
-#include "pugixml.hpp"
 #include "ulib/stringutil.h"
 #include "ulib/fileutil.h"
 #include "util.h"
-#include <iomanip>  // std::get_time
+#include <sys/stat.h>
+#if !PLATFORM_WIN
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 
 std::vector<Waypoint>::iterator GpxFile::findWaypoint(const std::string& uid)
@@ -20,128 +24,654 @@ std::vector<Waypoint>::iterator GpxFile::addWaypoint(Waypoint wpt, const std::st
   return waypoints.insert(nextuid.empty() ? waypoints.end() : findWaypoint(nextuid), wpt);
 }
 
-static double parseGpxTime(const char* s)
+void TrackStats::update(std::vector<Waypoint>& locs, bool _isTrack, bool _hasSpeed, double _speedInvTau)
 {
-  if(!s || !s[0]) return 0;
-  std::tm tmb;
-  std::stringstream(s) >> std::get_time(&tmb, "%Y-%m-%dT%TZ");  //2023-03-31T20:19:15Z
-  return timegm(&tmb);  //mktime(&tmb);
+  if(_isTrack != isTrack || _hasSpeed != hasSpeed || _speedInvTau != speedInvTau) {
+    isTrack = _isTrack;
+    hasSpeed = _hasSpeed;
+    speedInvTau = _speedInvTau;
+    dirtyIdx = 0;
+  }
+  size_t n = locs.size();
+  // fall back to full recalc if points were removed or changed w/o invalidate()
+  if(n < npts || (npts > 0 && dirtyIdx >= npts
+      && (locs[npts-1].loc.time != lastTime || !(locs[npts-1].lngLat() == lastPos))))
+    dirtyIdx = 0;
+  if(n == npts && dirtyIdx >= npts) { return; }  // nothing changed
+
+  // last point is always included in dist, so must be reprocessed when points are added
+  State s;
+  if(npts > 0 && dirtyIdx >= npts - 1)
+    s = lastState;
+  else {
+    checkpoints.resize(std::min(checkpoints.size(), dirtyIdx/CHECKPOINT_STEP));
+    if(!checkpoints.empty())
+      s = checkpoints.back();
+  }
+
+  if(n > 0) locs.front().dist = 0;
+  if(n < 2) lastState = State();
+  for(size_t ii = s.next; ii < n; ++ii) {
+    if(ii == n - 1)
+      lastState = s;
+    if(ii % CHECKPOINT_STEP == 0 && ii/CHECKPOINT_STEP > checkpoints.size())
+      checkpoints.push_back(s);
+
+    Location& loc = locs[ii].loc;
+    double dt = loc.time - locs[ii-1].loc.time;
+    double dist = 1000*lngLatDist(loc.lngLat(), locs[s.prevDistLoc].lngLat());
+    double disterr = loc.poserr + locs[s.prevDistLoc].loc.poserr;
+    double vert = loc.alt - locs[s.prevVertLoc].loc.alt;
+    double verterr = loc.alterr + locs[s.prevVertLoc].loc.alterr;
+
+    // spd is overwritten w/ estimated speed if !hasSpeed, so only count if from GPS
+    if(hasSpeed && loc.spd > 0.1f)
+      s.movingTimeGps += dt;
+
+    s.rawDist += 1000*lngLatDist(loc.lngLat(), locs[ii-1].lngLat());
+    disterr = disterr > 0 ? disterr : 10;
+    if(!isTrack)
+      s.trackDist = s.rawDist;
+    else if(dist > disterr/2 || ii == n - 1) {  // be more generous with distance than vert
+      double tdist = loc.time - locs[s.prevDistLoc].loc.time;
+      s.trackDist += dist;
+      s.movingTime += std::min(10.0, tdist);
+
+      if(!hasSpeed) {
+        double a = std::exp(-dt*speedInvTau);
+        s.estSpeed = a*s.estSpeed + (1-a)*dist/tdist;
+      }
+      s.prevDistLoc = ii;
+    }
+    locs[ii].dist = s.trackDist;
+    if(!hasSpeed)
+      loc.spd = s.estSpeed;
+    s.maxSpeed = std::max(double(loc.spd), s.maxSpeed);
+
+    verterr = verterr > 0 ? verterr : 20;
+    if(std::abs(vert) > verterr) {
+      double vertdt = dt;
+      for(size_t jj = s.prevVertLoc; jj < ii; ++jj) {
+        // idea here is to try to exclude flat sections
+        if(std::abs(loc.alt - locs[jj+1].loc.alt) <= verterr) {
+          vertdt = loc.time - locs[jj].loc.time;
+          break;
+        }
+      }
+      s.trackAscent += std::max(0.0, vert);
+      s.trackDescent += std::min(0.0, vert);
+      s.ascentTime += vert > 0 ? vertdt : 0;
+      s.descentTime += vert < 0 ? vertdt : 0;
+      s.prevVertLoc = ii;
+    }
+    s.next = ii + 1;
+  }
+
+  res = s;
+  npts = n;
+  dirtyIdx = SIZE_MAX;
+  if(n > 0) {
+    lastTime = locs.back().loc.time;
+    lastPos = locs.back().lngLat();
+  }
 }
 
-// https://www.topografix.com/GPX/1/1/ , https://www.topografix.com/gpx_manual.asp
-// https://github.com/tkrajina/gpxpy/blob/dev/test_files/gpx1.0_with_all_fields.gpx
-static Waypoint loadWaypoint(const pugi::xml_node& trkpt)
-{
-  double lat = trkpt.attribute("lat").as_double();
-  double lng = trkpt.attribute("lon").as_double();
-  double ele = atof(trkpt.child_value("ele"));
-  // https://www.topografix.com/gpx_manual.asp#speed and used in actual GPX files
-  float speed = atof(trkpt.child_value("speed"));
-  float course = atof(trkpt.child_value("course"));
-  double time = parseGpxTime(trkpt.child_value("time"));
-  Waypoint wpt({time, lat, lng, 0, ele, 0, course, 0, speed, 0}, trkpt.child_value("name"), trkpt.child_value("desc"));
-  pugi::xml_node extnode = trkpt.child("extensions");
-  if(extnode) {
-    //wpt.visible = extnode.attribute("visible").as_bool(wpt.visible);
-    pugi::xml_node slroute = extnode.child("sl:route");
-    if(slroute) {
-      wpt.routed = slroute.attribute("routed").as_bool(wpt.routed);
-      wpt.dist = slroute.attribute("dist").as_double(wpt.dist);
+static bool hasExtras(const Waypoint& wpt)
+{
+  return !wpt.name.empty() || !wpt.desc.empty() || !wpt.props.empty() || !wpt.uid.empty()
+      || !wpt.routed || wpt.marker > 0;
+}
+
+bool TrackColumns::encode(const std::vector<Waypoint>& pts)
+{
+  size_t n = pts.size();
+  time0 = n > 0 ? pts.front().loc.time : 0;
+  for(const Waypoint& wpt : pts) {
+    double dt = (wpt.loc.time - time0)*1000;
+    if(!(std::abs(dt) < INT32_MAX)) { return false; }  // span too long (> 24 days) or NaN
+  }
+  auto column = [&](std::vector<float>& col, auto getter) {
+    col.clear();
+    for(size_t ii = 0; ii < n; ++ii) {
+      if(getter(pts[ii].loc) != 0) {
+        col.reserve(n);
+        for(const Waypoint& wpt : pts)
+          col.push_back(float(getter(wpt.loc)));
+        return;
+      }
     }
-    pugi::xml_node slprops = extnode.child("sl:props");
-    if(slprops)
-      wpt.props = slprops.child_value();
+  };
+  lat.resize(n);  lng.resize(n);  dtime.resize(n);
+  for(size_t ii = 0; ii < n; ++ii) {
+    const Location& loc = pts[ii].loc;
+    lat[ii] = int32_t(std::lround(loc.lat*1E7));
+    lng[ii] = int32_t(std::lround(loc.lng*1E7));
+    dtime[ii] = int32_t(std::lround((loc.time - time0)*1000));
+  }
+  column(alt, [](const Location& loc){ return loc.alt; });
+  column(spd, [](const Location& loc){ return loc.spd; });
+  column(dir, [](const Location& loc){ return loc.dir; });
+  column(poserr, [](const Location& loc){ return loc.poserr; });
+  column(alterr, [](const Location& loc){ return loc.alterr; });
+  extras.clear();
+  return true;
+}
+
+Waypoint TrackColumns::get(size_t ii) const
+{
+  auto it = std::lower_bound(extras.begin(), extras.end(), ii,
+      [](const std::pair<size_t, Waypoint>& a, size_t idx){ return a.first < idx; });
+  Waypoint wpt({time0 + dtime[ii]*0.001, lat[ii]*1E-7, lng[ii]*1E-7, poserr.empty() ? 0 : poserr[ii],
+      alt.empty() ? 0 : alt[ii], alterr.empty() ? 0 : alterr[ii], dir.empty() ? 0 : dir[ii], 0,
+      spd.empty() ? 0 : spd[ii], 0});
+  if(it != extras.end() && it->first == ii) {
+    wpt.name = it->second.name;
+    wpt.desc = it->second.desc;
+    wpt.props = it->second.props;
+    wpt.uid = it->second.uid;
+    wpt.routed = it->second.routed;
   }
   return wpt;
 }
 
-bool loadGPX(GpxFile* track, const char* gpxSrc)
+void TrackColumns::decode(std::vector<Waypoint>& pts)
 {
-  pugi::xml_document doc;
-  if(gpxSrc)
-    doc.load_string(gpxSrc);
-  else
-    doc.load_file(track->filename.c_str());
-  pugi::xml_node gpx = doc.child("gpx");
-  if(!gpx)
-    return false;
-  // we were previously writing name and desc to <gpx> instead of proper location of <gpx><metadata>
-  const char* gpxname = gpx.child_value("name");
-  const char* gpxdesc = gpx.child_value("desc");
-  double gpxtime = 0;
-  pugi::xml_node metadata = gpx.child("metadata");
-  if(metadata) {
-    gpxname = metadata.child_value("name");
-    gpxdesc = metadata.child_value("desc");
-    gpxtime = parseGpxTime(metadata.child_value("time"));
+  size_t n = size();
+  pts.clear();
+  pts.reserve(n);
+  for(size_t ii = 0; ii < n; ++ii)
+    pts.push_back(get(ii));
+  for(auto& extra : extras)
+    pts[extra.first].marker = std::move(extra.second.marker);
+  *this = TrackColumns();
+}
+
+size_t TrackColumns::memUsage() const
+{
+  size_t bytes = sizeof(TrackColumns) + (lat.capacity() + lng.capacity() + dtime.capacity())*sizeof(int32_t)
+      + (alt.capacity() + spd.capacity() + dir.capacity() + poserr.capacity() + alterr.capacity())*sizeof(float);
+  for(auto& extra : extras)
+    bytes += sizeof(extra) + extra.second.name.capacity() + extra.second.desc.capacity() + extra.second.props.capacity();
+  return bytes;
+}
+
+bool GpxWay::compact()
+{
+  if(pts.empty() || !cols.encode(pts)) { return false; }
+  for(size_t ii = 0; ii < pts.size(); ++ii) {
+    if(hasExtras(pts[ii]))
+      cols.extras.emplace_back(ii, std::move(pts[ii]));
   }
-  if(gpxtime > 0) track->timestamp = gpxtime;
-  pugi::xml_node extnode = metadata.child("extensions").child("sl:gpx");
-  if(!extnode)
-    extnode = gpx.child("extensions").child("sl:gpx");
-  if(extnode && track->style.empty())
-    track->style = extnode.attribute("style").as_string();
-
-  pugi::xml_node wpt = gpx.child("wpt");
-  while(wpt) {
-    track->addWaypoint(loadWaypoint(wpt));
-    wpt = wpt.next_sibling("wpt");
-  }
-
-  pugi::xml_node rte = gpx.child("rte");
-  while(rte) {
-    int rtestep = -1;
-    double ttot = 0;
-    track->routes.emplace_back(rte.child_value("name"), rte.child_value("desc"));
-    //if(track->routeMode.empty())
-    track->routeMode = rte.child_value("type");
-    pugi::xml_node rtept = rte.child("rtept");
-    while(rtept) {
-      track->routes.back().pts.push_back(loadWaypoint(rtept));
-
-      // handle openrouteservice extensions (other common/useful extensions to be added later)
-      pugi::xml_node extnode = rtept.child("extensions");
-      if(extnode) {
-        const char* stepstr = extnode.child_value("step");
-        const char* durstr = extnode.child_value("duration");
-        if(stepstr[0] && durstr[0]) {
-          int step = atoi(stepstr);
-          track->routes.back().pts.back().loc.time = ttot;
-          if(step > rtestep)
-            ttot += atof(durstr);
-          rtestep = step;
-        }
+  size_t bytes0 = pts.capacity()*sizeof(Waypoint);
+  std::vector<Waypoint>().swap(pts);
+  LOGD("Compacted track %s: %zu points, %zu -> %zu bytes", title.c_str(), cols.size(), bytes0, cols.memUsage());
+  return true;
+}
+
+void GpxWay::expand()
+{
+  if(!pts.empty() || cols.size() == 0) { return; }
+  cols.decode(pts);
+  stats.invalidate();  // dist not stored in columns
+}
+
+// days since 1970-01-01 for proleptic Gregorian calendar date and inverse
+// - from howardhinnant.github.io/date_algorithms.html
+static int64_t daysFromCivil(int64_t y, int m, int d)
+{
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399)/400;
+  int64_t yoe = y - era*400;
+  int64_t doy = (153*(m > 2 ? m - 3 : m + 9) + 2)/5 + d - 1;
+  int64_t doe = yoe*365 + yoe/4 - yoe/100 + doy;
+  return era*146097 + doe - 719468;
+}
+
+static void civilFromDays(int64_t z, int64_t& y, int& m, int& d)
+{
+  z += 719468;
+  int64_t era = (z >= 0 ? z : z - 146096)/146097;
+  int64_t doe = z - era*146097;
+  int64_t yoe = (doe - doe/1460 + doe/36524 - doe/146096)/365;
+  int64_t doy = doe - (365*yoe + yoe/4 - yoe/100);
+  int64_t mp = (5*doy + 2)/153;
+  d = int(doy - (153*mp + 2)/5 + 1);
+  m = int(mp < 10 ? mp + 3 : mp - 9);
+  y = yoe + era*400 + (m <= 2);
+}
+
+static int daysInMonth(int64_t y, int m)
+{
+  static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  bool leap = y % 4 == 0 && (y % 100 != 0 || y % 400 == 0);
+  return m == 2 && leap ? 29 : days[m - 1];
+}
+
+// parse ISO-8601 date and time, e.g. 2023-03-31T20:19:15Z or 2023-03-31T13:19:15.250-07:00; time w/o
+//  timezone is assumed to be UTC; much faster than std::get_time and locale independent; returns 0 if invalid
+// - 24:00:00 (end of day) and leap second 60 are accepted; offsets are limited to +/-14:00
+double parseGpxTime(const char* s)
+{
+  if(!s) return 0;
+  while(isspace((unsigned char)*s)) { ++s; }
+  auto digits = [&s](int n, int& val) {
+    val = 0;
+    for(int ii = 0; ii < n; ++ii, ++s) {
+      if(*s < '0' || *s > '9') return false;
+      val = val*10 + (*s - '0');
+    }
+    return true;
+  };
+  auto lit = [&s](const char* chars) {
+    if(!*s || !strchr(chars, *s)) return false;
+    ++s;
+    return true;
+  };
+
+  int year, mon, day, hour, min, sec;
+  if(!digits(4, year) || !lit("-") || !digits(2, mon) || !lit("-") || !digits(2, day)) { return 0; }
+  if(!lit("Tt ") || !digits(2, hour) || !lit(":") || !digits(2, min) || !lit(":") || !digits(2, sec)) { return 0; }
+  if(mon < 1 || mon > 12 || day < 1 || day > daysInMonth(year, mon)) { return 0; }
+  if(hour > 24 || min > 59 || sec > 60 || (hour == 24 && (min > 0 || sec > 0))) { return 0; }
+  double frac = 0;
+  if(lit(".,")) {
+    for(double scale = 0.1; *s >= '0' && *s <= '9'; ++s, scale *= 0.1)
+      frac += (*s - '0')*scale;
+  }
+  if(hour == 24 && frac > 0) { return 0; }
+  int offset = 0;
+  if(*s == '+' || *s == '-') {
+    int sign = *s++ == '-' ? -1 : 1;
+    int tzh = 0, tzm = 0;
+    if(!digits(2, tzh)) { return 0; }
+    lit(":");
+    if(*s >= '0' && *s <= '9' && !digits(2, tzm)) { return 0; }
+    if(tzm > 59 || tzh*60 + tzm > 14*60) { return 0; }
+    offset = sign*(tzh*3600 + tzm*60);
+  }
+  return double(daysFromCivil(year, mon, day)*86400 + hour*3600 + min*60 + sec - offset) + frac;
+}
+
+// Streaming XML parser - file is read in chunks and GPX data is extracted as elements are parsed, so memory
+//  use is independent of file size (a DOM for a large GPX file can be several times the file size)
+// Only supports what is needed for GPX: elements, attributes, text, CDATA, and predefined and numeric
+//  entities; comments, processing instructions, and DOCTYPE are skipped.  Missing closing tags at end of
+//  input are allowed (as for track being recorded)
+class XmlStreamParser
+{
+public:
+  using Attrs = std::vector<std::pair<std::string, std::string>>;
+  static constexpr size_t CHUNK_SIZE = 1 << 16;
+
+  virtual ~XmlStreamParser() {}
+  bool parse(const char* src);
+  bool parse(FileStream& strm);
+
+protected:
+  std::vector<std::string> elems;  // open elements
+  virtual void startElement(const std::string& name, const Attrs& attrs) = 0;
+  virtual void endElement(const std::string& name, const std::string& text) = 0;
+
+private:
+  FileStream* strm = NULL;
+  std::vector<char> buf;
+  const char* p = NULL;
+  const char* end = NULL;
+  std::string text;
+  Attrs attrs;
+
+  bool fill();
+  const char* find(const char* term, size_t offset = 0);
+  const char* findTagEnd();
+  void run();
+  void parseTag(const char* tagend);
+};
+
+static void decodeXmlEntities(std::string& out, const char* s, const char* end)
+{
+  while(s < end) {
+    const char* amp = (const char*)memchr(s, '&', end - s);
+    if(!amp) { out.append(s, end); return; }
+    out.append(s, amp);
+    const char* semi = (const char*)memchr(amp, ';', std::min(end - amp, ptrdiff_t(12)));
+    if(!semi) { out.push_back('&'); s = amp + 1; continue; }
+    std::string ent(amp + 1, semi);
+    if(ent == "lt") out.push_back('<');
+    else if(ent == "gt") out.push_back('>');
+    else if(ent == "amp") out.push_back('&');
+    else if(ent == "quot") out.push_back('"');
+    else if(ent == "apos") out.push_back('\'');
+    else if(ent.size() > 1 && ent[0] == '#') {
+      uint32_t c = ent[1] == 'x' ? strtoul(ent.c_str() + 2, NULL, 16) : strtoul(ent.c_str() + 1, NULL, 10);
+      if(c < 0x80) out.push_back(char(c));
+      else if(c < 0x800) { out.push_back(char(0xC0 | (c >> 6))); out.push_back(char(0x80 | (c & 0x3F))); }
+      else if(c < 0x10000) {
+        out.push_back(char(0xE0 | (c >> 12)));
+        out.push_back(char(0x80 | ((c >> 6) & 0x3F)));
+        out.push_back(char(0x80 | (c & 0x3F)));
       }
+      else {
+        out.push_back(char(0xF0 | (c >> 18)));
+        out.push_back(char(0x80 | ((c >> 12) & 0x3F)));
+        out.push_back(char(0x80 | ((c >> 6) & 0x3F)));
+        out.push_back(char(0x80 | (c & 0x3F)));
+      }
+    }
+    else { out.append(amp, semi + 1); }  // unknown entity - leave as is
+    s = semi + 1;
+  }
+}
+
+bool XmlStreamParser::fill()
+{
+  if(!strm) return false;
+  size_t rem = end - p;
+  if(p != buf.data())
+    memmove(buf.data(), p, rem);
+  if(buf.size() < rem + CHUNK_SIZE)
+    buf.resize(rem + CHUNK_SIZE);
+  size_t n = strm->read(buf.data() + rem, CHUNK_SIZE);
+  p = buf.data();
+  end = p + rem + n;
+  return n > 0;
+}
 
-      rtept = rtept.next_sibling("rtept");
+// find term starting at p + offset, reading more input as needed; returns NULL if not found before end of input
+const char* XmlStreamParser::find(const char* term, size_t offset)
+{
+  size_t len = strlen(term);
+  for(;;) {
+    for(const char* s = p + offset; s + len <= end; ++s) {
+      s = (const char*)memchr(s, term[0], end - s);
+      if(!s || s + len > end) break;
+      if(memcmp(s, term, len) == 0) return s;
     }
-    rte = rte.next_sibling("rte");
-  }
-
-  pugi::xml_node trk = gpx.child("trk");
-  //if(!trk) logMsg("Error loading %s\n", gpxfile);
-  while(trk) {
-    track->tracks.emplace_back(trk.child_value("name"), trk.child_value("desc"));
-    pugi::xml_node trkseg = trk.child("trkseg");
-    while(trkseg) {
-      //std::vector<LngLat> track;
-      pugi::xml_node trkpt = trkseg.child("trkpt");
-      while(trkpt) {
-        Waypoint pt1 = loadWaypoint(trkpt);
-        //if(!track->tracks.back().pts.empty()) {
-        //  auto& pt0 = track->tracks.back().pts.back();
-        //  pt1.dist = pt0.dist + 1000*lngLatDist(pt1.lngLat(), pt0.lngLat());
-        //  if(pt1.loc.time > 0)
-        //    pt1.loc.spd = (pt1.dist - pt0.dist)/(pt1.loc.time - pt0.loc.time);
-        //}
-        track->tracks.back().pts.push_back(pt1);
-        if(pt1.loc.spd > 0) track->hasSpeed = true;
-        trkpt = trkpt.next_sibling("trkpt");
+    offset = std::max(size_t(end - p), len) - len + 1;
+    if(!fill()) return NULL;
+  }
+}
+
+// find '>' closing a start or end tag, skipping quoted attribute values
+const char* XmlStreamParser::findTagEnd()
+{
+  size_t offset = 1;
+  char quote = 0;
+  for(;;) {
+    for(const char* s = p + offset; s < end; ++s) {
+      if(quote) { if(*s == quote) quote = 0; }
+      else if(*s == '"' || *s == '\'') quote = *s;
+      else if(*s == '>') return s;
+    }
+    offset = end - p;
+    if(!fill()) return NULL;
+  }
+}
+
+void XmlStreamParser::parseTag(const char* tagend)
+{
+  static const char* ws = " \t\r\n";
+  const char* s = p + 1;
+  if(*s == '/') {
+    if(elems.empty()) return;
+    endElement(elems.back(), text);
+    elems.pop_back();
+    text.clear();
+    return;
+  }
+  bool selfclose = tagend[-1] == '/';
+  const char* nameend = s;
+  while(nameend < tagend && !strchr(ws, *nameend) && *nameend != '/') { ++nameend; }
+  elems.emplace_back(s, nameend);
+  attrs.clear();
+  s = nameend;
+  while(s < tagend) {
+    while(s < tagend && (strchr(ws, *s) || *s == '/')) { ++s; }
+    const char* eq = (const char*)memchr(s, '=', tagend - s);
+    if(!eq) break;
+    const char* namelast = eq;
+    while(namelast > s && strchr(ws, namelast[-1])) { --namelast; }
+    const char* q = eq + 1;
+    while(q < tagend && strchr(ws, *q)) { ++q; }
+    if(q >= tagend || (*q != '"' && *q != '\'')) break;
+    const char* qend = (const char*)memchr(q + 1, *q, tagend - q - 1);
+    if(!qend) break;
+    attrs.emplace_back(std::string(s, namelast), std::string());
+    decodeXmlEntities(attrs.back().second, q + 1, qend);
+    s = qend + 1;
+  }
+  text.clear();
+  startElement(elems.back(), attrs);
+  if(selfclose) {
+    endElement(elems.back(), text);
+    elems.pop_back();
+  }
+}
+
+void XmlStreamParser::run()
+{
+  for(;;) {
+    if(p == end && !fill()) break;
+    if(*p != '<') {
+      const char* lt = (const char*)memchr(p, '<', end - p);
+      if(!lt && fill()) continue;  // read entire text node so entities aren't split
+      decodeXmlEntities(text, p, lt ? lt : end);
+      p = lt ? lt : end;
+      continue;
+    }
+    while(end - p < 9 && fill()) {}  // ensure enough input to identify markup type
+    const char* tagend = NULL;
+    if(end - p >= 4 && memcmp(p, "<!--", 4) == 0) {
+      if(!(tagend = find("-->", 4))) break;
+      tagend += 2;
+    }
+    else if(end - p >= 9 && memcmp(p, "<![CDATA[", 9) == 0) {
+      if(!(tagend = find("]]>", 9))) break;
+      text.append(p + 9, tagend);
+      tagend += 2;
+    }
+    else if(end - p >= 2 && p[1] == '?') {
+      if(!(tagend = find("?>", 2))) break;
+      tagend += 1;
+    }
+    else if(end - p >= 2 && p[1] == '!') {
+      if(!(tagend = find(">", 2))) break;
+    }
+    else {
+      if(!(tagend = findTagEnd())) break;
+      parseTag(tagend);
+    }
+    p = tagend + 1;
+  }
+  // close any open elements (for truncated input)
+  while(!elems.empty()) {
+    endElement(elems.back(), text);
+    elems.pop_back();
+    text.clear();
+  }
+}
+
+bool XmlStreamParser::parse(const char* src)
+{
+  strm = NULL;
+  p = src;
+  end = src + strlen(src);
+  run();
+  return true;
+}
+
+bool XmlStreamParser::parse(FileStream& _strm)
+{
+  if(!_strm.is_open()) return false;
+  strm = &_strm;
+  p = end = buf.data();
+  run();
+  strm = NULL;
+  return true;
+}
+
+// https://www.topografix.com/GPX/1/1/ , https://www.topografix.com/gpx_manual.asp
+// https://github.com/tkrajina/gpxpy/blob/dev/test_files/gpx1.0_with_all_fields.gpx
+class GpxLoader : public XmlStreamParser
+{
+public:
+  GpxLoader(GpxFile* _track) : track(_track) {}
+  bool finish();
+
+private:
+  GpxFile* track;
+  bool isGpx = false;
+  // we were previously writing name and desc to <gpx> instead of proper location of <gpx><metadata>
+  bool hasMetadata = false;
+  std::string gpxname, gpxdesc, mdname, mddesc;
+  std::string gpxstyle, mdstyle;
+  double gpxtime = 0;
+  // current point
+  size_t ptDepth = 0;
+  double lat = 0, lng = 0, ele = 0, time = 0;
+  float speed = 0, course = 0;
+  std::string name, desc, props;
+  bool routed = true;
+  double dist = 0;
+  std::string stepstr, durstr;
+  // openrouteservice route step durations
+  int rtestep = -1;
+  double ttot = 0;
+
+  void startElement(const std::string& tag, const Attrs& attrs) override;
+  void endElement(const std::string& tag, const std::string& text) override;
+  const char* parent(size_t up = 1) const { return elems.size() > up ? elems[elems.size() - up - 1].c_str() : ""; }
+};
+
+static const std::string* findAttr(const XmlStreamParser::Attrs& attrs, const char* name)
+{
+  for(auto& attr : attrs) {
+    if(attr.first == name) return &attr.second;
+  }
+  return NULL;
+}
+
+// same as pugixml as_bool()
+static bool parseXmlBool(const std::string* s, bool dflt)
+{
+  return s && !s->empty() ? strchr("1tTyY", (*s)[0]) != NULL : dflt;
+}
+
+void GpxLoader::startElement(const std::string& tag, const Attrs& attrs)
+{
+  size_t depth = elems.size();
+  if(depth == 1) {
+    isGpx = tag == "gpx";
+    return;
+  }
+  if(!isGpx) return;
+  const char* par = parent();
+  if((tag == "wpt" && depth == 2) || (tag == "rtept" && strcmp(par, "rte") == 0)
+      || (tag == "trkpt" && strcmp(par, "trkseg") == 0 && strcmp(parent(2), "trk") == 0)) {
+    ptDepth = depth;
+    const std::string* a = findAttr(attrs, "lat");
+    lat = a ? atof(a->c_str()) : 0;
+    a = findAttr(attrs, "lon");
+    lng = a ? atof(a->c_str()) : 0;
+    ele = time = dist = 0;
+    speed = course = 0;
+    name.clear();  desc.clear();  props.clear();  stepstr.clear();  durstr.clear();
+    routed = true;
+  }
+  else if(ptDepth && depth == ptDepth + 2 && tag == "sl:route" && strcmp(par, "extensions") == 0) {
+    routed = parseXmlBool(findAttr(attrs, "routed"), routed);
+    const std::string* a = findAttr(attrs, "dist");
+    if(a && !a->empty()) dist = atof(a->c_str());
+  }
+  else if(tag == "sl:gpx" && strcmp(par, "extensions") == 0) {
+    const std::string* a = findAttr(attrs, "style");
+    if(depth == 4 && strcmp(parent(2), "metadata") == 0 && a) mdstyle = *a;
+    else if(depth == 3 && a) gpxstyle = *a;
+  }
+  else if(depth == 2 && tag == "metadata")
+    hasMetadata = true;
+  else if(depth == 2 && tag == "rte") {
+    track->routes.emplace_back();
+    rtestep = -1;
+    ttot = 0;
+  }
+  else if(depth == 2 && tag == "trk")
+    track->tracks.emplace_back();
+}
+
+void GpxLoader::endElement(const std::string& tag, const std::string& text)
+{
+  size_t depth = elems.size();
+  if(!isGpx || depth < 2) return;
+  const char* par = parent();
+  if(ptDepth && depth == ptDepth + 1) {
+    if(tag == "ele") ele = atof(text.c_str());
+    // https://www.topografix.com/gpx_manual.asp#speed and used in actual GPX files
+    else if(tag == "speed") speed = atof(text.c_str());
+    else if(tag == "course") course = atof(text.c_str());
+    else if(tag == "time") time = parseGpxTime(text.c_str());
+    else if(tag == "name") name = text;
+    else if(tag == "desc") desc = text;
+  }
+  else if(ptDepth && depth == ptDepth + 2 && strcmp(par, "extensions") == 0) {
+    if(tag == "sl:props") props = text;
+    // handle openrouteservice extensions (other common/useful extensions to be added later)
+    else if(tag == "step") stepstr = text;
+    else if(tag == "duration") durstr = text;
+  }
+  else if(ptDepth && depth == ptDepth) {
+    ptDepth = 0;
+    Waypoint wpt({time, lat, lng, 0, ele, 0, course, 0, speed, 0}, name, desc, props);
+    wpt.routed = routed;
+    wpt.dist = dist;
+    if(tag == "wpt")
+      track->addWaypoint(std::move(wpt));
+    else if(tag == "rtept") {
+      track->routes.back().pts.push_back(std::move(wpt));
+      if(!stepstr.empty() && !durstr.empty()) {
+        int step = atoi(stepstr.c_str());
+        track->routes.back().pts.back().loc.time = ttot;
+        if(step > rtestep)
+          ttot += atof(durstr.c_str());
+        rtestep = step;
       }
-      trkseg = trkseg.next_sibling("trkseg");
     }
-    trk = trk.next_sibling("trk");
+    else {
+      if(wpt.loc.spd > 0) track->hasSpeed = true;
+      track->tracks.back().pts.push_back(std::move(wpt));
+    }
+  }
+  else if(depth == 3 && strcmp(par, "metadata") == 0) {
+    if(tag == "name") mdname = text;
+    else if(tag == "desc") mddesc = text;
+    else if(tag == "time") gpxtime = parseGpxTime(text.c_str());
   }
+  else if(depth == 2) {
+    if(tag == "name") gpxname = text;
+    else if(tag == "desc") gpxdesc = text;
+  }
+  else if(depth == 3 && strcmp(par, "rte") == 0) {
+    if(tag == "name") track->routes.back().title = text;
+    else if(tag == "desc") track->routes.back().desc = text;
+    //if(track->routeMode.empty())
+    else if(tag == "type") track->routeMode = text;
+  }
+  else if(depth == 3 && strcmp(par, "trk") == 0) {
+    if(tag == "name") track->tracks.back().title = text;
+    else if(tag == "desc") track->tracks.back().desc = text;
+  }
+}
+
+bool GpxLoader::finish()
+{
+  if(!isGpx)
+    return false;
+  if(hasMetadata) {
+    gpxname = mdname;
+    gpxdesc = mddesc;
+  }
+  if(gpxtime > 0) track->timestamp = gpxtime;
+  if(track->style.empty())
+    track->style = !mdstyle.empty() ? mdstyle : gpxstyle;
   // values set in UI (and stored in DB) takes precedence
   if(track->title.empty()) track->title = gpxname;
   if(track->title.empty() && !track->routes.empty()) track->title = track->routes[0].title;
@@ -155,83 +685,321 @@ bool loadGPX(GpxFile* track, const char* gpxSrc)
   return true;
 }
 
-static std::string saveGpxTime(double time)
+bool loadGPX(GpxFile* track, const char* gpxSrc)
 {
-  char timebuf[256];
-  time_t t = time_t(time);
-  strftime(timebuf, sizeof(timebuf), "%FT%TZ", gmtime(&t));
-  return std::string(timebuf);
+  GpxLoader loader(track);
+  if(gpxSrc)
+    loader.parse(gpxSrc);
+  else {
+    FileStream strm(track->filename.c_str(), "rb");
+    if(!loader.parse(strm)) return false;
+  }
+  return loader.finish();
 }
 
-void saveWaypoint(pugi::xml_node trkpt, const Waypoint& wpt, bool savespd, bool savedist)
+// format as ISO-8601 UTC, w/ milliseconds only if nonzero; buf must hold at least 32 chars
+const char* formatGpxTime(char* buf, double time)
 {
-  trkpt.append_attribute("lat").set_value(fstring("%.7f", wpt.loc.lat).c_str());
-  trkpt.append_attribute("lon").set_value(fstring("%.7f", wpt.loc.lng).c_str());
+  int64_t ms = int64_t(std::floor(time*1000 + 0.5));
+  int64_t secs = ms >= 0 ? ms/1000 : (ms - 999)/1000;
+  int64_t days = secs >= 0 ? secs/86400 : (secs - 86399)/86400;
+  int sod = int(secs - days*86400);
+  ms -= secs*1000;
+  int64_t year;
+  int mon, day;
+  civilFromDays(days, year, mon, day);
+
+  char* p = buf;
+  auto put = [&p](int64_t val, int n) {
+    for(int ii = n - 1; ii >= 0; --ii, val /= 10)
+      p[ii] = char('0' + val%10);
+    p += n;
+  };
+  put(std::min(std::max(year, int64_t(0)), int64_t(9999)), 4);
+  *p++ = '-';  put(mon, 2);  *p++ = '-';  put(day, 2);
+  *p++ = 'T';  put(sod/3600, 2);  *p++ = ':';  put((sod/60)%60, 2);  *p++ = ':';  put(sod%60, 2);
+  if(ms > 0) { *p++ = '.';  put(ms, 3); }
+  *p++ = 'Z';
+  *p = '\0';
+  return buf;
+}
+
+static void escapeXml(std::string& out, const char* s, bool attr = false)
+{
+  for(; *s; ++s) {
+    switch(*s) {
+    case '&': out.append("&amp;"); break;
+    case '<': out.append("&lt;"); break;
+    case '>': out.append("&gt;"); break;
+    case '"': if(attr) { out.append("&quot;"); break; }  // fall through
+    default: out.push_back(*s);
+    }
+  }
+}
+
+static void writeXmlElement(std::string& out, int depth, const char* tag, const char* text)
+{
+  out.append(2*depth, ' ').append("<").append(tag).append(">");
+  escapeXml(out, text);
+  out.append("</").append(tag).append(">\n");
+}
+
+void saveWaypoint(std::string& out, const char* tag, const Waypoint& wpt, bool savespd, bool savedist, int depth)
+{
+  out.append(2*depth, ' ').append("<").append(tag);
+  out.append(fstring(" lat=\"%.7f\" lon=\"%.7f\">\n", wpt.loc.lat, wpt.loc.lng));
+  ++depth;
   // missing altitude is read back as 0, so not a problem to skip an actual ele == 0 point
   if(wpt.loc.alt != 0)
-    trkpt.append_child("ele").append_child(pugi::node_pcdata).set_value(fstring("%.1f", wpt.loc.alt).c_str());
+    writeXmlElement(out, depth, "ele", fstring("%.1f", wpt.loc.alt).c_str());
   if(savespd && wpt.loc.spd > 0)
-    trkpt.append_child("speed").append_child(pugi::node_pcdata).set_value(fstring("%.2f", wpt.loc.spd).c_str());
+    writeXmlElement(out, depth, "speed", fstring("%.2f", wpt.loc.spd).c_str());
+  char timebuf[32];
   if(wpt.loc.time > 0)
-    trkpt.append_child("time").append_child(pugi::node_pcdata).set_value(saveGpxTime(wpt.loc.time).c_str());
+    writeXmlElement(out, depth, "time", formatGpxTime(timebuf, wpt.loc.time));
   if(!wpt.name.empty())
-    trkpt.append_child("name").append_child(pugi::node_pcdata).set_value(wpt.name.c_str());
+    writeXmlElement(out, depth, "name", wpt.name.c_str());
   if(!wpt.desc.empty())
-    trkpt.append_child("desc").append_child(pugi::node_pcdata).set_value(wpt.desc.c_str());
+    writeXmlElement(out, depth, "desc", wpt.desc.c_str());
 
   savedist = savedist && wpt.dist > 0;
   if(!wpt.routed || !wpt.props.empty() || savedist) {
-    pugi::xml_node extnode = trkpt.append_child("extensions");
+    out.append(2*depth, ' ').append("<extensions>\n");
     if(!wpt.routed || savedist) {
-      pugi::xml_node rtenote = extnode.append_child("sl:route");
-      if(!wpt.routed) { rtenote.append_attribute("routed").set_value(wpt.routed); }
-      if(savedist) { rtenote.append_attribute("dist").set_value(wpt.dist); }
+      out.append(2*depth + 2, ' ').append("<sl:route");
+      if(!wpt.routed) { out.append(" routed=\"false\""); }
+      if(savedist) { out.append(fstring(" dist=\"%.17g\"", wpt.dist)); }
+      out.append(" />\n");
     }
     if(!wpt.props.empty())
-      extnode.append_child("sl:props").append_child(pugi::node_pcdata).set_value(wpt.props.c_str());
+      writeXmlElement(out, depth + 1, "sl:props", wpt.props.c_str());
+    out.append(2*depth, ' ').append("</extensions>\n");
   }
+  --depth;
+  out.append(2*depth, ' ').append("</").append(tag).append(">\n");
 }
 
+// GPX is written in chunks as it is generated instead of building a DOM
 bool saveGPX(GpxFile* track, const char* filename)
 {
-  // saving track
-  pugi::xml_document doc;
-  pugi::xml_node gpx = doc.append_child("gpx");
-  gpx.append_attribute("version").set_value("1.1");
-  gpx.append_attribute("creator").set_value("Ascend Maps");
-  gpx.append_attribute("xmlns").set_value("http://www.topografix.com/GPX/1/1");
-  gpx.append_attribute("xmlns:sl").set_value("http://www.styluslabs.com/xmlns/sl");
-  pugi::xml_node metadata = gpx.append_child("metadata");
-  metadata.append_child("name").append_child(pugi::node_pcdata).set_value(track->title.c_str());
-  metadata.append_child("desc").append_child(pugi::node_pcdata).set_value(track->desc.c_str());
+  static constexpr size_t FLUSH_SIZE = 1 << 16;
+  FileStream strm(filename ? filename : track->filename.c_str(), "wb");
+  if(!strm.is_open())
+    return false;
+  bool ok = true;
+  std::string out;
+  out.reserve(FLUSH_SIZE + 1024);
+  auto flush = [&](size_t minsize){
+    if(out.size() < minsize) return;
+    ok = ok && strm.write(out.data(), out.size()) == out.size();
+    out.clear();
+  };
+
+  out.append("<?xml version=\"1.0\"?>\n");
+  out.append("<gpx version=\"1.1\" creator=\"Ascend Maps\" xmlns=\"http://www.topografix.com/GPX/1/1\"");
+  out.append(" xmlns:sl=\"http://www.styluslabs.com/xmlns/sl\">\n");
+  out.append("  <metadata>\n");
+  writeXmlElement(out, 2, "name", track->title.c_str());
+  writeXmlElement(out, 2, "desc", track->desc.c_str());
+  char timebuf[32];
   if(track->timestamp > 0)
-    metadata.append_child("time").append_child(pugi::node_pcdata).set_value(saveGpxTime(track->timestamp).c_str());
+    writeXmlElement(out, 2, "time", formatGpxTime(timebuf, track->timestamp));
   if(!track->style.empty()) {
-    pugi::xml_node extnode = metadata.append_child("extensions").append_child("sl:gpx");
-    extnode.append_attribute("style").set_value(track->style.c_str());
+    out.append("    <extensions>\n      <sl:gpx style=\"");
+    escapeXml(out, track->style.c_str(), true);
+    out.append("\" />\n    </extensions>\n");
   }
+  out.append("  </metadata>\n");
 
   for(const Waypoint& wpt : track->waypoints)
-    saveWaypoint(gpx.append_child("wpt"), wpt, false, true);
+    saveWaypoint(out, "wpt", wpt, false, true, 1);
 
   for(const GpxWay& route : track->routes) {
-    pugi::xml_node rte = gpx.append_child("rte");
-    rte.append_child("name").append_child(pugi::node_pcdata).set_value(route.title.c_str());
-    rte.append_child("desc").append_child(pugi::node_pcdata).set_value(route.desc.c_str());
-    rte.append_child("type").append_child(pugi::node_pcdata).set_value(track->routeMode.c_str());
-    for(const Waypoint& wpt : route.pts)
-      saveWaypoint(rte.append_child("rtept"), wpt);
+    out.append("  <rte>\n");
+    writeXmlElement(out, 2, "name", route.title.c_str());
+    writeXmlElement(out, 2, "desc", route.desc.c_str());
+    writeXmlElement(out, 2, "type", track->routeMode.c_str());
+    for(const Waypoint& wpt : route.pts) {
+      saveWaypoint(out, "rtept", wpt, false, false, 2);
+      flush(FLUSH_SIZE);
+    }
+    out.append("  </rte>\n");
   }
 
   for(const GpxWay& t : track->tracks) {
-    pugi::xml_node trk = gpx.append_child("trk");
-    trk.append_child("name").append_child(pugi::node_pcdata).set_value(t.title.c_str());
-    trk.append_child("desc").append_child(pugi::node_pcdata).set_value(t.desc.c_str());
-    pugi::xml_node seg = trk.append_child("trkseg");
-    for(const Waypoint& wpt : t.pts)
-      saveWaypoint(seg.append_child("trkpt"), wpt, track->hasSpeed);
+    out.append("  <trk>\n");
+    writeXmlElement(out, 2, "name", t.title.c_str());
+    writeXmlElement(out, 2, "desc", t.desc.c_str());
+    out.append("    <trkseg>\n");
+    for(const Waypoint& wpt : t.pts) {
+      saveWaypoint(out, "trkpt", wpt, track->hasSpeed, false, 3);
+      flush(FLUSH_SIZE);
+    }
+    if(t.pts.empty()) {  // compacted
+      for(size_t ii = 0; ii < t.cols.size(); ++ii) {
+        saveWaypoint(out, "trkpt", t.cols.get(ii), track->hasSpeed, false, 3);
+        flush(FLUSH_SIZE);
+      }
+    }
+    // track recording expects file to end w/ "</trkseg>\n</trk>\n</gpx>\n" (plus whitespace)
+    out.append("    </trkseg>\n  </trk>\n");
+  }
+  out.append("</gpx>\n");
+  flush(0);
+  strm.close();
+  return ok;
+}
+
+void BoxIndex::append(const Box& b)
+{
+  size_t idx = nitems++;
+  for(size_t level = 0; ; ++level) {
+    idx /= NODE_SIZE;
+    if(level == levels.size()) {
+      levels.emplace_back();
+      // new root must cover all nodes of previous root level
+      if(level > 0) {
+        levels[level].emplace_back();
+        for(const Box& child : levels[level-1])
+          levels[level][0].add(child);
+      }
+    }
+    std::vector<Box>& boxes = levels[level];
+    if(idx < boxes.size())
+      boxes[idx].add(b);
+    else
+      boxes.push_back(b);
+    if(boxes.size() == 1) { break; }
+  }
+}
+
+// returns false, leaving index empty, if nodes aren't consistent w/ n items (as built by append())
+bool BoxIndex::setNodes(std::vector< std::vector<Box> >&& nodes, size_t n)
+{
+  clear();
+  if(n > 0 && nodes.empty()) { return false; }
+  size_t count = n;
+  for(size_t level = 0; level < nodes.size(); ++level) {
+    count = (count + NODE_SIZE - 1)/NODE_SIZE;
+    if(nodes[level].size() != count || (count == 1) != (level + 1 == nodes.size())) { return false; }
   }
-  return doc.save_file(filename ? filename : track->filename.c_str(), "  ");
+  levels = std::move(nodes);
+  nitems = n;
+  return true;
+}
+
+std::vector<size_t> BoxIndex::sortSTR(const std::vector<Box>& boxes)
+{
+  size_t n = boxes.size();
+  std::vector<size_t> order(n);
+  for(size_t ii = 0; ii < n; ++ii)
+    order[ii] = ii;
+  // sort by x into vertical slabs of ~sqrt(number of nodes) nodes each, then sort each slab by y
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b){
+    return boxes[a].x0 + boxes[a].x1 < boxes[b].x0 + boxes[b].x1; });
+  size_t nslabs = std::max(size_t(1), size_t(std::ceil(std::sqrt(double(n)/NODE_SIZE))));
+  size_t slab = ((n + nslabs - 1)/nslabs + NODE_SIZE - 1)/NODE_SIZE*NODE_SIZE;
+  for(size_t ii = 0; ii < n; ii += slab) {
+    std::sort(order.begin() + ii, order.begin() + std::min(ii + slab, n), [&](size_t a, size_t b){
+      return boxes[a].y0 + boxes[a].y1 < boxes[b].y0 + boxes[b].y1; });
+  }
+  return order;
+}
+
+void TrackSegIndex::update(const GpxWay& way)
+{
+  size_t n = way.size();
+  size_t nsegs = index.size();
+  if(n <= nsegs) {  // points removed w/o invalidate()
+    index.clear();
+    nsegs = 0;
+  }
+  for(size_t ii = nsegs; ii + 1 < n; ++ii)
+    index.append(BoxIndex::Box(way.lngLat(ii), way.lngLat(ii+1)));
+}
+
+int TrackSegIndex::nearest(const GpxWay& way, LngLat pos, double maxDist)
+{
+  update(way);
+  size_t n = way.size();
+  if(n == 0) { return -1; }
+  double dlat = maxDist/111.2;  // km per degree latitude
+  double dlng = dlat/std::max(0.01, std::cos(pos.latitude*M_PI/180));
+  BoxIndex::Box q(LngLat(pos.longitude - dlng, pos.latitude - dlat), LngLat(pos.longitude + dlng, pos.latitude + dlat));
+  int best = -1;
+  double mindist = maxDist;
+  auto checkPt = [&](size_t ii){
+    double dist = lngLatDist(way.lngLat(ii), pos);
+    if(dist <= mindist) { mindist = dist;  best = int(ii); }
+  };
+  if(n == 1)
+    checkPt(0);
+  index.search(q, [&](size_t ii){ checkPt(ii);  checkPt(ii+1); });
+  return best;
+}
+
+bool gpxFileInfo(const std::string& filename, int64_t& mtime, int64_t& size)
+{
+  struct stat st;
+  if(stat(filename.c_str(), &st) != 0) { return false; }
+  // mtime in nanoseconds where available, so edits within the same second are detected
+#if PLATFORM_WIN
+  mtime = int64_t(st.st_mtime)*1000000000;
+#elif PLATFORM_OSX || PLATFORM_IOS
+  mtime = int64_t(st.st_mtimespec.tv_sec)*1000000000 + st.st_mtimespec.tv_nsec;
+#else
+  mtime = int64_t(st.st_mtim.tv_sec)*1000000000 + st.st_mtim.tv_nsec;
+#endif
+  size = int64_t(st.st_size);
+  return true;
+}
+
+TrackSummary calcTrackSummary(GpxFile* track, double speedInvTau)
+{
+  TrackSummary res;
+  res.npts = 0;
+  bool istrack = track->routes.empty() && !track->tracks.empty();
+  std::vector<GpxWay>& ways = istrack ? track->tracks : track->routes;
+  bool hasbounds = false;
+  auto addBounds = [&](LngLat r){
+    if(!hasbounds) { res.minLngLat = r;  res.maxLngLat = r;  hasbounds = true; }
+    res.minLngLat.longitude = std::min(res.minLngLat.longitude, r.longitude);
+    res.minLngLat.latitude = std::min(res.minLngLat.latitude, r.latitude);
+    res.maxLngLat.longitude = std::max(res.maxLngLat.longitude, r.longitude);
+    res.maxLngLat.latitude = std::max(res.maxLngLat.latitude, r.latitude);
+  };
+
+  std::vector<Waypoint> decoded;
+  for(GpxWay& way : ways) {
+    size_t n = way.size();
+    if(n == 0) { continue; }
+    for(size_t ii = 0; ii < n; ++ii)
+      addBounds(way.lngLat(ii));
+    res.npts += n;
+    // use (incremental) stats of way if expanded, otherwise decode a temporary copy of points
+    TrackStats tmpstats;
+    TrackStats& stats = way.pts.empty() ? tmpstats : way.stats;
+    std::vector<Waypoint>& pts = way.pts.empty() ? decoded : way.pts;
+    if(way.pts.empty()) {
+      decoded.clear();
+      decoded.reserve(n);
+      for(size_t ii = 0; ii < n; ++ii)
+        decoded.push_back(way.cols.get(ii));
+    }
+    stats.update(pts, istrack, track->hasSpeed, speedInvTau);
+    res.dist += stats.res.trackDist;
+    res.ascent += stats.res.trackAscent;
+    res.descent += stats.res.trackDescent;
+    if(pts.front().loc.time > 0) {
+      if(res.startTime <= 0) res.startTime = pts.front().loc.time;
+      res.duration += pts.back().loc.time - pts.front().loc.time;
+    }
+  }
+  for(const Waypoint& wpt : track->waypoints)
+    addBounds(wpt.lngLat());
+  if(!track->filename.empty())
+    gpxFileInfo(track->filename, res.gpxMTime, res.gpxSize);
+  return res;
 }
 
 // decode encoded polyline, used by Valhalla, Google, etc.
@@ -278,6 +1046,46 @@ std::vector<Waypoint> decodePolylineStr(const std::string& encoded, double preci
 //  like it would be messy
 
 #include "mapsapp.h"
+#include "util/mapProjection.h"
+
+const std::vector<float>& TrackSimplifier::levels(const GpxWay& way)
+{
+  size_t n = way.size();
+  if(tols.size() == n && (n == 0 || (ends[0] == way.lngLat(0) && ends[1] == way.lngLat(n-1))))
+    return tols;
+  tols.assign(n, FLT_MAX);
+  if(n < 3) { return tols; }
+  ends[0] = way.lngLat(0);
+  ends[1] = way.lngLat(n-1);
+
+  std::vector<glm::dvec2> r;
+  r.reserve(n);
+  for(size_t ii = 0; ii < n; ++ii)
+    r.push_back(MapProjection::lngLatToProjectedMeters(way.lngLat(ii)));
+  // tolerance for a point is min of its distance from segment and tolerance of the enclosing split points
+  struct Span { size_t a, b; float tol; };
+  std::vector<Span> stack = {{0, n-1, FLT_MAX}};
+  while(!stack.empty()) {
+    Span sp = stack.back();
+    stack.pop_back();
+    if(sp.b - sp.a < 2) continue;
+    glm::dvec2 ab = r[sp.b] - r[sp.a];
+    double len2 = glm::dot(ab, ab);
+    double maxd = -1;
+    size_t maxidx = sp.a + 1;
+    for(size_t ii = sp.a + 1; ii < sp.b; ++ii) {
+      glm::dvec2 ap = r[ii] - r[sp.a];
+      double t = len2 > 0 ? std::min(std::max(glm::dot(ap, ab)/len2, 0.0), 1.0) : 0;
+      double d = glm::length(ap - t*ab);
+      if(d > maxd) { maxd = d; maxidx = ii; }
+    }
+    float tol = std::min(float(maxd), sp.tol);
+    tols[maxidx] = tol;
+    stack.push_back({sp.a, maxidx, tol});
+    stack.push_back({maxidx, sp.b, tol});
+  }
+  return tols;
+}
 
 UniqueMarkerID::~UniqueMarkerID()
 {
@@ -295,24 +1103,77 @@ void TrackMarker::setProperties(Properties&& props, bool replace)
   }
   MapsApp::inst->tracksDataSource->setProperties(featureId, Properties(markerProps));
   MapsApp::inst->tracksDataSource->clearData();  // this just increments generation counter
+  if(tailMarker > 0) {
+    MapsApp::inst->map->markerSetProperties(tailMarker, Properties(markerProps));
+    MapsApp::inst->map->markerSetVisible(tailMarker, hasTail && markerProps.getNumber("visible") > 0);
+  }
   MapsApp::inst->platform->requestRender();  // move into ClientDataSource?
 }
 
+int TrackMarker::defaultSimplifyZoom = 18;
+
 void TrackMarker::setTrack(GpxWay* way, size_t nways)
 {
+  // half a pixel in projected meters
+  double tol = simplifyZoom > 0 ? 0.5*MapProjection::metersPerPixelAtZoom(simplifyZoom) : 0;
   Tangram::ClientDataSource::PolylineBuilder builder;
   for(size_t jj = 0; jj < nways; ++jj) {
-    builder.beginPolyline(way->pts.size());
-    for(const Waypoint& wp : way->pts)
-      builder.addPoint(wp.lngLat());
+    size_t npts = way->size();
+    if(tol > 0 && npts > 2) {
+      const std::vector<float>& tols = way->simplifier.levels(*way);
+      builder.beginPolyline(std::count_if(tols.begin(), tols.end(), [tol](float t){ return t > tol; }));
+      for(size_t ii = 0; ii < npts; ++ii) {
+        if(tols[ii] > tol)
+          builder.addPoint(way->lngLat(ii));
+      }
+    }
+    else {
+      builder.beginPolyline(npts);
+      for(size_t ii = 0; ii < npts; ++ii)
+        builder.addPoint(way->lngLat(ii));
+    }
     ++way;
   }
   featureId = MapsApp::inst->tracksDataSource->addPolylineFeature(
       Properties(markerProps), std::move(builder), featureId);
   MapsApp::inst->tracksDataSource->generateTiles();
+  nTiledWays = nways;
+  nTiledPts = nways > 0 ? (way-1)->size() : 0;
+  hasTail = false;
+  if(tailMarker > 0)
+    MapsApp::inst->map->markerSetVisible(tailMarker, false);
   MapsApp::inst->platform->requestRender();  // move into ClientDataSource?
 }
 
+// generateTiles() retiles all features, so cost of rebuilding entire track for each new point while
+//  recording grows w/ track length; instead, we draw new points w/ a marker and only rebuild the track
+//  feature once enough points have accumulated
+void TrackMarker::appendTrack(GpxWay* way, size_t nways)
+{
+  auto& pts = way[nways-1].pts;
+  if(featureId == uint64_t(-1) || nways != nTiledWays || pts.size() < nTiledPts || nTiledPts < 1
+      || pts.size() - nTiledPts >= MAX_TAIL_PTS) {
+    setTrack(way, nways);
+    return;
+  }
+  if(pts.size() == nTiledPts) return;
+  auto* map = MapsApp::inst->map.get();
+  if(tailMarker <= 0) {
+    tailMarker = map->markerAdd();
+    map->markerSetStylingFromPath(tailMarker, "layers.track-tail.draw.track");
+    map->markerSetProperties(tailMarker, Properties(markerProps));
+  }
+  // start at last tiled point so tail connects to track
+  std::vector<LngLat> tail;
+  tail.reserve(pts.size() - nTiledPts + 1);
+  for(size_t ii = nTiledPts - 1; ii < pts.size(); ++ii)
+    tail.push_back(pts[ii].lngLat());
+  map->markerSetPolyline(tailMarker, tail.data(), int(tail.size()));
+  hasTail = true;
+  map->markerSetVisible(tailMarker, markerProps.getNumber("visible") > 0);
+  MapsApp::inst->platform->requestRender();
+}
+
 //TrackMarker::TrackMarker() { markerProps.set("visible", 1); }
 TrackMarker::~TrackMarker()
 {
@@ -320,3 +1181,318 @@ TrackMarker::~TrackMarker()
   Tangram::ClientDataSource::PolylineBuilder builder;
   MapsApp::inst->tracksDataSource->addPolylineFeature(Properties(), std::move(builder), featureId);
 }
+
+// Binary track cache: GPX is the source of truth, but parsing a large GPX file is slow, so after parsing we
+//  write a sidecar file w/ track points in TrackColumns layout which can be loaded w/o parsing (the GPX
+//  metadata, waypoints, and routes are small so are just serialized), along w/ the nodes of each track's
+//  TrackSegIndex.  Cache is invalidated if GPX size, mtime, or hash of start and end of file changes, or if
+//  version is changed (must be incremented if format of cache, TrackColumns, or BoxIndex changes)
+
+struct TrackCacheHeader
+{
+  char magic[4] = {'G', 'P', 'X', 'C'};
+  uint32_t version = 3;
+  int64_t gpxMTime = 0;
+  int64_t gpxSize = 0;
+  uint64_t gpxHash = 0;
+};
+
+static uint64_t fnv1a64(const char* data, size_t len, uint64_t h = 0xcbf29ce484222325ULL)
+{
+  for(size_t ii = 0; ii < len; ++ii)
+    h = (h ^ uint8_t(data[ii]))*0x100000001b3ULL;
+  return h;
+}
+
+static bool gpxFileKey(const std::string& filename, TrackCacheHeader& hdr)
+{
+  static constexpr int64_t HASH_BYTES = 4096;
+  if(!gpxFileInfo(filename, hdr.gpxMTime, hdr.gpxSize)) { return false; }
+  FileStream strm(filename.c_str(), "rb");
+  if(!strm.is_open()) { return false; }
+  std::vector<char> buf(HASH_BYTES);
+  hdr.gpxHash = fnv1a64(buf.data(), strm.read(buf.data(), HASH_BYTES));
+  if(hdr.gpxSize > HASH_BYTES) {
+    strm.seek(-std::min(hdr.gpxSize - HASH_BYTES, HASH_BYTES), SEEK_END);
+    hdr.gpxHash = fnv1a64(buf.data(), strm.read(buf.data(), HASH_BYTES), hdr.gpxHash);
+  }
+  return true;
+}
+
+static std::string trackCachePath(const std::string& gpxfile)
+{
+  uint64_t h = fnv1a64(gpxfile.data(), gpxfile.size());
+  return FSPath(MapsApp::baseDir, fstring("cache/tracks/%016llx.bin", (unsigned long long)h)).path;
+}
+
+void removeGPXCache(const std::string& gpxfile)
+{
+  removeFile(trackCachePath(gpxfile));
+}
+
+// all values are padded to multiple of 4 bytes so that columns are aligned
+class TrackCacheWriter
+{
+public:
+  std::string out;
+
+  template<typename T> void put(const T& val) { out.append((const char*)&val, sizeof(T)); pad(); }
+  void put(const std::string& s) {
+    put(uint32_t(s.size()));
+    out.append(s);
+    pad();
+  }
+  template<typename T> void putArray(const std::vector<T>& v) {
+    put(uint32_t(v.size()));
+    out.append((const char*)v.data(), v.size()*sizeof(T));
+    pad();
+  }
+  void putWaypoint(const Waypoint& wpt) {
+    put(wpt.loc);
+    put(wpt.dist);
+    put(uint32_t(wpt.routed));
+    put(wpt.name);
+    put(wpt.desc);
+    put(wpt.props);
+  }
+
+private:
+  void pad() { out.append((4 - out.size()%4)%4, '\0'); }
+};
+
+class TrackCacheReader
+{
+public:
+  TrackCacheReader(const char* data, size_t len) : p(data), end(data + len) {}
+  bool ok = true;
+
+  template<typename T> void get(T& val) {
+    if(!check(sizeof(T))) return;
+    memcpy(&val, p, sizeof(T));
+    p += padded(sizeof(T));
+  }
+  void get(std::string& s) {
+    uint32_t n = 0;
+    get(n);
+    if(!check(n)) return;
+    s.assign(p, n);
+    p += padded(n);
+  }
+  template<typename T> void getArray(std::vector<T>& v) {
+    uint32_t n = 0;
+    get(n);
+    if(!check(size_t(n)*sizeof(T))) return;
+    v.resize(n);
+    if(n > 0) { memcpy(v.data(), p, n*sizeof(T)); }
+    p += padded(n*sizeof(T));
+  }
+  Waypoint getWaypoint() {
+    Waypoint wpt(LngLat(0, 0));
+    uint32_t routed = 1;
+    get(wpt.loc);
+    get(wpt.dist);
+    get(routed);
+    get(wpt.name);
+    get(wpt.desc);
+    get(wpt.props);
+    wpt.routed = routed != 0;
+    return wpt;
+  }
+
+private:
+  const char* p;
+  const char* end;
+
+  static size_t padded(size_t n) { return (n + 3) & ~size_t(3); }
+  bool check(size_t n) { ok = ok && size_t(end - p) >= n; return ok; }
+};
+
+// segment indices of gpx.tracks are built if needed
+static bool writeTrackCache(GpxFile& gpx, const TrackCacheHeader& hdr, const std::string& path)
+{
+  TrackCacheWriter w;
+  w.put(hdr);
+  w.put(gpx.title);
+  w.put(gpx.desc);
+  w.put(gpx.style);
+  w.put(gpx.routeMode);
+  w.put(gpx.timestamp);
+  w.put(uint32_t(gpx.hasSpeed));
+  w.put(uint32_t(gpx.waypoints.size()));
+  for(const Waypoint& wpt : gpx.waypoints)
+    w.putWaypoint(wpt);
+  w.put(uint32_t(gpx.routes.size()));
+  for(const GpxWay& route : gpx.routes) {
+    w.put(route.title);
+    w.put(route.desc);
+    w.put(uint32_t(route.pts.size()));
+    for(const Waypoint& wpt : route.pts)
+      w.putWaypoint(wpt);
+  }
+  w.put(uint32_t(gpx.tracks.size()));
+  for(GpxWay& way : gpx.tracks) {
+    TrackColumns cols;
+    if(!cols.encode(way.pts)) { return false; }
+    w.put(way.title);
+    w.put(way.desc);
+    w.put(cols.time0);
+    w.putArray(cols.lat);  w.putArray(cols.lng);  w.putArray(cols.dtime);
+    w.putArray(cols.alt);  w.putArray(cols.spd);  w.putArray(cols.dir);
+    w.putArray(cols.poserr);  w.putArray(cols.alterr);
+    std::vector<uint32_t> extras;
+    for(size_t ii = 0; ii < way.pts.size(); ++ii) {
+      if(hasExtras(way.pts[ii]))
+        extras.push_back(uint32_t(ii));
+    }
+    w.put(uint32_t(extras.size()));
+    for(uint32_t idx : extras) {
+      w.put(idx);
+      w.putWaypoint(way.pts[idx]);
+    }
+    const BoxIndex& segs = way.segIndex.boxIndex(way);
+    w.put(uint32_t(segs.size()));
+    w.put(uint32_t(segs.nodes().size()));
+    for(const auto& level : segs.nodes())
+      w.putArray(level);
+  }
+  FileStream strm(path.c_str(), "wb");
+  bool ok = strm.is_open() && strm.write(w.out.data(), w.out.size()) == w.out.size();
+  strm.close();
+  if(!ok) { removeFile(path); }
+  return ok;
+}
+
+static bool readTrackCache(const char* data, size_t len, const TrackCacheHeader& key, GpxFile& gpx)
+{
+  TrackCacheHeader hdr;
+  TrackCacheReader r(data, len);
+  r.get(hdr);
+  if(!r.ok || memcmp(hdr.magic, key.magic, 4) != 0 || hdr.version != key.version
+      || hdr.gpxMTime != key.gpxMTime || hdr.gpxSize != key.gpxSize || hdr.gpxHash != key.gpxHash)
+    return false;
+  uint32_t hasSpeed = 0, n = 0;
+  r.get(gpx.title);
+  r.get(gpx.desc);
+  r.get(gpx.style);
+  r.get(gpx.routeMode);
+  r.get(gpx.timestamp);
+  r.get(hasSpeed);
+  gpx.hasSpeed = hasSpeed != 0;
+  r.get(n);
+  for(uint32_t ii = 0; ii < n && r.ok; ++ii)
+    gpx.waypoints.push_back(r.getWaypoint());
+  r.get(n);
+  for(uint32_t ii = 0; ii < n && r.ok; ++ii) {
+    gpx.routes.emplace_back();
+    GpxWay& route = gpx.routes.back();
+    uint32_t npts = 0;
+    r.get(route.title);
+    r.get(route.desc);
+    r.get(npts);
+    for(uint32_t jj = 0; jj < npts && r.ok; ++jj)
+      route.pts.push_back(r.getWaypoint());
+  }
+  r.get(n);
+  for(uint32_t ii = 0; ii < n && r.ok; ++ii) {
+    gpx.tracks.emplace_back();
+    GpxWay& way = gpx.tracks.back();
+    TrackColumns& cols = way.cols;
+    r.get(way.title);
+    r.get(way.desc);
+    r.get(cols.time0);
+    r.getArray(cols.lat);  r.getArray(cols.lng);  r.getArray(cols.dtime);
+    r.getArray(cols.alt);  r.getArray(cols.spd);  r.getArray(cols.dir);
+    r.getArray(cols.poserr);  r.getArray(cols.alterr);
+    size_t npts = cols.lat.size();
+    bool valid = cols.lng.size() == npts && cols.dtime.size() == npts;
+    for(auto* col : {&cols.alt, &cols.spd, &cols.dir, &cols.poserr, &cols.alterr})
+      valid = valid && (col->empty() || col->size() == npts);
+    if(!valid) { return false; }
+    uint32_t nextras = 0, idx = 0;
+    r.get(nextras);
+    for(uint32_t jj = 0; jj < nextras && r.ok; ++jj) {
+      r.get(idx);
+      if(idx >= npts) { return false; }
+      cols.extras.emplace_back(idx, r.getWaypoint());
+    }
+    uint32_t nsegs = 0, nlevels = 0;
+    r.get(nsegs);
+    r.get(nlevels);
+    if(nlevels > 16) { return false; }  // 16^16 segments
+    std::vector< std::vector<BoxIndex::Box> > nodes(nlevels);
+    for(auto& level : nodes)
+      r.getArray(level);
+    BoxIndex segs;
+    if(!r.ok || nsegs + 1 != std::max(npts, size_t(1)) || !segs.setNodes(std::move(nodes), nsegs)) { return false; }
+    way.segIndex.restore(std::move(segs));
+  }
+  return r.ok;
+}
+
+// read entire file, using mmap if available
+static bool readTrackCacheFile(const std::string& path, const TrackCacheHeader& key, GpxFile& gpx)
+{
+#if PLATFORM_WIN
+  FileStream strm(path.c_str(), "rb");
+  if(!strm.is_open()) { return false; }
+  std::vector<char> buf;
+  char chunk[1 << 16];
+  size_t n;
+  while((n = strm.read(chunk, sizeof(chunk))) > 0)
+    buf.insert(buf.end(), chunk, chunk + n);
+  return readTrackCache(buf.data(), buf.size(), key, gpx);
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if(fd < 0) { return false; }
+  struct stat st;
+  bool ok = false;
+  if(fstat(fd, &st) == 0 && st.st_size > 0) {
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data != MAP_FAILED) {
+      ok = readTrackCache((const char*)data, st.st_size, key, gpx);
+      munmap(data, st.st_size);
+    }
+  }
+  close(fd);
+  return ok;
+#endif
+}
+
+bool loadGPXCached(GpxFile* track)
+{
+  // load into temporary so we have values from GPX (and not from DB) to cache
+  GpxFile gpx;
+  gpx.filename = track->filename;
+  gpx.timestamp = 0;
+  TrackCacheHeader key;
+  bool haskey = gpxFileKey(track->filename, key);
+  std::string cachefile = haskey ? trackCachePath(track->filename) : "";
+  int64_t t0 = mSecSinceEpoch();
+  if(haskey && readTrackCacheFile(cachefile, key, gpx))
+    LOGD("Loaded %s from track cache in %d ms", track->filename.c_str(), int(mSecSinceEpoch() - t0));
+  else {
+    gpx = GpxFile();
+    gpx.filename = track->filename;
+    gpx.timestamp = 0;
+    if(!loadGPX(&gpx)) { return false; }
+    if(haskey && !writeTrackCache(gpx, key, cachefile))
+      LOGW("Error writing track cache for %s", track->filename.c_str());
+  }
+
+  // same precedence as loadGPX: values set in UI (and stored in DB) take precedence
+  if(track->title.empty()) track->title = gpx.title;
+  if(track->desc.empty()) track->desc = gpx.desc;
+  if(track->style.empty()) track->style = gpx.style;
+  if(gpx.timestamp > 0) track->timestamp = gpx.timestamp;
+  if(!gpx.routes.empty()) track->routeMode = gpx.routeMode;
+  if(gpx.hasSpeed) track->hasSpeed = true;
+  for(Waypoint& wpt : gpx.waypoints)
+    track->addWaypoint(std::move(wpt));
+  for(GpxWay& route : gpx.routes)
+    track->routes.push_back(std::move(route));
+  for(GpxWay& way : gpx.tracks)
+    track->tracks.push_back(std::move(way));
+  track->loaded = true;
+  track->modified = false;
+  return true;
+}
@@ -300,7 +300,7 @@ std::string MapsApp::getPlaceTitle(const Properties& props) const
   return ref;
 }
 
-void MapsApp::setPickResult(LngLat pos, std::string namestr, const std::string& propstr, PickResultStepper stepper)
+void MapsApp::setPickResult(LngLat pos, std::string namestr, const std::string& _propstr, PickResultStepper stepper)
 {
   static const char* placeInfoProtoSVG = R"#(
     <g layout="flex" flex-direction="column" box-anchor="hfill">
@@ -336,10 +336,13 @@ void MapsApp::setPickResult(LngLat pos, std::string namestr, const std::string&
   if(!placeInfoProto)
     placeInfoProto.reset(loadSVGFragment(placeInfoProtoSVG));
 
+  mapsSearch->cancelReverseGeocode();  // don't replace this result with pending long press result
+  // props from offline search or bookmarks may be in compact blob format; plugins, history, etc. expect JSON
+  const std::string propstr = propsJsonView(_propstr);
   const YAML::Node json = strToJson(propstr.c_str());
   Properties props = jsonToProps(json);
 
-  std::string placetype = !propstr.empty() ? pluginManager->jsCallFn("getPlaceType", propstr) : "";
+  std::string placetype = pluginManager->getPlaceType(props, propstr.c_str());
   if(namestr.empty()) namestr = getPlaceTitle(props);
   if(namestr.empty()) namestr.swap(placetype);  // we can show type instead of name if present
   if(namestr.empty()) {
@@ -673,7 +676,10 @@ void MapsApp::longPressEvent(float x, float y)
   // clear panel history unless editing track/route
   if(!mapsTracks->activeTrack)
     showPanel(infoPanel);
-  setPickResult(LngLat(lng, lat), "", "");
+  // use nearest POI from offline search DB if available, otherwise place info plugins are the fallback
+  double mpp = MapProjection::metersPerPixelAtZoom(map->getZoom());
+  double radius = std::max(cfg()["search"]["reverse_geocode_radius"].as<double>(25), 24*mpp)/1000;  // km
+  mapsSearch->reverseGeocode(LngLat(lng, lat), radius);
 }
 
 void MapsApp::doubleTapEvent(float x, float y)
@@ -712,6 +718,7 @@ void MapsApp::tapEvent(float x, float y)
 {
   //LngLat location;
   map->screenPositionToLngLat(x, y, &tapLocation.longitude, &tapLocation.latitude);
+  tapPickedFeature = false;
 #if 0  //IS_DEBUG
   double xx, yy;
   map->lngLatToScreenPosition(tapLocation.longitude, tapLocation.latitude, &xx, &yy);
@@ -751,6 +758,7 @@ void MapsApp::tapEvent(float x, float y)
   map->pickFeatureAt(x, y, [this](const Tangram::FeaturePickResult* result) {
     if(!result) { return; }
     if(mapsTracks->onFeaturePicked(result)) { tapLocation = {NAN, NAN}; }
+    else { tapPickedFeature = true; }
   });
 }
 
@@ -1601,6 +1609,7 @@ void MapsApp::createGUI(SDL_Window* sdlWin)
   Button* tracksBtn = mapsTracks->createPanel();
   Button* sourcesBtn = mapsSources->createPanel();
   Button* pluginBtn = pluginManager->createPanel();
+  mapsSearch->initPersonalIndex();  // requires bookmark and track tables
 
   //mainToolbar->autoClose = true;
   searchBtn->mMenu->autoClose = true;
@@ -2381,6 +2390,9 @@ MapsApp::MapsApp(Platform* _platform) : touchHandler(new TouchHandler(this))
   }
   else {
     placesDB.db = bkmkDB;
+    // bkmkDB is also used from offline worker thread
+    if(!placesDB.exec("PRAGMA journal_mode=WAL;"))
+      LOGW("Error enabling WAL for places DB: %s", placesDB.errMsg());
     if(sqlite3_create_function(bkmkDB, "osmSearchRank", 3, SQLITE_UTF8, 0, udf_osmSearchRank, 0, 0) != SQLITE_OK)
       LOGE("sqlite3_create_function: error creating osmSearchRank for places DB");
 
@@ -2405,6 +2417,7 @@ MapsApp::MapsApp(Platform* _platform) : touchHandler(new TouchHandler(this))
 
   // create required folders
   createPath(FSPath(baseDir, "cache")); //, 0777);
+  createPath(FSPath(baseDir, "cache/tracks"));
   createPath(FSPath(baseDir, "tracks")); //, 0777);
   createPath(FSPath(baseDir, ".trash"));  //, 0777);
   removeDir(FSPath(baseDir, ".trash"), false);  // empty trash
@@ -2569,9 +2582,12 @@ bool MapsApp::drawFrame(int fbWidth, int fbHeight)
     pickedMarkerId = 0;
   }
   else if(!std::isnan(tapLocation.longitude)) {
-    if(!panelHistory.empty() && panelHistory.back() == infoPanel)
+    bool dismissed = !panelHistory.empty() && panelHistory.back() == infoPanel;
+    if(dismissed)
       popPanel();  // closing info panel will clear pick result
-    mapsTracks->tapEvent(tapLocation);
+    // tap which dismisses info panel or hits another feature should not open a nearby track
+    if(!mapsTracks->tapEvent(tapLocation) && !dismissed && !tapPickedFeature)
+      mapsTracks->openNearestTrack(tapLocation);
     tapLocation = {NAN, NAN};
   }
 
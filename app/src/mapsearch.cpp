@@ -11,6 +11,8 @@
 #include "mapwidgets.h"
 #include "offlinemaps.h"
 #include "mapsources.h"
+#include "gpxfile.h"
+#include "searchdb.h"
 
 #include "data/tileData.h"
 #include "data/formats/mvt.h"
@@ -23,10 +25,48 @@
 #include "ugui/widgets.h"
 #include "ugui/textedit.h"
 
+#include <list>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <unordered_set>
+
 // building search DB from tiles
 SQLiteDB MapsSearch::searchDB;
-static sqlite3_stmt* insertStmt = NULL;
+static PoiInsertStmts mainInsertStmts;
 static bool hasSearchData = false;
+// incremented when offline region POIs are added or removed, to invalidate cached autocomplete results
+static std::atomic_int offlineRegionVersion = {0};
+// bounds of POI changes not yet seen by clusterMapSearch(), so only cluster cells in those areas are refetched
+static std::mutex changedBoundsMutex;
+static std::vector< std::pair<LngLat, LngLat> > changedBounds;
+static std::atomic_bool hasTrigramIndex = {false};
+static std::atomic_bool hasTagIndex = {false};  // tag index in main DB covers all POIs
+static std::atomic_uint searchTileZooms = {0};  // bit z set if any tiles at zoom z are indexed
+// main DB tile ids are legacy (z<<48|x<<24|y) until MORTON_MIGRATION commits; tile_id ranges only work w/ Morton ids
+static std::atomic_bool mortonTileIds = {true};
+
+// zooms to pass to tileRangeSql(); 0 (no tile_id ranges) until migration to Morton tile ids is complete
+static unsigned int rangeTileZooms() { return mortonTileIds ? searchTileZooms.load() : 0; }
+
+// per-region search DB shards: POIs for offline map N are stored in search/N.sqlite, attached to searchDB as
+//  shardN, so deleting a region is just a file delete; rowids start at N << 32 to be unique across shards.
+//  Tiles are still registered in main offline_tiles, so a tile shared by regions is only indexed once
+struct SearchShard { PoiInsertStmts stmts; bool trigram = false; bool tags = false; };
+static std::mutex shardMutex;
+static std::map<int, SearchShard> searchShards;  // shards attached to searchDB
+static std::atomic_int shardsVersion = {0};
+static bool useShards = true;
+static SearchShard* attachShard(int mapId, bool create);
+
+static FSPath shardPath(int mapId) { return FSPath(MapsApp::baseDir, "search").child(fstring("%d.sqlite", mapId)); }
+static std::string shardSchema(int mapId) { return fstring("shard%d", mapId); }
+
+std::string MapsSearch::shardFile(int mapId)
+{
+  FSPath path = shardPath(mapId);
+  return path.exists() ? path.path : "";
+}
 
 class DummyStyleContext : public Tangram::StyleContext {
 public:
@@ -34,7 +74,7 @@ public:
 };
 static DummyStyleContext dummyStyleContext;
 
-static void processTileData(TileTask* task, sqlite3_stmt* stmt, const std::vector<SearchData>& searchData)
+static void processTileData(TileTask* task, const PoiInsertStmts& st, int64_t tileId, const std::vector<SearchData>& searchData)
 {
   using namespace Tangram;
   auto tileData = task->source() ? task->source()->parse(*task) : Mvt::parseTile(*task, 0);
@@ -51,57 +91,92 @@ static void processTileData(TileTask* task, sqlite3_stmt* stmt, const std::vecto
             LOGD("Rejecting POI outside tile: %s", featname.c_str());
             continue;
           }
-          auto lnglat = tileCoordToLngLat(task->tileId(), pt);
-          std::string tags;
-          for(const std::string& field : searchdata.fields) {
-            const std::string& s = feature.props.getString(field);
-            if(!s.empty())
-              tags.append(s).append(" ");
-          }
-          // insert row
-          sqlite3_bind_text(stmt, 1, featname.c_str(), -1, SQLITE_STATIC);
-          sqlite3_bind_text(stmt, 2, tags.c_str(), tags.size() - 1, SQLITE_STATIC);  // drop trailing separator
-          sqlite3_bind_text(stmt, 3, feature.props.toJson().c_str(), -1, SQLITE_TRANSIENT);
-          sqlite3_bind_double(stmt, 4, lnglat.longitude);
-          sqlite3_bind_double(stmt, 5, lnglat.latitude);
-          if(sqlite3_step(stmt) != SQLITE_DONE)
-            LOGE("sqlite3_step failed: %s\n", sqlite3_errmsg(sqlite3_db_handle(stmt)));
-          //sqlite3_clear_bindings(stmt);  -- retain binding for tile_id set by caller
-          sqlite3_reset(stmt);  // necessary to reuse statement
+          insertPoi(st, featname, tileCoordToLngLat(task->tileId(), pt), tileId, searchdata.fields, feature.props);
         }
       }
     }
   }
 }
 
+static void updateTileZooms()
+{
+  unsigned int zooms = 0;
+  MapsSearch::searchDB.stmt("SELECT tile_id FROM offline_tiles;").exec([&](int64_t id){
+    int z = unpackTileId(id).z;
+    if(z >= 0 && z < 32) zooms |= 1u << z;
+  });
+  searchTileZooms = zooms;
+}
+
+static void searchDataChanged(LngLat lngLat00, LngLat lngLat11)
+{
+  std::lock_guard<std::mutex> lock(changedBoundsMutex);
+  // many changes (e.g. offline map download) - just invalidate everything
+  if(changedBounds.size() >= 256) {
+    changedBounds.clear();
+    lngLat00 = LngLat(-180, -90);
+    lngLat11 = LngLat(180, 90);
+  }
+  changedBounds.emplace_back(lngLat00, lngLat11);
+}
+
+static void searchDataChanged(TileID tileId)
+{
+  LngLat a = tileCoordToLngLat(tileId, {0, 0}), b = tileCoordToLngLat(tileId, {1, 1});
+  searchDataChanged(LngLat(std::min(a.longitude, b.longitude), std::min(a.latitude, b.latitude)),
+      LngLat(std::max(a.longitude, b.longitude), std::max(a.latitude, b.latitude)));
+}
+
 void MapsSearch::indexTileData(TileTask* task, int mapId, const std::vector<SearchData>& searchData)
 {
   auto tileId = task->tileId();
   int64_t packedId = packTileId(tileId), cnt = -1;
   if(!searchDB.stmt("SELECT 1 FROM offline_tiles WHERE tile_id = ? LIMIT 1;").bind(packedId).onerow(cnt)) {
     LOGTInit(">>> indexing tile %s", tileId.toString().c_str());
-    sqlite3_bind_int64(insertStmt, 6, packedId);  //rowId);  // bind tile_id
+    std::lock_guard<std::mutex> lock(shardMutex);
+    SearchShard* shard = mapId > 0 && useShards ? attachShard(mapId, true) : NULL;
+    const PoiInsertStmts& st = shard ? shard->stmts : mainInsertStmts;
+    sqlite3_bind_int64(st.poi, 6, packedId);  //rowId);  // bind tile_id
     searchDB.exec("BEGIN TRANSACTION");
-    processTileData(task, insertStmt, searchData);
+    processTileData(task, st, packedId, searchData);
     searchDB.exec("COMMIT TRANSACTION");
     LOGT("<<< indexing tile %s", tileId.toString().c_str());
     LOGD("Search indexing completed for tile %s", tileId.toString().c_str());
+    searchDataChanged(tileId);
+    if(mapId != EPHEMERAL_MAP_ID) { ++offlineRegionVersion; }
   }
   searchDB.stmt("INSERT INTO offline_tiles (tile_id, offline_id) VALUES (?,?);").bind(packedId, mapId).exec();
-  hasSearchData = true;
+  searchTileZooms |= 1u << tileId.z;
+  if(mapId != EPHEMERAL_MAP_ID)
+    hasSearchData = true;
 }
 
 void MapsSearch::importPOIs(std::string srcuri, int offlineId)
 {
   static const char* poiImportSQL = R"#(ATTACH DATABASE '%s' AS poidb;
     BEGIN;
-    INSERT INTO main.pois SELECT * FROM poidb.pois;
-    INSERT INTO main.offline_tiles SELECT tile_id, %d FROM poidb.pois GROUP BY tile_id;
+    INSERT INTO %s.pois (rowid, name, tags, props, lng, lat, tile_id) SELECT %lld + rowid, name, tags, props,
+        lng, lat, mortonTileId(tile_id) FROM poidb.pois;
+    INSERT INTO main.offline_tiles SELECT mortonTileId(tile_id), %d FROM poidb.pois GROUP BY tile_id;
     COMMIT;
   )#";
 
-  if(searchDB.exec(fstring(poiImportSQL, srcuri.c_str(), offlineId)))
+  std::lock_guard<std::mutex> lock(shardMutex);
+  bool sharded = useShards && attachShard(offlineId, true);
+  std::string schema = sharded ? shardSchema(offlineId) : "main";
+  long long rowbase = sharded ? int64_t(offlineId) << 32 : 0;
+  searchDataChanged(LngLat(-180, -90), LngLat(180, 90));
+  ++offlineRegionVersion;
+  if(searchDB.exec(fstring(poiImportSQL, srcuri.c_str(), schema.c_str(), rowbase, offlineId))) {
     LOG("POI import from %s completed", srcuri.c_str());
+    // imported POIs have no tag postings until backfillTagIndex() runs
+    searchDB.exec(fstring("PRAGMA %s.user_version = 1;", schema.c_str()));
+    if(sharded)
+      searchShards[offlineId].tags = false;
+    else
+      hasTagIndex = false;
+    updateTileZooms();
+  }
   else
     LOGE("SQL error importing POIs from %s: %s", srcuri.c_str(), searchDB.errMsg());
   // make sure DB is detached even if import fails
@@ -114,11 +189,205 @@ void MapsSearch::onDelOfflineMap(int mapId)
   //DELETE FROM tiles WHERE id IN (SELECT tile_id FROM offline_tiles WHERE offline_id = ? AND
   //  tile_id NOT IN (SELECT tile_id FROM offline_tiles WHERE offline_id <> ?));
   // need to use sqlite3_exec for multiple statments in single string
-  searchDB.stmt("DELETE FROM offline_tiles WHERE offline_id = ?;").bind(mapId).exec();
-  searchDB.stmt("DELETE FROM pois WHERE tile_id NOT IN (SELECT tile_id FROM offline_tiles);").exec();
+  std::lock_guard<std::mutex> lock(shardMutex);
+  SearchShard* shard = attachShard(mapId, false);
+  if(!shard) {
+    searchDB.stmt("DELETE FROM offline_tiles WHERE offline_id = ?;").bind(mapId).exec();
+    searchDB.stmt("DELETE FROM pois WHERE tile_id NOT IN (SELECT tile_id FROM offline_tiles);").exec();
+    searchDB.stmt("DELETE FROM poi_tags WHERE tile_id NOT IN (SELECT tile_id FROM offline_tiles);").exec();
+    searchDataChanged(LngLat(-180, -90), LngLat(180, 90));
+    ++offlineRegionVersion;
+    return;
+  }
+  // POIs for tiles shared with other regions (or indexed from cache) are moved to main DB; rowids are kept
+  //  (unique across shards) so tag postings can be copied too.  POIs in main DB for region's tiles (indexed
+  //  before region was downloaded) not used by any other region are deleted as in the unsharded case
+  std::string schema = shardSchema(mapId);
+  static const char* rehomeSQL = R"#(BEGIN;
+    CREATE TEMP TABLE region_tiles AS SELECT tile_id FROM main.offline_tiles WHERE offline_id = %d;
+    CREATE TEMP TABLE shared_tiles AS SELECT DISTINCT tile_id FROM main.offline_tiles WHERE offline_id <> %d;
+    INSERT INTO main.pois (rowid, name, tags, props, lng, lat, tile_id) SELECT rowid, name, tags, props, lng, lat,
+        tile_id FROM {s}.pois WHERE tile_id IN shared_tiles;
+    INSERT OR IGNORE INTO main.tag_values (key, value, tokens) SELECT key, value, tokens FROM {s}.tag_values;
+    INSERT OR IGNORE INTO main.poi_tags (tag_id, tile_id, poi_id) SELECT mt.id, pt.tile_id, pt.poi_id
+        FROM {s}.poi_tags AS pt JOIN {s}.tag_values AS st ON st.id = pt.tag_id
+        JOIN main.tag_values AS mt ON mt.key = st.key AND mt.value = st.value WHERE pt.tile_id IN shared_tiles;
+    DROP TABLE temp.shared_tiles;
+    DELETE FROM main.offline_tiles WHERE offline_id = %d;
+    DELETE FROM main.pois WHERE tile_id IN temp.region_tiles
+        AND tile_id NOT IN (SELECT tile_id FROM main.offline_tiles);
+    DELETE FROM main.poi_tags WHERE tile_id IN temp.region_tiles
+        AND tile_id NOT IN (SELECT tile_id FROM main.offline_tiles);
+    DROP TABLE temp.region_tiles;
+    COMMIT;
+  )#";
+  std::string sql = schemaSql(fstring(rehomeSQL, mapId, mapId, mapId), schema);
+  if(!searchDB.exec(sql)) {
+    LOGE("SQL error removing search shard %s: %s", schema.c_str(), searchDB.errMsg());
+    searchDB.exec("ROLLBACK;");
+  }
+  shard->stmts.finalize();
+  searchShards.erase(mapId);
+  if(!searchDB.exec(fstring("DETACH DATABASE %s;", schema.c_str())))
+    LOGE("SQL error detaching %s: %s", schema.c_str(), searchDB.errMsg());
+  FSPath path = shardPath(mapId);
+  removeFile(path.path);
+  removeFile(path.path + "-wal");
+  removeFile(path.path + "-shm");
+  ++shardsVersion;
+  searchDataChanged(LngLat(-180, -90), LngLat(180, 90));
+  ++offlineRegionVersion;
   //searchDB.stmt("DELETE FROM tiles WHERE id NOT IN (SELECT tile_id FROM offline_tiles);").exec();
 }
 
+bool MapsSearch::hasTileData(TileID tileId)
+{
+  int64_t cnt = 0;
+  return searchDB.stmt("SELECT 1 FROM offline_tiles WHERE tile_id = ? LIMIT 1;").bind(packTileId(tileId)).onerow(cnt);
+}
+
+// nearest named POI within radius (km, capped at MAX_REVERSE_GEOCODE_KM) of pos, preferring POIs with any of the
+//  tags in search.reverse_geocode_prefer; candidates are fetched by tile_id range, so only a few tiles are scanned
+//  instead of the whole pois table.  Runs on searchWorker, then shows place info for pos, w/ name and address of
+//  the POI if found
+void MapsSearch::reverseGeocode(LngLat pos, double radius)
+{
+  int64_t gen = ++placeSearchGen;
+  if(!searchTileZooms) {
+    app->setPickResult(pos, "", "");
+    return;
+  }
+  radius = std::min(radius, MAX_REVERSE_GEOCODE_KM);
+  std::vector<std::string> prefer;
+  const YAML::Node& prefnode = app->cfg()["search"]["reverse_geocode_prefer"];
+  if(prefnode.IsSequence()) {
+    for(auto& node : prefnode)
+      prefer.push_back(node.Scalar());
+  }
+  else
+    prefer = {"addr:housenumber", "amenity", "shop", "tourism", "leisure", "building"};
+  float preferWeight = app->cfg()["search"]["reverse_geocode_prefer_weight"].as<float>(0.5f);
+
+  searchWorker.enqueue([=](){
+    if(gen < placeSearchGen) { return; }
+    int64_t t0 = mSecSinceEpoch();
+    double dlat = radius/111.32;  // 1 degree latitude = 111.32 km
+    double dlng = dlat/std::max(0.01, cos(pos.latitude*M_PI/180));
+    LngLat lngLat00(pos.longitude - dlng, pos.latitude - dlat), lngLat11(pos.longitude + dlng, pos.latitude + dlat);
+    std::vector<std::string> tileRanges = tileRangeSql(lngLat00, lngLat11, 4, rangeTileZooms());
+    std::string tileCond = tileRanges.empty() ? "" : "(" + joinStr(tileRanges, " OR ") + ") AND ";
+
+    // not cached since tile_id ranges vary
+    SQLiteDB& db = readDB ? *readDB : searchDB;
+    std::string sql = unionSql(searchSchemas(db), "SELECT pois.rowid, name, props, lng, lat FROM {pois} WHERE "
+        + tileCond + "name <> '' AND lng BETWEEN ?1 AND ?2 AND lat BETWEEN ?3 AND ?4", ";");
+    double bestScore = INFINITY;
+    SearchResult result;
+    SQLiteStmt(db.db, sql).bind(lngLat00.longitude, lngLat11.longitude, lngLat00.latitude, lngLat11.latitude)
+        .exec([&](int64_t rowid, const char* name, const char* props, double lng, double lat){
+      double dist = lngLatDist(pos, LngLat(lng, lat));
+      if(dist > radius) { return; }
+      bool preferred = false;
+      if(isPropsBlob(props)) {
+        PropsView view(props);
+        for(auto& key : prefer) {
+          if(view.find(key.c_str())) { preferred = true; break; }
+        }
+      }
+      else {
+        Properties jprops = jsonToProps(props ? props : "");
+        for(auto& key : prefer) {
+          if(jprops.contains(key)) { preferred = true; break; }
+        }
+      }
+      double score = preferred ? dist*preferWeight : dist;
+      if(score < bestScore) {
+        bestScore = score;
+        result = SearchResult{rowid, LngLat(lng, lat), float(dist), props};
+      }
+    });
+    bool found = !std::isinf(bestScore);
+    LOGD("Reverse geocode found %s in %d tiles in %d ms", found ? "POI" : "nothing",
+        int(tileRanges.size()), int(mSecSinceEpoch() - t0));
+    // pressed position is kept - POI may be up to radius away - and only its name and address are used
+    Properties placeProps;
+    if(found) {
+      for(auto& item : jsonToProps(result.tags).items()) {
+        if(item.key == "name" || item.key.compare(0, 5, "addr:") == 0)
+          placeProps.setValue(item.key, item.value);
+      }
+    }
+    std::string placeJson = found ? placeProps.toJson() : "";
+
+    MapsApp::runOnMainThread([=](){
+      if(gen < placeSearchGen) { return; }  // long press elsewhere or other place picked in the meantime
+      app->setPickResult(pos, "", placeJson);
+    });
+  });
+}
+
+// remove oldest tiles indexed from cache (run on offline worker thread)
+void MapsSearch::trimEphemeralTiles(int maxTiles)
+{
+  int ntiles = 0;
+  searchDB.stmt("SELECT count(1) FROM offline_tiles WHERE offline_id = ?;").bind(EPHEMERAL_MAP_ID).onerow(ntiles);
+  if(ntiles <= maxTiles) { return; }
+  std::vector<int64_t> evicted;
+  searchDB.stmt("SELECT tile_id FROM offline_tiles WHERE offline_id = ? ORDER BY rowid LIMIT ?;")
+      .bind(EPHEMERAL_MAP_ID, ntiles - maxTiles).exec([&](int64_t id){ evicted.push_back(id); });
+  searchDB.exec("BEGIN TRANSACTION");
+  for(int64_t id : evicted) {
+    searchDB.stmt("DELETE FROM offline_tiles WHERE tile_id = ? AND offline_id = ?;").bind(id, EPHEMERAL_MAP_ID).exec();
+    // tile may also belong to an offline map
+    searchDB.stmt("DELETE FROM pois WHERE tile_id = ?1 AND NOT EXISTS"
+        " (SELECT 1 FROM offline_tiles WHERE tile_id = ?1);").bind(id).exec();
+    searchDB.stmt("DELETE FROM poi_tags WHERE tile_id = ?1 AND NOT EXISTS"
+        " (SELECT 1 FROM offline_tiles WHERE tile_id = ?1);").bind(id).exec();
+  }
+  searchDB.exec("COMMIT TRANSACTION");
+  for(int64_t id : evicted)
+    searchDataChanged(unpackTileId(id));
+  LOGD("Evicted %d cached tiles from search index", int(evicted.size()));
+}
+
+// index POIs from cached tiles around current view, so "nearby" search works w/o offline map
+void MapsSearch::indexViewportTiles()
+{
+  if(!app->cfg()["search"]["index_cached_tiles"].as<bool>(true)) { return; }
+  Map* map = app->map.get();
+  LngLat lngLat00, lngLat11;
+  app->getMapBounds(lngLat00, lngLat11);
+  LngLat center = app->getMapCenter();
+  // don't repeat for small pans
+  double span = lngLatDist(lngLat00, lngLat11);
+  if(lngLatDist(center, ephemeralIndexCenter) < span/4) { return; }
+  ephemeralIndexCenter = center;
+
+  const YAML::Node& searchYaml = app->sceneConfig()["application"]["search_data"];
+  if(!searchYaml) { return; }
+  int maxTiles = app->cfg()["search"]["max_cached_index_tiles"].as<int>(512);
+  for(auto& src : map->getScene()->tileSources()) {
+    const std::string& cacheFile = src->offlineInfo().cacheFile;
+    if(src->isRaster() || cacheFile.empty()) { continue; }
+    int z = src->maxZoom();
+    if(map->getZoom() < z - 3) { continue; }  // too many tiles
+    TileID tile00 = lngLatTile(lngLat00, z);
+    TileID tile11 = lngLatTile(lngLat11, z);
+    std::deque<TileID> tiles;
+    for(int x = tile00.x; x <= tile11.x; ++x) {
+      for(int y = tile11.y; y <= tile00.y; ++y)  // note y tile index incr for decr latitude
+        tiles.emplace_back(x, y, z);
+    }
+    // nearest tiles first
+    TileID ctile = lngLatTile(center, z);
+    std::sort(tiles.begin(), tiles.end(), [&](const TileID& a, const TileID& b){
+      return std::abs(a.x - ctile.x) + std::abs(a.y - ctile.y) < std::abs(b.x - ctile.x) + std::abs(b.y - ctile.y);
+    });
+    if(int(tiles.size()) > maxTiles/2) { tiles.resize(maxTiles/2); }
+    MapsOffline::indexCachedTiles(cacheFile, std::move(tiles), std::make_shared<YAML::Node>(searchYaml.clone()), maxTiles);
+  }
+}
+
 std::vector<SearchData> MapsSearch::parseSearchFields(const YAML::Node& node)
 {
   std::vector<SearchData> searchData;
@@ -136,32 +405,79 @@ std::vector<SearchData> MapsSearch::parseSearchFields(const YAML::Node& node)
   return searchData;
 }
 
-static const char* POI_SCHEMA = R"SQL(BEGIN;
---CREATE TABLE tiles(id INTEGER PRIMARY KEY, z INTEGER, x INTEGER, y INTEGER, timestamp INTEGER DEFAULT (CAST(strftime('%s') AS INTEGER)));
---CREATE UNIQUE INDEX tiles_tile_id ON tiles (z, x, y);
-CREATE TABLE offline_tiles(tile_id INTEGER, offline_id INTEGER);
-CREATE UNIQUE INDEX offline_index ON offline_tiles (tile_id, offline_id);
-CREATE TABLE pois(name TEXT, tags TEXT, props TEXT, lng REAL, lat REAL, tile_id INTEGER);
-CREATE VIRTUAL TABLE pois_fts USING fts5(name, tags, content='pois');
-CREATE INDEX pois_tile_id ON pois (tile_id);
-
--- trigger to delete pois when tile row deleted
---CREATE TRIGGER tiles_delete AFTER DELETE ON tiles BEGIN
---  DELETE FROM pois WHERE tile_id = OLD.rowid;
---END;
-
--- triggers to keep the FTS index up to date.
-CREATE TRIGGER pois_insert AFTER INSERT ON pois BEGIN
-  INSERT INTO pois_fts(rowid, name, tags) VALUES (NEW.rowid, NEW.name, NEW.tags);
-END;
-CREATE TRIGGER pois_delete AFTER DELETE ON pois BEGIN
-  INSERT INTO pois_fts(pois_fts, rowid, name, tags) VALUES ('delete', OLD.rowid, OLD.name, OLD.tags);
-END;
-CREATE TRIGGER pois_update AFTER UPDATE ON pois BEGIN
-  INSERT INTO pois_fts(pois_fts, rowid, name, tags) VALUES ('delete', OLD.rowid, OLD.name, OLD.tags);
-  INSERT INTO pois_fts(rowid, name, tags) VALUES (NEW.rowid, NEW.name, NEW.tags);
-END;
-COMMIT;)SQL";
+// attach shard for offline map mapId to searchDB, creating it if necessary; shardMutex must be held
+static SearchShard* attachShard(int mapId, bool create)
+{
+  auto it = searchShards.find(mapId);
+  if(it != searchShards.end()) { return &it->second; }
+  FSPath path = shardPath(mapId);
+  if(!path.exists()) {
+    if(!create) { return NULL; }
+    SQLiteDB shardDB;
+    if(shardDB.open(path.path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE) != SQLITE_OK) {
+      LOGE("Error creating search shard %s", path.c_str());
+      return NULL;
+    }
+    shardDB.exec(POI_SCHEMA);
+    shardDB.exec("PRAGMA journal_mode=WAL;");
+    if(hasTrigramIndex)
+      shardDB.exec(TRIGRAM_SCHEMA);
+  }
+  std::string schema = shardSchema(mapId);
+  auto& db = MapsSearch::searchDB;
+  if(!db.exec(fstring("ATTACH DATABASE '%s' AS %s;", path.c_str(), schema.c_str()))) {
+    // SQLITE_MAX_ATTACHED is 10 by default
+    LOGE("Error attaching search shard %s: %s", path.c_str(), db.errMsg());
+    return NULL;
+  }
+  SearchShard shard;
+  std::string sql = fstring("INSERT INTO %s.pois (rowid,name,tags,props,lng,lat,tile_id) VALUES ((SELECT"
+      " ifnull(max(rowid), %lld) + 1 FROM %s.pois),?,?,?,?,?,?);", schema.c_str(), (long long)mapId << 32, schema.c_str());
+  if(!preparePoiInsert(MapsSearch::searchDB, schema, sql, shard.stmts)) {
+    db.exec(fstring("DETACH DATABASE %s;", schema.c_str()));
+    return NULL;
+  }
+  db.stmt(fstring("SELECT 1 FROM %s.sqlite_master WHERE name = 'pois_trigram';", schema.c_str()))
+      .exec([&](int){ shard.trigram = true; });
+  int version = 0;
+  db.stmt(fstring("PRAGMA %s.user_version;", schema.c_str())).onerow(version);
+  shard.tags = version >= 2;
+  ++shardsVersion;
+  return &(searchShards[mapId] = shard);
+}
+
+// schemas to search on db (searchDB or readDB), attaching and detaching shards on readDB as needed
+std::vector<std::string> MapsSearch::searchSchemas(SQLiteDB& db, bool trigram)
+{
+  std::map<int, SearchShard> shards;
+  {
+    std::lock_guard<std::mutex> lock(shardMutex);
+    shards = searchShards;
+  }
+  if(&db != &searchDB && readShardsVersion != shardsVersion) {
+    readShardsVersion = shardsVersion;
+    for(auto it = readShards.begin(); it != readShards.end();) {
+      if(shards.count(*it)) { ++it; continue; }
+      db.exec(fstring("DETACH DATABASE %s;", shardSchema(*it).c_str()));
+      it = readShards.erase(it);
+    }
+    for(auto& shard : shards) {
+      if(readShards.count(shard.first)) { continue; }
+      if(db.exec(fstring("ATTACH DATABASE '%s' AS %s;", shardPath(shard.first).c_str(), shardSchema(shard.first).c_str())))
+        readShards.insert(shard.first);
+      else
+        LOGE("Error attaching search shard %d to read connection: %s", shard.first, db.errMsg());
+    }
+  }
+  std::vector<std::string> schemas;
+  if(!trigram || hasTrigramIndex)
+    schemas.push_back("main");
+  for(auto& shard : shards) {
+    if((&db == &searchDB || readShards.count(shard.first)) && (!trigram || shard.second.trigram))
+      schemas.push_back(shardSchema(shard.first));
+  }
+  return schemas;
+}
 
 bool MapsSearch::initSearch()
 {
@@ -190,25 +506,154 @@ bool MapsSearch::initSearch()
     }
   }
   //"PRAGMA synchronous=OFF; PRAGMA count_changes=OFF; PRAGMA journal_mode=MEMORY; PRAGMA temp_store=MEMORY"
+  // WAL allows reads on other connections to proceed while offline worker is writing
+  if(!searchDB.exec("PRAGMA journal_mode=WAL;"))
+    LOGW("Error enabling WAL for search DB: %s", searchDB.errMsg());
 
-  char const* stmtStr = "INSERT INTO pois (name,tags,props,lng,lat,tile_id) VALUES (?,?,?,?,?,?);";
-  if(sqlite3_prepare_v2(searchDB.db, stmtStr, -1, &insertStmt, NULL) != SQLITE_OK) {
-    LOGE("sqlite3_prepare_v2 error: %s\n", searchDB.errMsg());
+  char const* stmtStr = "INSERT INTO main.pois (name,tags,props,lng,lat,tile_id) VALUES (?,?,?,?,?,?);";
+  if(!preparePoiInsert(MapsSearch::searchDB, "main", stmtStr, mainInsertStmts))
     return false;
-  }
 
   if(sqlite3_create_function(searchDB.db, "osmSearchRank", 3, SQLITE_UTF8, 0, udf_osmSearchRank, 0, 0) != SQLITE_OK)
     LOGE("sqlite3_create_function: error creating osmSearchRank for search DB");
+  if(sqlite3_create_function(searchDB.db, "mortonTileId", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0, udf_mortonTileId, 0, 0) != SQLITE_OK)
+    LOGE("sqlite3_create_function: error creating mortonTileId for search DB");
+
+  // attach existing shards - note hasTrigramIndex not yet set, but only used when creating shard
+  useShards = app->cfg()["search"]["shard_regions"].as<bool>(true);
+  FSPath shardDir(MapsApp::baseDir, "search");
+  createPath(shardDir);
+  {
+    std::lock_guard<std::mutex> lock(shardMutex);
+    for(auto& file : lsDirectory(shardDir)) {
+      int mapId = atoi(file.c_str());
+      if(mapId > 0 && shardDir.child(file).extension() == "sqlite")
+        attachShard(mapId, false);
+    }
+  }
+
+  int dbversion = 0;
+  searchDB.stmt("PRAGMA user_version;").onerow(dbversion);
+  hasTagIndex = dbversion >= 2;
+  if(dbversion < 1) {
+    // rewrites every POI, so run on offline worker; indexTileData and importPOIs already use Morton ids, but
+    //  searches can't use tile_id ranges until all ids are converted
+    mortonTileIds = false;
+    MapsOffline::queueOfflineTask(-1, [](){
+      if(searchDB.exec(MORTON_MIGRATION)) {
+        LOG("Migrated search DB to Morton tile ids");
+        mortonTileIds = true;
+        if(hasTrigramIndex) {
+          searchDB.exec("CREATE TRIGGER IF NOT EXISTS pois_trigram_update AFTER UPDATE OF name ON pois BEGIN"
+              " INSERT INTO pois_trigram(pois_trigram, rowid, name) VALUES ('delete', OLD.rowid, OLD.name);"
+              " INSERT INTO pois_trigram(rowid, name) VALUES (NEW.rowid, NEW.name); END;");
+        }
+        updateTileZooms();
+      }
+      else {
+        LOGE("Error migrating search DB tile ids: %s", searchDB.errMsg());
+        searchDB.exec("ROLLBACK;");
+      }
+    });
+  }
+
+  int hastrigram = 0;
+  searchDB.stmt("SELECT 1 FROM sqlite_master WHERE name = 'pois_trigram';").onerow(hastrigram);
+  if(hastrigram)
+    hasTrigramIndex = true;
+  else if(app->cfg()["search"]["trigram_index"].as<bool>(true)) {
+    // building index for existing POIs can take a while, so do it on offline worker thread
+    MapsOffline::queueOfflineTask(-1, [](){
+      if(searchDB.exec(TRIGRAM_SCHEMA)) {
+        hasTrigramIndex = true;
+        LOG("Created trigram index for offline search");
+      }
+      else {
+        LOGW("Error creating trigram index (requires SQLite 3.34+): %s", searchDB.errMsg());
+        searchDB.exec("ROLLBACK;");
+      }
+    });
+  }
+
+  // searchWorker gets its own connection (and thus its own prepared statements and osmSearchRank origin)
+  readDB.reset(new SQLiteDB);
+  if(readDB->open(dbPath.c_str(), SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX) != SQLITE_OK) {
+    LOGE("Error opening read connection for %s - searches will use write connection", dbPath.c_str());
+    readDB.reset();
+  }
+  else if(sqlite3_create_function(readDB->db, "osmSearchRank", 3, SQLITE_UTF8, &readRankOrigin, udf_osmSearchRank, 0, 0) != SQLITE_OK)
+    LOGE("sqlite3_create_function: error creating osmSearchRank for search DB read connection");
 
   //searchDB.stmt("SELECT COUNT(1) FROM pois;").onerow(npois);  -- counting rows is slow!
-  searchDB.stmt("SELECT rowid FROM pois LIMIT 1;").exec([](int64_t){ hasSearchData = true; });
+  // POIs from cached tiles don't count
+  searchDB.stmt("SELECT 1 FROM offline_tiles WHERE offline_id <> ? LIMIT 1;").bind(EPHEMERAL_MAP_ID)
+      .exec([](int64_t){ hasSearchData = true; });
+  updateTileZooms();
 
   return true;
 }
 
+// personal data index: bookmarks, tracks and track waypoints in places DB (PERSONAL_SCHEMA); bookmarks and
+//  tracks are kept up to date by triggers, waypoints (only stored in GPX files) by indexTrack()
+static bool hasPersonalIndex = false;
+
+// must be called after bookmarks, tracks, and track_summary tables are created
+void MapsSearch::initPersonalIndex()
+{
+  SQLiteDB& db = MapsApp::placesDB;
+  if(!db.db) { return; }
+  int exists = 0;
+  db.stmt("SELECT 1 FROM sqlite_master WHERE name = 'personal_fts';").onerow(exists);
+  if(!exists) {
+    int64_t t0 = mSecSinceEpoch();
+    if(!db.exec(PERSONAL_SCHEMA)) {
+      LOGE("Error creating personal data search index: %s", db.errMsg());
+      db.exec("ROLLBACK;");
+      return;
+    }
+    LOG("Created personal data search index in %d ms", int(mSecSinceEpoch() - t0));
+  }
+  hasPersonalIndex = true;
+  // searchWorker is the only user of readDB (NOMUTEX), so attach on worker
+  if(readDB) {
+    std::string path = FSPath(MapsApp::baseDir, "places.sqlite").path;
+    searchWorker.enqueue([this, path](){
+      if(readDB->exec(fstring("ATTACH DATABASE '%s' AS places;", path.c_str())))
+        readPersonal = true;
+      else
+        LOGE("Error attaching places DB to search read connection: %s", readDB->errMsg());
+    });
+  }
+}
+
+// GPX waypoints aren't in places DB, so they are indexed when track is loaded or saved
+void MapsSearch::indexTrack(const GpxFile* track)
+{
+  if(!hasPersonalIndex || track->rowid < 0) { return; }
+  SQLiteDB& db = MapsApp::placesDB;
+  int64_t wptbase = PERSONAL_WAYPOINT_ID + (int64_t(track->rowid) << 16);
+  db.exec("BEGIN;");
+  db.stmt("DELETE FROM personal_fts WHERE rowid BETWEEN ? AND ?;").bind(wptbase, wptbase + 0xFFFF).exec();
+  for(size_t ii = 0; ii < track->waypoints.size() && ii <= 0xFFFF; ++ii) {
+    const Waypoint& wpt = track->waypoints[ii];
+    if(wpt.name.empty() && wpt.desc.empty()) { continue; }
+    db.stmt("INSERT INTO personal_fts(rowid, title, notes, lng, lat) VALUES (?,?,?,?,?);")
+        .bind(wptbase + int64_t(ii), wpt.name, wpt.desc, wpt.lngLat().longitude, wpt.lngLat().latitude).exec();
+  }
+  if(!db.exec("COMMIT;")) {
+    LOGW("Error indexing waypoints for track %s: %s", track->title.c_str(), db.errMsg());
+    db.exec("ROLLBACK;");
+  }
+}
+
 MapsSearch::MapsSearch(MapsApp* _app) : MapsComponent(_app) { initSearch(); }
 
-MapsSearch::~MapsSearch() {}
+MapsSearch::~MapsSearch()
+{
+  // make sure worker isn't using readDB when it is closed
+  searchWorker.waitForCompletion();
+  readDB.reset();
+}
 
 void MapsSearch::clearSearchResults()
 {
@@ -218,10 +663,14 @@ void MapsSearch::clearSearchResults()
   listResultOffset = 0;
   resultCountText->setText(" ");  // use non-empty string to maintain layout height
   mapResults.clear();
+  mapResultCounts.clear();
+  mapResultOffset = 0;
   listResults.clear();
   moreMapResultsAvail = false;
   moreListResultsAvail = false;
+  newListSearch = false;
   markers->reset();
+  clusterMarkers->reset();
   flyingToResults = false;  // just in case event got dropped
   saveToBkmksBtn->setEnabled(false);
   currSearchPhase = NO_SEARCH;
@@ -249,7 +698,10 @@ void MapsSearch::addMapResult(int64_t id, double lng, double lat, float rank, co
   // for online searches, we don't want to clear previous results until we get new results
   if(newMapSearch) {
     mapResults.clear();
+    mapResultCounts.clear();
+    mapResultOffset = 0;
     markers->reset();
+    clusterMarkers->reset();
     newMapSearch = false;
   }
   mapResults.push_back({id, {lng, lat}, rank, json});
@@ -257,9 +709,22 @@ void MapsSearch::addMapResult(int64_t id, double lng, double lat, float rank, co
 
 void MapsSearch::addListResult(int64_t id, double lng, double lat, float rank, const char* json)
 {
+  if(newListSearch) {
+    listResults.clear();
+    app->gui->deleteContents(resultsContent, ".listitem");
+    listResultOffset = 0;
+    newListSearch = false;
+  }
   listResults.push_back({id, {lng, lat}, rank, json});
 }
 
+// cached online results have been shown; results from refresh request should replace them
+void MapsSearch::replaceCachedResults(int flags)
+{
+  if(flags & MAP_SEARCH) { newMapSearch = true; }
+  if(flags & LIST_SEARCH) { newListSearch = true; }
+}
+
 void MapsSearch::searchPluginError(const char* err)
 {
   retryBtn->setIcon(MapsApp::uiIcon("retry"));
@@ -267,33 +732,349 @@ void MapsSearch::searchPluginError(const char* err)
   resultCountText->setText("Search failed");
 }
 
-void MapsSearch::offlineMapSearch(std::string queryStr, LngLat lnglat00, LngLat lngLat11)
+static bool schemaHasTagIndex(const std::string& schema)
+{
+  if(schema == "main") { return hasTagIndex; }
+  std::lock_guard<std::mutex> lock(shardMutex);
+  for(auto& shard : searchShards) {
+    if(shardSchema(shard.first) == schema) { return shard.second.tags; }
+  }
+  return false;
+}
+
+static std::atomic_bool tagBackfillQueued = {false};
+
+// build tag postings for POIs indexed before tag index existed or imported from POI DBs (offline worker)
+static void backfillTagIndex(std::vector<std::string> fields)
+{
+  static constexpr int BATCH_SIZE = 5000;  // limit time shardMutex is held
+  std::vector<int> ids;  // 0 for main DB
+  {
+    std::lock_guard<std::mutex> lock(shardMutex);
+    if(!hasTagIndex) { ids.push_back(0); }
+    for(auto& shard : searchShards) {
+      if(!shard.second.tags) { ids.push_back(shard.first); }
+    }
+  }
+  auto& db = MapsSearch::searchDB;
+  for(int id : ids) {
+    int64_t t0 = mSecSinceEpoch(), lastRowId = INT64_MIN;
+    std::string schema = id ? shardSchema(id) : "main";
+    std::string sql = fstring("SELECT rowid, props, tile_id FROM %s.pois WHERE rowid > ? ORDER BY rowid LIMIT %d;",
+        schema.c_str(), BATCH_SIZE);
+    int npois = 0, nbatch = BATCH_SIZE;
+    while(nbatch == BATCH_SIZE) {
+      std::lock_guard<std::mutex> lock(shardMutex);
+      auto it = searchShards.find(id);
+      if(id && it == searchShards.end()) { break; }  // shard deleted
+      const PoiInsertStmts& st = id ? it->second.stmts : mainInsertStmts;
+      nbatch = 0;
+      db.exec("BEGIN TRANSACTION");
+      db.stmt(sql).bind(lastRowId).exec([&](int64_t rowid, const char* props, int64_t tileId){
+        insertPoiTags(st, rowid, tileId, fields, jsonToProps(props ? props : ""));
+        lastRowId = rowid;
+        ++nbatch;
+      });
+      if(nbatch < BATCH_SIZE) {
+        db.exec(fstring("PRAGMA %s.user_version = 2;", schema.c_str()));
+        if(id) { it->second.tags = true; } else { hasTagIndex = true; }
+      }
+      db.exec("COMMIT TRANSACTION");
+      npois += nbatch;
+    }
+    LOG("Built tag index for %d POIs in %s in %d ms", npois, schema.c_str(), int(mSecSinceEpoch() - t0));
+  }
+  tagBackfillQueued = false;
+}
+
+void MapsSearch::buildTagIndex()
+{
+  if(tagBackfillQueued) { return; }
+  bool complete = hasTagIndex;
+  {
+    std::lock_guard<std::mutex> lock(shardMutex);
+    for(auto& shard : searchShards)
+      complete = complete && shard.second.tags;
+  }
+  if(complete) { return; }
+  const YAML::Node& searchYaml = app->sceneConfig()["application"]["search_data"];
+  if(!searchYaml) { return; }
+  tagBackfillQueued = true;
+  std::vector<std::string> fields;
+  for(const SearchData& sd : parseSearchFields(searchYaml)) {
+    for(const std::string& field : sd.fields) {
+      if(std::find(fields.begin(), fields.end(), field) == fields.end())
+        fields.push_back(field);
+    }
+  }
+  MapsOffline::queueOfflineTask(-1, [fields](){ backfillTagIndex(fields); });
+}
+
+// latency stats for offline searches (only accessed on searchWorker thread); percentiles are logged
+//  periodically so schema and query changes can be compared on real data
+enum SearchKind { MAP_QUERY = 0, LIST_QUERY, AUTOCOMPLETE_QUERY, FUZZY_QUERY, CATEGORY_MAP_QUERY,
+    CATEGORY_LIST_QUERY, MAP_FIRST_RESULT, LIST_FIRST_RESULT, NUM_SEARCH_KINDS };
+static const char* searchKindNames[] = {"map", "list", "autocomplete", "fuzzy", "category map", "category list",
+    "map (first result)", "list (first result)"};
+
+class SearchTiming
+{
+public:
+  void record(SearchKind kind, int64_t ms)
+  {
+    auto& samples = times[kind];
+    if(samples.size() < MAX_SAMPLES) { samples.push_back(int(ms)); }
+    else { samples[counts[kind] % MAX_SAMPLES] = int(ms); }
+    if(++counts[kind] % LOG_INTERVAL == 0) {
+      std::vector<int> s(samples);
+      std::sort(s.begin(), s.end());
+      auto pct = [&](size_t p){ return s[std::min(s.size() - 1, s.size()*p/100)]; };
+      LOG("Offline %s search latency (last %d): p50 %d ms, p95 %d ms, p99 %d ms, max %d ms",
+          searchKindNames[kind], int(s.size()), pct(50), pct(95), pct(99), s.back());
+    }
+  }
+
+private:
+  static constexpr size_t MAX_SAMPLES = 256;
+  static constexpr int LOG_INTERVAL = 50;
+  std::vector<int> times[NUM_SEARCH_KINDS];
+  int counts[NUM_SEARCH_KINDS] = {0};
+};
+static SearchTiming searchTiming;
+
+// typo-tolerant search: candidates containing any query trigram are fetched from trigram index (best
+//  bm25 matches first), then ranked by fraction of query trigrams matched and distance
+static void fuzzySearch(SQLiteDB& db, const std::vector<std::string>& schemas, const std::string& text,
+    LngLat origin, int limit, std::vector<SearchResult>& results, const std::function<bool()>& isStale)
+{
+  if(schemas.empty()) { return; }
+  std::vector<std::string> qtris = getTrigrams(trimStr(text));
+  if(qtris.size() < 2) { return; }  // need at least 4 chars for any tolerance
+  int64_t t0 = mSecSinceEpoch();
+  std::vector<std::pair<double, SearchResult>> cands;
+  bool abort = false;
+  db.stmt(fuzzySearchSql(schemas)).bind(trigramMatchStr(qtris), FUZZY_MAX_CANDIDATES)
+      .exec([&](int64_t rowid, const char* name, double lng, double lat, const char* json, double){
+        if(isStale()) { abort = true; return; }
+        for(const SearchResult& r : results) { if(r.id == rowid) return; }  // already in primary results
+        float sim = trigramSimilarity(qtris, name);
+        if(sim < FUZZY_MIN_SIMILARITY) { return; }
+        double score = -sim/log2(1 + lngLatDist(origin, LngLat(lng, lat)));
+        cands.push_back({score, SearchResult{rowid, {lng, lat}, -sim, json}});
+      }, false, &abort);
+
+  std::sort(cands.begin(), cands.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+  for(size_t ii = 0; ii < cands.size() && int(results.size()) < limit; ++ii)
+    results.push_back(std::move(cands[ii].second));
+  int64_t dt = mSecSinceEpoch() - t0;
+  searchTiming.record(FUZZY_QUERY, dt);
+  if(dt > FUZZY_BUDGET_MS)
+    LOGW("Fuzzy search for '%s' took %d ms (budget %d ms)", text.c_str(), int(dt), FUZZY_BUDGET_MS);
+}
+
+// at low zoom, map search returns one result per grid cell (best ranked POI and count) instead of individual
+//  POIs; grid is fixed relative to lng,lat (not viewport) so cells already fetched can be reused on pan
+// - only accessed on searchWorker thread
+struct MapCluster { int count; SearchResult rep; };
+static struct {
+  std::string query;
+  int gridZoom = -1;
+  double latRef = 0;
+  std::unordered_map<int64_t, MapCluster> cells;  // cells with results
+  std::unordered_set<int64_t> covered;  // all cells queried
+} clusterCache;
+
+static int64_t clusterCellKey(int cx, int cy) { return int64_t(cx) << 32 | uint32_t(cy); }
+
+static void clusterMapSearch(SQLiteDB& db, const std::vector<std::string>& schemas, const std::string& queryStr,
+    LngLat lnglat00, LngLat lngLat11, float zoom, std::vector<SearchResult>& res, std::vector<int>& counts,
+    const std::function<bool()>& isStale)
+{
+  auto& cc = clusterCache;
+  int gridZoom = int(zoom);
+  // lng,lat cells are approx. square on screen near latRef; quantize so small pans don't change grid
+  double latRef = 5*std::round((lnglat00.latitude + lngLat11.latitude)/10);
+  std::vector< std::pair<LngLat, LngLat> > changed;
+  {
+    std::lock_guard<std::mutex> lock(changedBoundsMutex);
+    changed.swap(changedBounds);
+  }
+  if(cc.query != queryStr || cc.gridZoom != gridZoom || cc.latRef != latRef) {
+    cc.query = queryStr;
+    cc.gridZoom = gridZoom;
+    cc.latRef = latRef;
+    cc.cells.clear();
+    cc.covered.clear();
+  }
+  double dlng = CLUSTER_CELL_PX/256 * 360.0/(1 << gridZoom);
+  double dlat = dlng*std::cos(latRef*M_PI/180);
+  // refetch only cells overlapping tiles indexed or removed since last search
+  for(auto& bounds : changed) {
+    if(cc.covered.empty()) { break; }
+    int bx0 = int((bounds.first.longitude + 180)/dlng), bx1 = int((bounds.second.longitude + 180)/dlng);
+    int by0 = int((bounds.first.latitude + 90)/dlat), by1 = int((bounds.second.latitude + 90)/dlat);
+    for(auto it = cc.covered.begin(); it != cc.covered.end();) {
+      int cx = int(*it >> 32), cy = int32_t(*it & 0xFFFFFFFF);
+      if(cx >= bx0 && cx <= bx1 && cy >= by0 && cy <= by1) {
+        cc.cells.erase(*it);
+        it = cc.covered.erase(it);
+      }
+      else
+        ++it;
+    }
+  }
+  int cx0 = int((lnglat00.longitude + 180)/dlng), cx1 = int((lngLat11.longitude + 180)/dlng);
+  int cy0 = int((lnglat00.latitude + 90)/dlat), cy1 = int((lngLat11.latitude + 90)/dlat);
+
+  // bounding box of cells not yet fetched
+  int mx0 = INT_MAX, mx1 = INT_MIN, my0 = INT_MAX, my1 = INT_MIN;
+  for(int cx = cx0; cx <= cx1; ++cx) {
+    for(int cy = cy0; cy <= cy1; ++cy) {
+      if(cc.covered.count(clusterCellKey(cx, cy))) { continue; }
+      mx0 = std::min(mx0, cx);  mx1 = std::max(mx1, cx);
+      my0 = std::min(my0, cy);  my1 = std::max(my1, cy);
+    }
+  }
+
+  if(mx0 <= mx1) {
+    bool abort = false;
+    std::vector<std::pair<int64_t, MapCluster>> fetched;
+    std::string query = clusterSearchSql(schemas, schemaHasTagIndex, queryStr, LngLat(mx0*dlng - 180, my0*dlat - 90),
+        LngLat((mx1+1)*dlng - 180, (my1+1)*dlat - 90), rangeTileZooms());
+    db.stmt(query).bind(dlng, dlat, queryStr, mx0*dlng - 180, my0*dlat - 90, (mx1+1)*dlng - 180, (my1+1)*dlat - 90)
+        .exec([&](int cx, int cy, int n, int64_t rowid, double lng, double lat, double score, const char* json){
+          fetched.push_back({clusterCellKey(cx, cy), MapCluster{n, {rowid, {lng, lat}, float(score), json}}});
+          if(isStale()) { abort = true; }
+        }, false, &abort);
+    if(isStale()) { return; }
+    for(auto& cell : fetched)
+      cc.cells.emplace(cell.first, std::move(cell.second));
+    for(int cx = mx0; cx <= mx1; ++cx) {
+      for(int cy = my0; cy <= my1; ++cy)
+        cc.covered.insert(clusterCellKey(cx, cy));
+    }
+  }
+
+  for(int cx = cx0; cx <= cx1; ++cx) {
+    for(int cy = cy0; cy <= cy1; ++cy) {
+      auto it = cc.cells.find(clusterCellKey(cx, cy));
+      if(it == cc.cells.end()) { continue; }
+      res.push_back(it->second.rep);
+      counts.push_back(it->second.count);
+    }
+  }
+}
+
+// offline results are posted to main thread in chunks as they are produced, so first page is shown as soon as
+//  it is ranked instead of after the whole query; chunks for stale generations are dropped on both threads
+static constexpr size_t FIRST_CHUNK_RESULTS = 50;
+static constexpr size_t CHUNK_RESULTS = 250;
+
+void MapsSearch::postMapResults(int64_t gen, std::vector<SearchResult>&& res, bool first, int flags)
+{
+  MapsApp::runOnMainThread([this, gen, first, flags, res=std::move(res)]() mutable {
+    if(gen < mapSearchGen) { return; }
+    if(first) {
+      mapResults.clear();
+      mapResultCounts.clear();
+      mapResultOffset = 0;
+      markers->reset();
+      clusterMarkers->reset();
+    }
+    mapResults.insert(mapResults.end(), std::make_move_iterator(res.begin()), std::make_move_iterator(res.end()));
+    resultsUpdated(MAP_SEARCH | flags);
+  });
+}
+
+void MapsSearch::postListResults(int64_t gen, std::vector<SearchResult>&& res, int flags)
+{
+  MapsApp::runOnMainThread([this, gen, flags, res=std::move(res)]() mutable {
+    if(gen < listSearchGen) { return; }
+    if(listResults.empty())
+      listResults = std::move(res);
+    else {
+      listResults.insert(listResults.end(),
+          std::make_move_iterator(res.begin()), std::make_move_iterator(res.end()));
+    }
+    resultsUpdated(LIST_SEARCH | flags);
+  });
+}
+
+void MapsSearch::offlineMapSearch(std::string queryStr, LngLat lnglat00, LngLat lngLat11, float zoom)
 {
   int64_t gen = ++mapSearchGen;
+  int64_t tReq = mSecSinceEpoch();
+  LngLat origin = searchRankOrigin;
+  float clusterZoom = app->cfg()["search"]["cluster_max_zoom"].as<float>(13);
   searchWorker.enqueue([=](){
     if(gen < mapSearchGen) { return; }
-    std::vector<SearchResult> res;
-    res.reserve(MAX_MAP_RESULTS);
+    int64_t t0 = mSecSinceEpoch();
+    SQLiteDB& db = readDB ? *readDB : searchDB;
+    readRankOrigin = origin;  // for category results
+    if(zoom < clusterZoom) {
+      std::vector<SearchResult> res;
+      std::vector<int> counts;
+      clusterMapSearch(db, searchSchemas(db), queryStr, lnglat00, lngLat11, zoom, res, counts,
+          [&](){ return gen < mapSearchGen; });
+      if(gen < mapSearchGen) { return; }
+      searchTiming.record(MAP_QUERY, mSecSinceEpoch() - t0);
+      searchTiming.record(MAP_FIRST_RESULT, mSecSinceEpoch() - tReq);
+      MapsApp::runOnMainThread([this, gen, res=std::move(res), counts=std::move(counts)]() mutable {
+        if(gen < mapSearchGen) { return; }
+        mapResults = std::move(res);
+        mapResultCounts = std::move(counts);
+        mapResultOffset = 0;
+        markers->reset();
+        clusterMarkers->reset();
+        resultsUpdated(MAP_SEARCH);
+      });
+      return;
+    }
+    std::vector<SearchResult> res;  // current chunk
+    res.reserve(FIRST_CHUNK_RESULTS);
+    size_t nposted = 0;
     bool abort = false;
-    const char* query = "SELECT pois.rowid, lng, lat, rank, props FROM pois_fts JOIN pois "
-        "ON pois.ROWID = pois_fts.ROWID WHERE pois_fts MATCH ? AND pois.lng >= ? AND pois.lat >= ? AND "
-        "pois.lng <= ? AND pois.lat <= ? ORDER BY rank LIMIT 1000;";
-    searchDB.stmt(query)
-        .bind(queryStr, lnglat00.longitude, lnglat00.latitude, lngLat11.longitude, lngLat11.latitude)
-        .exec([&](int rowid, double lng, double lat, double score, const char* json){
-          res.push_back({rowid, {lng, lat}, float(score), json});
-          if(gen < mapSearchGen) { abort = true; }
-        }, false, &abort);
+    bool usedTags = false;
+    auto postChunk = [&](){
+      if(!nposted)
+        searchTiming.record(MAP_FIRST_RESULT, mSecSinceEpoch() - tReq);
+      size_t n = res.size();
+      postMapResults(gen, std::move(res), nposted == 0, 0);
+      nposted += n;
+      res.clear();
+      res.reserve(CHUNK_RESULTS);
+    };
+    // each schema (main DB and shards) is queried separately so results from first one can be posted w/o waiting
+    //  for all of them to be ranked together; results are ordered by rank within each schema only
+    for(const std::string& schema : searchSchemas(db)) {
+      size_t remaining = MAX_MAP_RESULTS - nposted - res.size();
+      if(remaining == 0) { break; }
+      bool armTags = false;
+      std::string query = mapSearchSql({schema}, schemaHasTagIndex, queryStr, lnglat00, lngLat11,
+          rangeTileZooms(), &armTags);
+      usedTags = usedTags || armTags;
+      db.stmt(query)
+          .bind(queryStr, lnglat00.longitude, lnglat00.latitude, lngLat11.longitude, lngLat11.latitude, int(remaining))
+          .exec([&](int64_t rowid, double lng, double lat, double score, const char* json){
+            res.push_back({rowid, {lng, lat}, float(score), json});
+            if(gen < mapSearchGen) { abort = true; return; }
+            if(res.size() >= (nposted ? CHUNK_RESULTS : FIRST_CHUNK_RESULTS))
+              postChunk();
+          }, false, &abort);
+      if(gen < mapSearchGen) { break; }
+      if(!res.empty())
+        postChunk();
+    }
 
     if(gen < mapSearchGen) {
       LOGD("Map search aborted - generation %d < %d", gen, mapSearchGen.load());
       return;
     }
-    MapsApp::runOnMainThread([this, res=std::move(res)]() mutable {
-      mapResults = std::move(res);
-      markers->reset();
-      resultsUpdated(MAP_SEARCH | (mapResults.size() >= MAX_MAP_RESULTS ? MORE_RESULTS : 0));
-    });
+    searchTiming.record(usedTags ? CATEGORY_MAP_QUERY : MAP_QUERY, mSecSinceEpoch() - t0);
+    if(!nposted)
+      searchTiming.record(MAP_FIRST_RESULT, mSecSinceEpoch() - tReq);
+    bool more = nposted + res.size() >= MAX_MAP_RESULTS;
+    postMapResults(gen, std::move(res), nposted == 0, more ? MORE_RESULTS : 0);
   });
 }
 
@@ -303,39 +1084,197 @@ void MapsSearch::offlineListSearch(std::string queryStr, LngLat, LngLat, int fla
   int limit = std::max(20, int(app->win->winBounds().height()/42 + 1));
   int offset = listResults.size();
   int64_t gen = ++listSearchGen;
+  int64_t tReq = mSecSinceEpoch();
+  LngLat origin = searchRankOrigin;
+  std::string text = searchQueryText;
 
   searchWorker.enqueue([=](){
     if(gen < listSearchGen) { return; }
+    int64_t t0 = mSecSinceEpoch();
+    SQLiteDB& db = readDB ? *readDB : searchDB;
+    readRankOrigin = origin;
     std::vector<SearchResult> res;
     res.reserve(limit);
     bool abort = false;
     // should we add tokenize = porter to CREATE TABLE? seems we want it on query, not content!
     // if '*' not appended to string, we assume categorical search - no info for ranking besides dist
-    std::string query = fstring("SELECT pois.rowid, lng, lat, rank, props FROM pois_fts JOIN pois ON"
-        " pois.ROWID = pois_fts.ROWID WHERE pois_fts MATCH ? ORDER BY osmSearchRank(%s, lng, lat) LIMIT %d OFFSET ?;",
-        (queryStr.back() != '*' || sortByDist) ? "-1.0" : "rank", limit);
-    searchDB.stmt(query)
+    // categorical queries use tag index where available; personal data is merged into ranking, w/ ids negated
+    //  to distinguish from POIs
+    bool usedTags = false;
+    bool rankByDist = queryStr.back() != '*' || sortByDist;
+    bool personal = readPersonal && &db == readDB.get();
+    std::string query = listSearchSql(searchSchemas(db), schemaHasTagIndex, queryStr, rankByDist, personal, limit,
+        &usedTags);
+    db.stmt(query)
         .bind(queryStr, offset)
-        .exec([&](int rowid, double lng, double lat, double score, const char* json){
+        .exec([&](int64_t rowid, double lng, double lat, double score, const char* json, double){
           res.push_back({rowid, {lng, lat}, float(score), json});
           if(gen < listSearchGen) { abort = true; }
         }, false, &abort);
-
     if(gen < listSearchGen) {
       LOGD("List search aborted - generation %d < %d", gen, listSearchGen.load());
       return;
     }
-    MapsApp::runOnMainThread([this, flags, limit, res=std::move(res)]() mutable {
-      int f = int(res.size()) >= limit ? (flags | MORE_RESULTS) : flags;  // g++11 bug with mutable nested lambda
-      if(listResults.empty())
-        listResults = std::move(res);
-      else {
-        listResults.insert(listResults.end(),
-            std::make_move_iterator(res.begin()), std::make_move_iterator(res.end()));
+
+    // post primary results before (slower) fuzzy search; empty results are not posted to avoid flashing
+    //  "0 results"; FLY_TO is only used for first chunk
+    size_t nposted = 0;
+    bool fuzzy = offset == 0 && int(res.size()) < FUZZY_MIN_RESULTS && !text.empty();
+    if(!fuzzy || !res.empty()) {
+      searchTiming.record(LIST_FIRST_RESULT, mSecSinceEpoch() - tReq);
+      int f = int(res.size()) >= limit ? (flags | MORE_RESULTS) : flags;
+      postListResults(gen, std::vector<SearchResult>(res), f);
+      nposted = res.size();
+    }
+    if(fuzzy) {
+      fuzzySearch(db, searchSchemas(db, true), text, origin, limit, res, [&](){ return gen < listSearchGen; });
+      if(gen < listSearchGen) {
+        LOGD("List search aborted - generation %d < %d", gen, listSearchGen.load());
+        return;
       }
-      resultsUpdated(LIST_SEARCH | f);
-    });
+      if(!nposted)
+        searchTiming.record(LIST_FIRST_RESULT, mSecSinceEpoch() - tReq);
+      int f = nposted ? (flags & ~FLY_TO) : flags;
+      if(int(res.size()) >= limit) { f |= MORE_RESULTS; }
+      postListResults(gen, std::vector<SearchResult>(res.begin() + nposted, res.end()), f);
+    }
+    searchTiming.record(usedTags ? CATEGORY_LIST_QUERY : LIST_QUERY, mSecSinceEpoch() - t0);
+  });
+}
+
+// incremental autocomplete: if query extends a previous query with a complete (not truncated) candidate
+//  set, we just filter those candidates instead of querying DB; recent candidate sets are kept in LRU cache
+// - everything here only accessed on searchWorker thread
+// - cache is only invalidated when offline regions change; POIs indexed from cached tiles while typing can be
+//  missed until query changes, which is fine for autocomplete
+struct AutocompleteResults {
+  std::string query;  // normalized query (lower case, single spaces)
+  std::vector<SearchResult> results;
+  std::vector<std::string> names;  // normalized names, for filtering
+  bool complete;  // all matches for query are in results (in no particular order)
+  int version;
+};
+static std::list<AutocompleteResults> acCache;
+static constexpr size_t AC_CACHE_SIZE = 8;
+static constexpr int AC_DEBOUNCE_MS = 40;
+
+void MapsSearch::offlineAutocomplete(std::string query, std::string queryStr)
+{
+  int limit = std::max(20, int(app->win->winBounds().height()/42 + 1));
+  int64_t gen = ++listSearchGen;
+  LngLat origin = searchRankOrigin;
+  bool bydist = sortByDist;
+
+  // debounce: search is only queued once no more keystrokes arrive for AC_DEBOUNCE_MS
+  acTimer = app->gui->setTimer(AC_DEBOUNCE_MS, app->win.get(), acTimer, [=](){
+    acTimer = NULL;
+    if(gen < listSearchGen) { return 0; }
+    searchWorker.enqueue([=](){ autocompleteQuery(gen, query, queryStr, origin, bydist, limit); });
+    return 0;
+  });
+}
+
+void MapsSearch::autocompleteQuery(int64_t gen, std::string query, std::string queryStr,
+    LngLat origin, bool bydist, int limit)
+{
+  if(gen < listSearchGen) { return; }
+  int64_t t1 = mSecSinceEpoch();
+  LOGTInit(">>> autocomplete %s", query.c_str());
+
+  std::vector<std::string> words;
+  bool ascii = acTokenize(query, words);
+  std::string normq = joinStr(words, " ");
+  int version = offlineRegionVersion;
+  acCache.remove_if([&](const AutocompleteResults& r){ return r.version != version; });
+
+  // exact match in cache?
+  auto hit = std::find_if(acCache.begin(), acCache.end(), [&](const AutocompleteResults& r){
+    return ascii && r.query == normq;
   });
+  if(hit == acCache.end() && ascii) {
+    // longest complete previous query that is a prefix of this one
+    auto prev = acCache.end();
+    for(auto it = acCache.begin(); it != acCache.end(); ++it) {
+      if(it->complete && normq.compare(0, it->query.size(), it->query) == 0
+          && (prev == acCache.end() || it->query.size() > prev->query.size()))
+        prev = it;
+    }
+    if(prev != acCache.end()) {
+      AutocompleteResults refined{normq, {}, {}, true, version};
+      std::vector<std::string> tokens;
+      for(size_t ii = 0; ii < prev->results.size(); ++ii) {
+        acTokenize(prev->names[ii], tokens);
+        if(acMatches(words, tokens)) {
+          refined.results.push_back(prev->results[ii]);
+          refined.names.push_back(prev->names[ii]);
+        }
+      }
+      acCache.push_front(std::move(refined));
+      hit = acCache.begin();
+    }
+  }
+  else if(hit != acCache.end())
+    acCache.splice(acCache.begin(), acCache, hit);  // move to front of LRU
+
+  SQLiteDB& db = readDB ? *readDB : searchDB;
+  if(hit == acCache.end()) {
+    AutocompleteResults cands{normq, {}, {}, true, version};
+    bool abort = false;
+    bool namesascii = true;
+    std::vector<std::string> tokens;
+    std::vector<std::string> schemas = searchSchemas(db);
+    db.stmt(autocompleteSql(schemas)).bind(queryStr, AC_MAX_CANDIDATES + 1)
+        .exec([&](int64_t rowid, const char* name, double lng, double lat, double score, const char* json){
+          cands.results.push_back({rowid, {lng, lat}, float(score), json});
+          cands.names.push_back(name ? name : "");
+          namesascii = namesascii && acTokenize(cands.names.back(), tokens);
+          if(gen < listSearchGen) { abort = true; }
+        }, false, &abort);
+    if(gen < listSearchGen) { return; }
+    // if candidates were truncated, we have to let DB rank all matches; can only reuse for exact query
+    if(int(cands.results.size()) > AC_MAX_CANDIDATES) {
+      cands.complete = false;
+      cands.results.clear();
+      cands.names.clear();
+      readRankOrigin = origin;
+      db.stmt(autocompleteRankedSql(schemas, bydist, limit)).bind(queryStr).exec([&](int64_t rowid, const char* name, double lng, double lat, double score,
+          const char* json, double){
+        cands.results.push_back({rowid, {lng, lat}, float(score), json});
+        cands.names.push_back(name ? name : "");
+        if(gen < listSearchGen) { abort = true; }
+      }, false, &abort);
+      if(gen < listSearchGen) { return; }
+    }
+    // candidates can't be refined in memory if we can't match names like FTS tokenizer
+    cands.complete = cands.complete && namesascii && ascii;
+    acCache.push_front(std::move(cands));
+    hit = acCache.begin();
+  }
+  if(acCache.size() > AC_CACHE_SIZE)
+    acCache.pop_back();
+
+  // rank candidates - same as ORDER BY osmSearchRank(rank, lng, lat)
+  std::vector<SearchResult> res;
+  if(hit->complete) {
+    std::vector<std::pair<double, size_t>> order;
+    order.reserve(hit->results.size());
+    for(size_t ii = 0; ii < hit->results.size(); ++ii) {
+      const SearchResult& r = hit->results[ii];
+      order.emplace_back((bydist ? -1.0 : r.rank)/log2(1 + lngLatDist(origin, r.pos)), ii);
+    }
+    size_t n = std::min(order.size(), size_t(limit));
+    std::partial_sort(order.begin(), order.begin() + n, order.end());
+    for(size_t ii = 0; ii < n; ++ii)
+      res.push_back(hit->results[order[ii].second]);
+  }
+  else
+    res = hit->results;
+  bool more = !hit->complete || hit->results.size() > res.size();
+  searchTiming.record(AUTOCOMPLETE_QUERY, mSecSinceEpoch() - t1);
+  if(int(res.size()) < FUZZY_MIN_RESULTS)
+    fuzzySearch(db, searchSchemas(db, true), query, origin, limit, res, [&](){ return gen < listSearchGen; });
+  LOGT("<<< autocomplete %s", query.c_str());
+  postListResults(gen, std::move(res), more ? MORE_RESULTS : 0);
 }
 
 void MapsSearch::onMapEvent(MapEvent_t event)
@@ -343,7 +1282,7 @@ void MapsSearch::onMapEvent(MapEvent_t event)
   if(!app->searchActive) { return; }
   if(event == MARKER_PICKED) {
     if(app->pickedMarkerId > 0) {
-      if(markers->onPicked(app->pickedMarkerId))
+      if(markers->onPicked(app->pickedMarkerId) || clusterMarkers->onPicked(app->pickedMarkerId))
         app->pickedMarkerId = 0;
     }
     return;
@@ -372,7 +1311,10 @@ void MapsSearch::onMapEvent(MapEvent_t event)
       || lngLat11.longitude > dotBounds11.longitude || lngLat11.latitude > dotBounds11.latitude;
   // don't search until animation stops
   if(app->mapState.isAnimating()) {}
-  else if(!providerFlags.slow && (mapmoved || (moreMapResultsAvail && zoomedin))) {
+  else if(!providerFlags.slow && (mapmoved || (moreMapResultsAvail && zoomedin)
+      || (!mapResultCounts.empty() && (zoomedin || zoomedout)))) {  // cluster grid depends on zoom
+    if(providerIdx == 0)
+      indexViewportTiles();
     updateMapResults(lngLat00, lngLat11, MAP_SEARCH);
     prevZoom = zoom;
   }
@@ -401,7 +1343,7 @@ void MapsSearch::updateMapResults(LngLat lngLat00, LngLat lngLat11, int flags)
     app->pluginManager->jsSearch(providerIdx - 1, searchStr, dotBounds00, dotBounds11, flags);
   }
   else
-    offlineMapSearch(searchStr, dotBounds00, dotBounds11);
+    offlineMapSearch(searchStr, dotBounds00, dotBounds11, app->map->getZoom());
 }
 
 void MapsSearch::resultsUpdated(int flags)
@@ -409,23 +1351,42 @@ void MapsSearch::resultsUpdated(int flags)
   if(flags & MAP_SEARCH) {
     newMapSearch = false;  // be sure this is clear in case there were no results
     moreMapResultsAvail = flags & MORE_RESULTS;
-    for(size_t idx = 0; idx < mapResults.size(); ++idx) {
+    for(size_t idx = mapResultOffset; idx < mapResults.size(); ++idx) {
       auto& mapres = mapResults[idx];
+      int count = idx < mapResultCounts.size() ? mapResultCounts[idx] : 1;
+      if(count > 1) {
+        // cluster - zoom in when tapped
+        auto onPicked = [this, pos=mapres.pos](){
+          auto campos = app->map->getCameraPosition();
+          campos.setLngLat(pos);
+          campos.zoom = std::min(campos.zoom + 2, app->cfg()["search"]["cluster_max_zoom"].as<float>(13));
+          app->gotoCameraPos(campos);
+        };
+        Properties props;
+        props.set("cluster_count", count);
+        props.set("cluster_label", count < 1000 ? std::to_string(count) : fstring("%dk", count/1000));
+        clusterMarkers->createMarker(mapres.pos, onPicked, std::move(props));
+        continue;
+      }
       auto onPicked = [this, idx](){
         SearchResult& res = mapResults[idx];
         app->setPickResult(res.pos, "", res.tags);
       };
       markers->createMarker(mapres.pos, onPicked, jsonToProps(mapres.tags));
     }
+    mapResultOffset = mapResults.size();
     if(!mapResults.empty())
       saveToBkmksBtn->setEnabled(true);
   }
 
   if(flags & LIST_SEARCH) {
+    newListSearch = false;
     moreListResultsAvail = flags & MORE_RESULTS;
     populateResults(flags);
-    int nresults = std::max(mapResults.size(), listResults.size());
-    bool more = mapResults.size() > listResults.size() ? moreMapResultsAvail : moreListResultsAvail;
+    size_t nmap = mapResultCounts.empty() ? mapResults.size()
+        : std::accumulate(mapResultCounts.begin(), mapResultCounts.end(), size_t(0));
+    int nresults = std::max(nmap, listResults.size());
+    bool more = nmap > listResults.size() ? moreMapResultsAvail : moreListResultsAvail;
     resultCountText->setText(nresults == 1 ? "1 result" :
         fstring("%s%d results", more ? "over " : "" , nresults).c_str());
   }
@@ -497,6 +1458,7 @@ void MapsSearch::searchText(std::string query, SearchPhase phase)
   clearSearchResults();
   currSearchPhase = phase;
   query = trimStr(query);
+  searchQueryText = query;
   // transformQuery plugin fn can, e.g., add synonyms to query (e.g., add "fast food" to "restaurant" query)
   if(providerIdx == 0 && !query.empty()) {
     // jsCallFn will return empty string in case of error
@@ -524,10 +1486,15 @@ void MapsSearch::searchText(std::string query, SearchPhase phase)
   isCurrLocDistOrigin = map->lngLatToScreenPosition(loc.longitude, loc.latitude);
   searchRankOrigin = isCurrLocDistOrigin ? loc : app->getMapCenter();
 
+  if(providerIdx == 0 && !query.empty()) {
+    indexViewportTiles();
+    buildTagIndex();
+  }
+
   if(phase == EDITING) {
     populateAutocomplete(query);
     if(query.size() > 1 && providerIdx == 0) {  // 2 chars for latin, 1-2 for non-latin (e.g. Chinese)
-      offlineListSearch("name : " + searchStr, lngLat00, lngLat11);  // restrict live search to name
+      offlineAutocomplete(query, "name : " + searchStr);  // restrict live search to name
     }
     else if(query.size() > 2 && providerIdx > 0 && providerFlags.autocomplete) {
       int flags = LIST_SEARCH | AUTOCOMPLETE | (sortByDist ? SORT_BY_DIST : 0);
@@ -616,11 +1583,23 @@ void MapsSearch::populateResults(int flags)
   if(!distProto)
     distProto.reset(loadSVGFragment(distProtoSVG));
 
+  // parse props and classify all new results at once
+  std::vector<Properties> resprops(listResults.size() - std::min(listResultOffset, listResults.size()));
+  std::vector<const char*> propstrs(resprops.size(), NULL);
+  for(size_t ii = 0; ii < resprops.size(); ++ii) {
+    const SearchResult& res = listResults[listResultOffset + ii];
+    if((flags & PLACE_HISTORY) && res.pos.latitude == 0 && res.pos.longitude == 0) { continue; }
+    resprops[ii] = jsonToProps(res.tags.c_str());
+    propstrs[ii] = res.tags.c_str();
+  }
+  std::vector<std::string> placetypes = app->pluginManager->getPlaceTypes(resprops, propstrs);
+
   for(size_t ii = listResultOffset; ii < listResults.size(); ++ii) {  //for(const auto& res : results)
     const SearchResult& res = listResults[ii];
-    bool queryhist = (flags & PLACE_HISTORY) && res.pos.latitude == 0 && res.pos.longitude == 0;
-    std::string namestr = queryhist ? res.tags : app->getPlaceTitle(jsonToProps(res.tags.c_str()));
-    std::string placetype = !res.tags.empty() && !queryhist ? app->pluginManager->jsCallFn("getPlaceType", res.tags) : "";
+    size_t jj = ii - listResultOffset;
+    bool queryhist = !propstrs[jj];
+    std::string namestr = queryhist ? res.tags : app->getPlaceTitle(resprops[jj]);
+    std::string placetype = std::move(placetypes[jj]);
     if(namestr.empty()) { namestr.swap(placetype); }  // we can show type instead of name if present
     if(namestr.empty()) { continue; }  // skip if nothing to show in list
     Button* item = createListItem(MapsApp::uiIcon(queryhist ? "clock" : "search"), namestr.c_str(), placetype.c_str());
@@ -936,6 +1915,7 @@ Button* MapsSearch::createPanel()
 
   markers.reset(new MarkerGroup(app->map.get(),
       "layers.search-marker.draw.marker", "layers.search-dot.draw.marker"));
+  clusterMarkers.reset(new MarkerGroup(app->map.get(), "layers.search-cluster.draw.marker"));
 
   // main toolbar button
   Menu* searchMenu = createMenu(Menu::VERT);
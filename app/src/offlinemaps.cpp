@@ -612,13 +612,20 @@ static void indexImportedTiles(SQLiteDB& tileDB, int offlineId, const YAML::Node
 
 static void exportPOIs(const char* dest, int offlineId)
 {
+  // each tile is only indexed once, so POIs for region's tiles can be in main search DB (tiles already indexed
+  //  when downloaded), the region's shard, or the shard of another region sharing the tile
   static const char* poiExportSQL = R"#(ATTACH DATABASE 'file://%s?mode=ro' AS searchdb;
     BEGIN;
     DROP TABLE IF EXISTS main.pois;
-    CREATE TABLE main.pois AS SELECT * FROM searchdb.pois WHERE tile_id IN
-        (SELECT tile_id FROM searchdb.offline_tiles WHERE offline_id = %d);
+    CREATE TEMP TABLE region_tiles AS SELECT DISTINCT tile_id FROM searchdb.offline_tiles WHERE offline_id = %d;
+    CREATE TABLE main.pois AS SELECT name, tags, props, lng, lat, tile_id FROM searchdb.pois
+        WHERE tile_id IN temp.region_tiles;
     COMMIT;
-    DETACH DATABASE searchdb;
+  )#";
+  static const char* shardExportSQL = R"#(ATTACH DATABASE 'file://%s?mode=ro' AS shard;
+    INSERT INTO main.pois SELECT name, tags, props, lng, lat, tile_id FROM shard.pois
+        WHERE tile_id IN temp.region_tiles;
+    DETACH DATABASE shard;
   )#";
   FSPath searchDB(MapsApp::baseDir, "fts1.sqlite");
   SQLiteDB poiOutDB;
@@ -626,7 +633,20 @@ static void exportPOIs(const char* dest, int offlineId)
     LOGE("Error opening %s for POI export", dest);
     return;
   }
-  if(poiOutDB.exec(fstring(poiExportSQL, searchDB.c_str(), offlineId))) {
+  bool ok = poiOutDB.exec(fstring(poiExportSQL, searchDB.c_str(), offlineId));
+  if(ok) {
+    // shards are attached one at a time since number of attached DBs is limited
+    std::vector<int> shardIds;
+    poiOutDB.stmt("SELECT DISTINCT b.offline_id FROM searchdb.offline_tiles AS a JOIN searchdb.offline_tiles AS b"
+        " ON b.tile_id = a.tile_id WHERE a.offline_id = ? AND b.offline_id > 0;")
+        .bind(offlineId).exec([&](int id){ shardIds.push_back(id); });
+    for(int id : shardIds) {
+      std::string shardFile = MapsSearch::shardFile(id);
+      if(shardFile.empty()) { continue; }
+      if(!(ok = poiOutDB.exec(fstring(shardExportSQL, shardFile.c_str())))) { break; }
+    }
+  }
+  if(ok) {
     int nPois = 0;
     poiOutDB.stmt("SELECT count(1) FROM main.pois;").onerow(nPois);
     if(!nPois) {
@@ -638,6 +658,8 @@ static void exportPOIs(const char* dest, int offlineId)
   }
   else
     LOGE("SQL error exporting POIs to %s: %s", dest, poiOutDB.errMsg());
+  poiOutDB.exec("DROP TABLE IF EXISTS temp.region_tiles;");
+  poiOutDB.exec("DETACH DATABASE searchdb;");
 }
 
 bool MapsOffline::importFile(std::string destsrc, std::unique_ptr<PlatformFile> srcfile, OfflineMapInfo olinfo, bool hasPois)
@@ -709,6 +731,51 @@ bool MapsOffline::importFile(std::string destsrc, std::unique_ptr<PlatformFile>
   return true;
 }
 
+// index POIs from tiles already in disk cache (i.e. previously displayed) so offline search has some results
+//  without an offline map; tiles are processed in batches limited by CPU time so that other offline tasks
+//  aren't blocked for long, and total number of ephemeral tiles is capped
+void MapsOffline::indexCachedTiles(std::string cacheFile, std::deque<TileID> tiles,
+    std::shared_ptr<YAML::Node> searchYaml, int maxTiles)
+{
+  static constexpr int64_t BATCH_BUDGET_MS = 30;
+  // mapid = 0 so downloadCompleted() ignores task
+  queueOfflineTask(0, [=]() mutable {
+    SQLiteDB tileDB;
+    if(tileDB.open(cacheFile, SQLITE_OPEN_READONLY) != SQLITE_OK) {
+      LOGW("Error opening cache DB %s for search indexing", cacheFile.c_str());
+      return;
+    }
+    auto searchData = MapsSearch::parseSearchFields(*searchYaml);
+    Timestamp t0 = mSecSinceEpoch();
+    int nindexed = 0;
+    while(!tiles.empty() && mSecSinceEpoch() - t0 < BATCH_BUDGET_MS) {
+      TileID tileId = tiles.front();
+      tiles.pop_front();
+      if(MapsSearch::hasTileData(tileId)) { continue; }
+      const char* sql = "SELECT tile_data FROM tiles WHERE zoom_level = ? AND tile_column = ? AND tile_row = ?;";
+      tileDB.stmt(sql).bind(tileId.z, tileId.x, (1 << tileId.z) - 1 - tileId.y).exec([&](sqlite3_stmt* stmt){
+        const char* blob = (const char*) sqlite3_column_blob(stmt, 0);
+        const int length = sqlite3_column_bytes(stmt, 0);
+        BinaryTileTask task(tileId, nullptr);
+        task.rawTileData = std::make_shared<std::vector<char>>();
+        auto& _data = *task.rawTileData;
+        if(Tangram::zlib_inflate(blob, length, _data) != 0) {
+          _data.resize(length);
+          memcpy(_data.data(), blob, length);
+        }
+        MapsSearch::indexTileData(&task, MapsSearch::EPHEMERAL_MAP_ID, searchData);
+        ++nindexed;
+      });
+    }
+    if(nindexed)
+      LOGD("Indexed %d cached tiles for search in %d ms", nindexed, int(mSecSinceEpoch() - t0));
+    if(!tiles.empty())
+      indexCachedTiles(cacheFile, std::move(tiles), searchYaml, maxTiles);  // requeue remaining
+    else
+      MapsSearch::trimEphemeralTiles(maxTiles);
+  });
+}
+
 // GUI
 
 void MapsOffline::updateProgress(int mapid, const std::string& msg)
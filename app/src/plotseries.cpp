@@ -0,0 +1,75 @@
+#include "plotseries.h"
+#include <algorithm>
+#include <cmath>
+
+PlotSeries::Bin PlotSeries::aggregate(size_t k, size_t j) const
+{
+  Bin b;
+  size_t n = k > 1 ? levels[k-2].size() : ys.size();
+  for(size_t ii = j << SHIFT; ii < std::min((j+1) << SHIFT, n); ++ii) {
+    b.ymin = std::min(b.ymin, k > 1 ? levels[k-2][ii].ymin : ys[ii]);
+    b.ymax = std::max(b.ymax, k > 1 ? levels[k-2][ii].ymax : ys[ii]);
+  }
+  return b;
+}
+
+// only bins containing points added or removed since last update are recalculated
+void PlotSeries::update()
+{
+  size_t n = ys.size();
+  if(nValid == n) { return; }
+  size_t k = 1;
+  for(; (size_t(1) << SHIFT*(k-1)) < n; ++k) {
+    if(levels.size() < k)
+      levels.emplace_back();
+    std::vector<Bin>& level = levels[k-1];
+    size_t nbins = ((n - 1) >> SHIFT*k) + 1;
+    size_t j0 = std::min(std::min(level.size(), nbins), nValid >> SHIFT*k);
+    level.resize(nbins);
+    for(size_t j = j0; j < nbins; ++j)
+      level[j] = aggregate(k, j);
+  }
+  levels.resize(k-1);  // top level has a single bin
+  nValid = n;
+}
+
+void PlotSeries::yRange(double& ymin, double& ymax) const
+{
+  if(!levels.empty()) {
+    ymin = levels.back()[0].ymin;
+    ymax = levels.back()[0].ymax;
+  }
+  else if(!ys.empty()) {
+    ymin = ys[0];
+    ymax = ys[0];
+  }
+}
+
+void PlotSeries::getPath(Path2D& path, real x0, real x1, real npx) const
+{
+  size_t n = xs.size();
+  if(n == 0) { return; }
+  // include a point on either side of range so path extends to edges
+  size_t i0 = std::lower_bound(xs.begin(), xs.end(), x0) - xs.begin();
+  size_t i1 = std::upper_bound(xs.begin(), xs.end(), x1) - xs.begin();
+  i0 = i0 > 0 ? i0 - 1 : 0;
+  i1 = std::min(i1 + 1, n);
+  size_t k = 0;
+  while(k < levels.size() && real((i1 - i0) >> SHIFT*k) > npx) ++k;
+  if(k == 0) {
+    for(size_t ii = i0; ii < i1; ++ii)
+      path.addPoint(xs[ii], ys[ii]);
+    return;
+  }
+  // each bin is drawn as a vertical span from first to last x; order min and max to continue from prev bin
+  const std::vector<Bin>& level = levels[k-1];
+  size_t j1 = ((i1 - 1) >> SHIFT*k) + 1;
+  float prevy = 0;
+  for(size_t j = i0 >> SHIFT*k; j < j1; ++j) {
+    const Bin& b = level[j];
+    bool minfirst = std::abs(prevy - b.ymin) < std::abs(prevy - b.ymax);
+    path.addPoint(xs[j << SHIFT*k], minfirst ? b.ymin : b.ymax);
+    path.addPoint(xs[std::min((j+1) << SHIFT*k, n) - 1], minfirst ? b.ymax : b.ymin);
+    prevy = minfirst ? b.ymax : b.ymin;
+  }
+}
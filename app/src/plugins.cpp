@@ -16,6 +16,235 @@
 
 PluginManager* PluginManager::inst = NULL;
 
+// cache of online search and place info results, so repeated searches show results immediately; results
+//  are keyed by provider fn, normalized query and cell (tile at zoom matching search bounds)
+static SQLiteDB resultCacheDB;
+static int64_t resultCacheMaxAge = 0;  // seconds; 0 disables cache
+static int64_t resultRefreshAge = 0;  // cached results older than this are shown but also requested again
+
+struct CachedRequest
+{
+  std::string provider;
+  std::string query;
+  int kind = 0;
+  int64_t cell = 0;
+  int64_t cacheId = -1;  // place info only, since there is no completion signal
+  std::string osmId;  // place info only: results are only saved if this is still the current pick result
+  bool active = false;  // results will be saved to cache
+  bool replayed = false;  // place info only: cached results shown, to be replaced by new results
+  std::vector<SearchResult> results;
+};
+static CachedRequest mapCacheReq, listCacheReq, placeCacheReq;
+static constexpr int PLACE_INFO_KIND = 0;
+
+static const char* RESULT_CACHE_SCHEMA = R"SQL(BEGIN;
+CREATE TABLE IF NOT EXISTS cache_keys(id INTEGER PRIMARY KEY, provider TEXT, query TEXT, kind INTEGER, cell INTEGER,
+  flags INTEGER, timestamp INTEGER DEFAULT (CAST(strftime('%s') AS INTEGER)), UNIQUE(provider, query, kind, cell));
+CREATE TABLE IF NOT EXISTS search_results(cache_id INTEGER, osm_id INTEGER, lng REAL, lat REAL, score REAL, tags TEXT);
+CREATE INDEX IF NOT EXISTS search_results_cache_id ON search_results (cache_id);
+CREATE TABLE IF NOT EXISTS place_info(cache_id INTEGER, icon TEXT, title TEXT, value TEXT);
+CREATE INDEX IF NOT EXISTS place_info_cache_id ON place_info (cache_id);
+COMMIT;)SQL";
+
+static void openResultCache(MapsApp* app)
+{
+  resultCacheMaxAge = app->cfg()["search"]["online_cache_age"].as<int64_t>(2592000);  // 30 days
+  resultRefreshAge = app->cfg()["search"]["online_refresh_age"].as<int64_t>(86400);  // 1 day
+  if(resultCacheMaxAge <= 0) { return; }
+  FSPath dbPath(app->baseDir, "online_cache.sqlite");
+  if(resultCacheDB.open(dbPath.path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE) != SQLITE_OK) {
+    LOGE("Error opening %s - online results will not be cached", dbPath.c_str());
+    sqlite3_close(resultCacheDB.release());
+    return;
+  }
+  if(!resultCacheDB.exec(RESULT_CACHE_SCHEMA)) {
+    LOGE("Error creating online result cache: %s", resultCacheDB.errMsg());
+    sqlite3_close(resultCacheDB.release());
+    return;
+  }
+  // remove expired entries
+  static const char* expiredSQL = "SELECT id FROM cache_keys WHERE timestamp < CAST(strftime('%s') AS INTEGER) - ?";
+  resultCacheDB.stmt(fstring("DELETE FROM search_results WHERE cache_id IN (%s);", expiredSQL)).bind(resultCacheMaxAge).exec();
+  resultCacheDB.stmt(fstring("DELETE FROM place_info WHERE cache_id IN (%s);", expiredSQL)).bind(resultCacheMaxAge).exec();
+  resultCacheDB.stmt(fstring("DELETE FROM cache_keys WHERE id IN (%s);", expiredSQL)).bind(resultCacheMaxAge).exec();
+}
+
+// lower case, single spaced
+static std::string normalizeQuery(const std::string& query)
+{
+  std::string s = joinStr(splitStr<std::vector>(query, " ", true), " ");
+  std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c){ return c < 0x80 ? tolower(c) : c; });
+  return s;
+}
+
+// tile containing center of bounds at zoom where tile is about the size of bounds
+static int64_t boundsCell(LngLat lngLat00, LngLat lngLat11)
+{
+  double dlng = std::max(std::abs(lngLat11.longitude - lngLat00.longitude), 1E-6);
+  int z = std::min(20, std::max(0, int(std::log2(360/dlng))));
+  LngLat center((lngLat00.longitude + lngLat11.longitude)/2, (lngLat00.latitude + lngLat11.latitude)/2);
+  return packTileId(lngLatTile(center, z));
+}
+
+// id, flags and age of cache entry, if present
+static int64_t findCacheEntry(const CachedRequest& req, int& flags, int64_t& age)
+{
+  int64_t cacheId = -1;
+  resultCacheDB.stmt("SELECT id, flags, CAST(strftime('%s') AS INTEGER) - timestamp FROM cache_keys"
+      " WHERE provider = ? AND query = ? AND kind = ? AND cell = ?;").bind(req.provider, req.query, req.kind, req.cell)
+      .exec([&](int64_t id, int f, int64_t a){ cacheId = id; flags = f; age = a; });
+  return cacheId;
+}
+
+// replace cache entry for req, returning new id
+static int64_t replaceCacheEntry(const CachedRequest& req, int flags)
+{
+  static const char* delResultsSQL = "DELETE FROM %s WHERE cache_id IN (SELECT id FROM cache_keys"
+      " WHERE provider = ? AND query = ? AND kind = ? AND cell = ?);";
+  const char* table = req.kind == PLACE_INFO_KIND ? "place_info" : "search_results";
+  resultCacheDB.stmt(fstring(delResultsSQL, table)).bind(req.provider, req.query, req.kind, req.cell).exec();
+  resultCacheDB.stmt("REPLACE INTO cache_keys (provider,query,kind,cell,flags) VALUES (?,?,?,?,?);")
+      .bind(req.provider, req.query, req.kind, req.cell, flags).exec();
+  return sqlite3_last_insert_rowid(resultCacheDB.db);
+}
+
+// show cached results for requested kinds (map and/or list); returns true if all are fresh, in which case
+//  no request is needed; otherwise new results will be saved to cache and replace cached results
+static bool replayCachedSearch(const std::string& provider, const std::string& queryStr,
+    LngLat lngLat00, LngLat lngLat11, int flags)
+{
+  const int kinds = flags & (MapsSearch::MAP_SEARCH | MapsSearch::LIST_SEARCH);
+  if(!resultCacheDB.db || !kinds) { return false; }
+  // next page results depend on previous requests, so are not cached
+  if(flags & MapsSearch::NEXTPAGE) {
+    if(kinds & MapsSearch::MAP_SEARCH) { mapCacheReq.active = false; }
+    if(kinds & MapsSearch::LIST_SEARCH) { listCacheReq.active = false; }
+    return false;
+  }
+  auto& ms = MapsApp::inst->mapsSearch;
+  int updflags = 0;
+  bool fresh = true;
+  for(int kind : {MapsSearch::MAP_SEARCH, MapsSearch::LIST_SEARCH}) {
+    if(!(kinds & kind)) { continue; }
+    CachedRequest& req = kind == MapsSearch::MAP_SEARCH ? mapCacheReq : listCacheReq;
+    req = CachedRequest();
+    req.provider = provider;
+    req.query = normalizeQuery(queryStr);
+    req.kind = kind | (flags & (MapsSearch::SORT_BY_DIST | MapsSearch::AUTOCOMPLETE));
+    req.cell = boundsCell(lngLat00, lngLat11);
+
+    int cflags = 0;
+    int64_t age = INT64_MAX;
+    int64_t cacheId = findCacheEntry(req, cflags, age);
+    size_t nresults = 0;
+    if(kind == MapsSearch::MAP_SEARCH) {
+      // map results can come from any cached cell for the query
+      resultCacheDB.stmt("SELECT r.osm_id, r.lng, r.lat, max(r.score), r.tags FROM search_results AS r"
+          " JOIN cache_keys AS k ON r.cache_id = k.id WHERE k.provider = ? AND k.query = ? AND k.kind = ?"
+          " AND k.timestamp >= CAST(strftime('%s') AS INTEGER) - ? AND r.lng >= ? AND r.lat >= ? AND r.lng <= ?"
+          " AND r.lat <= ? GROUP BY r.osm_id, r.lng, r.lat ORDER BY max(r.score) DESC LIMIT ?;")
+          .bind(req.provider, req.query, req.kind, resultCacheMaxAge, lngLat00.longitude, lngLat00.latitude,
+              lngLat11.longitude, lngLat11.latitude, int(MapsSearch::MAX_MAP_RESULTS))
+          .exec([&](int64_t id, double lng, double lat, double score, const char* tags){
+            ms->addMapResult(id, lng, lat, score, tags);
+            ++nresults;
+          });
+    }
+    else if(cacheId >= 0) {
+      resultCacheDB.stmt("SELECT osm_id, lng, lat, score, tags FROM search_results WHERE cache_id = ? ORDER BY rowid;")
+          .bind(cacheId).exec([&](int64_t id, double lng, double lat, double score, const char* tags){
+            ms->addListResult(id, lng, lat, score, tags);
+            ++nresults;
+          });
+    }
+    if(cacheId >= 0 || nresults > 0)
+      updflags |= kind | (cacheId >= 0 ? (cflags & MapsSearch::MORE_RESULTS) : 0);
+    if(cacheId >= 0 && age < resultRefreshAge)
+      LOGD("Using %d cached results for %s search '%s'", int(nresults), provider.c_str(), queryStr.c_str());
+    else {
+      fresh = false;
+      req.active = true;
+    }
+  }
+  if(updflags) {
+    ms->resultsUpdated((flags & ~kinds) | updflags);
+    if(!fresh)
+      ms->replaceCachedResults(updflags);
+  }
+  return fresh;
+}
+
+static void addCachedSearchResult(CachedRequest& req, int64_t osm_id, double lng, double lat, double score, const char* json)
+{
+  if(req.active)
+    req.results.push_back({osm_id, {lng, lat}, float(score), json});
+}
+
+static void saveCachedSearch(CachedRequest& req, int flags)
+{
+  if(!req.active) { return; }
+  req.active = false;
+  resultCacheDB.exec("BEGIN;");
+  int64_t cacheId = replaceCacheEntry(req, flags & MapsSearch::MORE_RESULTS);
+  auto insert = resultCacheDB.stmt("INSERT INTO search_results (cache_id,osm_id,lng,lat,score,tags) VALUES (?,?,?,?,?,?);");
+  for(const SearchResult& res : req.results)
+    insert.bind(cacheId, res.id, res.pos.longitude, res.pos.latitude, double(res.rank), res.tags).exec();
+  if(!resultCacheDB.exec("COMMIT;")) {
+    LOGW("Error saving online search results to cache: %s", resultCacheDB.errMsg());
+    resultCacheDB.exec("ROLLBACK;");
+  }
+  req.results.clear();
+}
+
+// show cached place info; returns true if fresh, in which case no request is needed
+static bool replayCachedPlaceInfo(const std::string& provider, const std::string& props, LngLat pos)
+{
+  CachedRequest& req = placeCacheReq;
+  req = CachedRequest();
+  if(!resultCacheDB.db) { return false; }
+  req.provider = provider;
+  req.osmId = osmIdFromJson(strToJson(props.c_str()));
+  req.query = req.osmId.empty() ? props : req.osmId;  // props for same place can vary (e.g. source, key order)
+  req.kind = PLACE_INFO_KIND;
+  req.cell = packTileId(lngLatTile(pos, 18));
+  req.active = true;
+
+  int cflags = 0;
+  int64_t age = INT64_MAX;
+  int64_t cacheId = findCacheEntry(req, cflags, age);
+  if(cacheId < 0) { return false; }
+  resultCacheDB.stmt("SELECT icon, title, value FROM place_info WHERE cache_id = ? ORDER BY rowid;").bind(cacheId)
+      .exec([&](const char* icon, const char* title, const char* value){
+        MapsApp::inst->addPlaceInfo(icon, title, value);
+        req.replayed = true;
+      });
+  if(age >= resultRefreshAge) { return false; }
+  req.active = false;
+  return true;
+}
+
+static void addCachedPlaceInfo(const char* icon, const char* title, const char* value)
+{
+  CachedRequest& req = placeCacheReq;
+  if(!req.active) { return; }
+  // ignore late results for a previous place (e.g. request not cancelled in time)
+  const MapsApp* app = MapsApp::inst;
+  if(req.osmId != app->pickResultOsmId || req.cell != packTileId(lngLatTile(app->pickResultCoord, 18))) {
+    LOGD("Not caching place info for %s - no longer the current place", req.osmId.c_str());
+    req.active = false;
+    return;
+  }
+  if(req.replayed) {
+    // first new result replaces cached results
+    MapsApp::gui->deleteContents(MapsApp::inst->infoContent->selectFirst(".info-section"), ".listitem");
+    req.replayed = false;
+  }
+  if(req.cacheId < 0)
+    req.cacheId = replaceCacheEntry(req, 0);
+  resultCacheDB.stmt("INSERT INTO place_info (cache_id,icon,title,value) VALUES (?,?,?,?);")
+      .bind(req.cacheId, icon, title, value).exec();
+}
+
 // duktape ref: https://duktape.org/api.html
 
 bool PluginManager::dukTryCall(duk_context* ctx, int nargs)
@@ -35,6 +264,7 @@ bool PluginManager::dukTryCall(duk_context* ctx, int nargs)
 PluginManager::PluginManager(MapsApp* _app) : MapsComponent(_app)
 {
   inst = this;
+  openResultCache(app);
   reload();
 }
 
@@ -71,6 +301,16 @@ void PluginManager::reload()
       dukTryCall(ctx, 0);  // JS code should call registerFunction()
     duk_pop(ctx);
   }
+
+  // osm-place-info.js marks getPlaceType() as matching native rules; mark is lost if another plugin redefines it
+  nativePlaceType = false;
+  if(duk_get_global_string(ctx, "getPlaceType") && duk_is_function(ctx, -1)) {
+    duk_get_prop_string(ctx, -1, "nativeRules");
+    nativePlaceType = duk_to_boolean(ctx, -1);
+    duk_pop(ctx);
+  }
+  duk_pop(ctx);
+  placeTypeCache.clear();
 }
 
 PluginManager::~PluginManager()
@@ -117,6 +357,7 @@ void PluginManager::jsSearch(int fnIdx, std::string queryStr, LngLat lngLat00, L
   //std::lock_guard<std::mutex> lock(jsMutex);
   auto state = (flags & MapsSearch::LIST_SEARCH) ? LIST_SEARCH : MAP_SEARCH;
   cancelRequests(state);
+  if(replayCachedSearch(searchFns[fnIdx].name, queryStr, lngLat00, lngLat11, flags)) { return; }
   inState = state;
 
   duk_context* ctx = jsContext;
@@ -151,6 +392,7 @@ static duk_ret_t dukTryJsonDecode(duk_context* ctx, void*)
 void PluginManager::jsPlaceInfo(int fnIdx, std::string props, LngLat pos)
 {
   cancelRequests(PLACE);
+  if(replayCachedPlaceInfo(placeFns[fnIdx].name, props, pos)) { return; }
   inState = PLACE;
 
   duk_context* ctx = jsContext;
@@ -193,6 +435,114 @@ void PluginManager::jsRoute(int fnIdx, std::string routeMode, const std::vector<
   inState = NONE;
 }
 
+// native version of getPlaceType() in osm-place-info.js; results are memoized by the tags used
+static const char* placeTypeKeys[] = {"place", "tourism", "leisure", "amenity", "historic", "shop", "railway",
+    "water", "natural", "landuse", "highway", "office", "building", "waterway"};
+
+// JS getPlaceType() just concatenates prop values, so numbers must be stringified the same way (0 is falsy in JS)
+static std::string propAsString(const Properties& props, const char* key)
+{
+  const Tangram::Value& val = props.get(key);
+  if(val.is<std::string>()) { return val.get<std::string>(); }
+  if(!val.is<double>()) { return ""; }
+  double d = val.get<double>();
+  if(d == 0 || std::isnan(d)) { return ""; }
+  return d == std::floor(d) && std::abs(d) < 1E15 ? fstring("%.0f", d) : fstring("%.15g", d);
+}
+
+// type and admin values used for place type
+static std::string placeTypeSig(const Properties& props)
+{
+  std::string type = propAsString(props, "route");
+  if(!type.empty())
+    type += " route";
+  else {
+    for(const char* key : placeTypeKeys) {
+      type = propAsString(props, key);
+      if(!type.empty()) { break; }
+    }
+  }
+  return type + '\n' + propAsString(props, "admin");
+}
+
+static std::string placeTypeFromSig(const std::string& sig)
+{
+  size_t sep = sig.find('\n');
+  std::string type = sig.substr(0, sep);
+  std::string admin = sig.substr(sep + 1);
+  std::replace(type.begin(), type.end(), '_', ' ');
+  if(!type.empty() && type[0] >= 'a' && type[0] <= 'z')
+    type[0] = type[0] - 'a' + 'A';
+  if(!admin.empty()) {
+    if(!type.empty()) { type += " \xE2\x80\xA2 "; }  // bullet
+    type += admin;
+  }
+  return type;
+}
+
+// place type, e.g., "Fast food" for props (JSON or props blob); JS results are memoized by props
+std::string PluginManager::getPlaceType(const Properties& props, const char* propstr)
+{
+  if(!propstr || !propstr[0]) { return ""; }
+  if(placeTypeCache.size() > 4096) { placeTypeCache.clear(); }
+  std::string key = nativePlaceType ? placeTypeSig(props)
+      : isPropsBlob(propstr) ? propsBlobToJson(propstr) : std::string(propstr);
+  auto it = placeTypeCache.find(key);
+  if(it != placeTypeCache.end()) { return it->second; }
+  std::string type = nativePlaceType ? placeTypeFromSig(key) : jsCallFn("getPlaceType", key);
+  return placeTypeCache[key] = type;
+}
+
+// classify a list of results in one call; propstrs[i] can be NULL to skip.  Cache is checked for all results
+//  first, then JS getPlaceType() (if used) is called once per distinct uncached props w/o repeated lookup
+std::vector<std::string> PluginManager::getPlaceTypes(const std::vector<Properties>& props,
+    const std::vector<const char*>& propstrs)
+{
+  std::vector<std::string> types(propstrs.size());
+  std::vector<std::string> keys(propstrs.size());
+  std::vector<size_t> uncached;
+  if(placeTypeCache.size() > 4096) { placeTypeCache.clear(); }
+  for(size_t ii = 0; ii < propstrs.size(); ++ii) {
+    const char* propstr = propstrs[ii];
+    if(!propstr || !propstr[0]) { continue; }
+    keys[ii] = nativePlaceType ? placeTypeSig(props[ii])
+        : isPropsBlob(propstr) ? propsBlobToJson(propstr) : std::string(propstr);
+    auto it = placeTypeCache.find(keys[ii]);
+    if(it != placeTypeCache.end())
+      types[ii] = it->second;
+    else
+      uncached.push_back(ii);
+  }
+  if(uncached.empty()) { return types; }
+
+  if(nativePlaceType) {
+    for(size_t ii : uncached)
+      types[ii] = placeTypeCache.emplace(keys[ii], placeTypeFromSig(keys[ii])).first->second;
+    return types;
+  }
+  duk_context* ctx = jsContext;
+  if(!duk_get_global_string(ctx, "getPlaceType")) {
+    LOGW("JS plugin function missing: getPlaceType");
+    duk_pop(ctx);
+    return types;
+  }
+  for(size_t ii : uncached) {
+    auto it = placeTypeCache.find(keys[ii]);  // duplicate within batch?
+    if(it == placeTypeCache.end()) {
+      std::string res;
+      duk_dup(ctx, -1);
+      duk_push_string(ctx, keys[ii].c_str());
+      if(dukTryCall(ctx, 1))
+        res = duk_safe_to_string(ctx, -1);
+      duk_pop(ctx);
+      it = placeTypeCache.emplace(keys[ii], std::move(res)).first;
+    }
+    types[ii] = it->second;
+  }
+  duk_pop(ctx);
+  return types;
+}
+
 std::string PluginManager::evalJS(const char* s)
 {
   std::string result;
@@ -308,13 +658,21 @@ static int addSearchResult(duk_context* ctx)
 
   auto& ms = MapsApp::inst->mapsSearch;
   if(flags & MapsSearch::UPDATE_RESULTS) {
+    if(flags & MapsSearch::MAP_SEARCH)
+      saveCachedSearch(mapCacheReq, flags);
+    if(flags & MapsSearch::LIST_SEARCH)
+      saveCachedSearch(listCacheReq, flags);
     ms->resultsUpdated(flags);
   }
   else {
-    if(flags & MapsSearch::MAP_SEARCH)
+    if(flags & MapsSearch::MAP_SEARCH) {
+      addCachedSearchResult(mapCacheReq, osm_id, lng, lat, score, json);
       ms->addMapResult(osm_id, lng, lat, score, json);
-    if(flags & MapsSearch::LIST_SEARCH)
+    }
+    if(flags & MapsSearch::LIST_SEARCH) {
+      addCachedSearchResult(listCacheReq, osm_id, lng, lat, score, json);
       ms->addListResult(osm_id, lng, lat, score, json);
+    }
   }
   return 0;
 }
@@ -355,6 +713,7 @@ static int addPlaceInfo(duk_context* ctx)
   const char* icon = duk_require_string(ctx, 0);
   const char* title = duk_require_string(ctx, 1);
   const char* value = duk_require_string(ctx, 2);
+  addCachedPlaceInfo(icon, title, value);
   MapsApp::inst->addPlaceInfo(icon, title, value);
   return 0;
 }
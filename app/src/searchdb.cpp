@@ -0,0 +1,464 @@
+#include "searchdb.h"
+#include <algorithm>
+#include <iterator>
+
+const char* POI_SCHEMA = R"SQL(BEGIN;
+--CREATE TABLE tiles(id INTEGER PRIMARY KEY, z INTEGER, x INTEGER, y INTEGER, timestamp INTEGER DEFAULT (CAST(strftime('%s') AS INTEGER)));
+--CREATE UNIQUE INDEX tiles_tile_id ON tiles (z, x, y);
+CREATE TABLE offline_tiles(tile_id INTEGER, offline_id INTEGER);
+CREATE UNIQUE INDEX offline_index ON offline_tiles (tile_id, offline_id);
+CREATE TABLE pois(name TEXT, tags TEXT, props TEXT, lng REAL, lat REAL, tile_id INTEGER);
+CREATE VIRTUAL TABLE pois_fts USING fts5(name, tags, content='pois');
+CREATE INDEX pois_tile_id ON pois (tile_id);
+
+-- trigger to delete pois when tile row deleted
+--CREATE TRIGGER tiles_delete AFTER DELETE ON tiles BEGIN
+--  DELETE FROM pois WHERE tile_id = OLD.rowid;
+--END;
+
+-- triggers to keep the FTS index up to date.
+CREATE TRIGGER pois_insert AFTER INSERT ON pois BEGIN
+  INSERT INTO pois_fts(rowid, name, tags) VALUES (NEW.rowid, NEW.name, NEW.tags);
+END;
+CREATE TRIGGER pois_delete AFTER DELETE ON pois BEGIN
+  INSERT INTO pois_fts(pois_fts, rowid, name, tags) VALUES ('delete', OLD.rowid, OLD.name, OLD.tags);
+END;
+CREATE TRIGGER pois_update AFTER UPDATE OF name, tags ON pois BEGIN
+  INSERT INTO pois_fts(pois_fts, rowid, name, tags) VALUES ('delete', OLD.rowid, OLD.name, OLD.tags);
+  INSERT INTO pois_fts(rowid, name, tags) VALUES (NEW.rowid, NEW.name, NEW.tags);
+END;
+PRAGMA user_version = 2;
+COMMIT;)SQL";
+
+// categorical search index: (key, value) pairs of search fields other than names are integer coded, with
+//  postings ordered by tag, then tile (Morton order), so category + bounds query is a few range scans
+// - user_version 2 indicates all POIs in DB have postings
+const char* TAG_SCHEMA = R"SQL(
+CREATE TABLE IF NOT EXISTS {s}.tag_values(id INTEGER PRIMARY KEY, key TEXT, value TEXT, tokens TEXT, UNIQUE(key, value));
+CREATE TABLE IF NOT EXISTS {s}.poi_tags(tag_id INTEGER, tile_id INTEGER, poi_id INTEGER,
+    PRIMARY KEY(tag_id, tile_id, poi_id)) WITHOUT ROWID;
+CREATE INDEX IF NOT EXISTS {s}.poi_tags_tile_id ON poi_tags (tile_id);
+)SQL";
+
+// convert z<<48|x<<24|y tile ids to Morton ids (see packTileId()); FTS update triggers are restricted to
+//  text columns first so that changing tile_id doesn't reindex every POI
+const char* MORTON_MIGRATION = R"SQL(BEGIN;
+DROP TRIGGER IF EXISTS pois_update;
+CREATE TRIGGER pois_update AFTER UPDATE OF name, tags ON pois BEGIN
+  INSERT INTO pois_fts(pois_fts, rowid, name, tags) VALUES ('delete', OLD.rowid, OLD.name, OLD.tags);
+  INSERT INTO pois_fts(rowid, name, tags) VALUES (NEW.rowid, NEW.name, NEW.tags);
+END;
+DROP TRIGGER IF EXISTS pois_trigram_update;
+UPDATE pois SET tile_id = mortonTileId(tile_id);
+UPDATE offline_tiles SET tile_id = mortonTileId(tile_id);
+UPDATE poi_tags SET tile_id = mortonTileId(tile_id);
+PRAGMA user_version = 1;
+COMMIT;)SQL";
+
+// optional index of name trigrams for typo-tolerant fallback search; roughly doubles size of FTS index
+const char* TRIGRAM_SCHEMA = R"SQL(BEGIN;
+CREATE VIRTUAL TABLE IF NOT EXISTS pois_trigram USING fts5(name, content='pois', tokenize='trigram');
+CREATE TRIGGER IF NOT EXISTS pois_trigram_insert AFTER INSERT ON pois BEGIN
+  INSERT INTO pois_trigram(rowid, name) VALUES (NEW.rowid, NEW.name);
+END;
+CREATE TRIGGER IF NOT EXISTS pois_trigram_delete AFTER DELETE ON pois BEGIN
+  INSERT INTO pois_trigram(pois_trigram, rowid, name) VALUES ('delete', OLD.rowid, OLD.name);
+END;
+CREATE TRIGGER IF NOT EXISTS pois_trigram_update AFTER UPDATE OF name ON pois BEGIN
+  INSERT INTO pois_trigram(pois_trigram, rowid, name) VALUES ('delete', OLD.rowid, OLD.name);
+  INSERT INTO pois_trigram(rowid, name) VALUES (NEW.rowid, NEW.name);
+END;
+INSERT INTO pois_trigram(pois_trigram) VALUES ('rebuild');
+COMMIT;)SQL";
+
+// personal data index in places DB (see MapsSearch::initPersonalIndex()); rowids are bookmarks.rowid,
+//  PERSONAL_TRACK_ID + tracks.rowid, or PERSONAL_WAYPOINT_ID + (tracks.rowid << 16) + waypoint index
+// - track location (used for ranking and search results) is center of bounds from track_summary, so tracks
+//  are searchable w/o loading GPX
+const char* PERSONAL_SCHEMA = R"SQL(BEGIN;
+CREATE VIRTUAL TABLE personal_fts USING fts5(title, notes, lng UNINDEXED, lat UNINDEXED);
+
+CREATE TRIGGER bookmarks_fts_insert AFTER INSERT ON bookmarks BEGIN
+  INSERT INTO personal_fts(rowid, title, notes, lng, lat) VALUES (NEW.rowid, NEW.title, NEW.notes, NEW.lng, NEW.lat);
+END;
+CREATE TRIGGER bookmarks_fts_delete AFTER DELETE ON bookmarks BEGIN
+  DELETE FROM personal_fts WHERE rowid = OLD.rowid;
+END;
+CREATE TRIGGER bookmarks_fts_update AFTER UPDATE OF title, notes, lng, lat ON bookmarks BEGIN
+  UPDATE personal_fts SET title = NEW.title, notes = NEW.notes, lng = NEW.lng, lat = NEW.lat WHERE rowid = OLD.rowid;
+END;
+
+CREATE TRIGGER tracks_fts_insert AFTER INSERT ON tracks BEGIN
+  INSERT INTO personal_fts(rowid, title, notes) VALUES ((1 << 40) + NEW.rowid, NEW.title, NEW.notes);
+END;
+CREATE TRIGGER tracks_fts_delete AFTER DELETE ON tracks BEGIN
+  DELETE FROM personal_fts WHERE rowid = (1 << 40) + OLD.rowid
+    OR rowid BETWEEN (2 << 40) + (OLD.rowid << 16) AND (2 << 40) + (OLD.rowid << 16) + 65535;
+END;
+CREATE TRIGGER tracks_fts_update AFTER UPDATE OF title, notes ON tracks BEGIN
+  UPDATE personal_fts SET title = NEW.title, notes = NEW.notes WHERE rowid = (1 << 40) + OLD.rowid;
+END;
+CREATE TRIGGER track_summary_fts_insert AFTER INSERT ON track_summary WHEN NEW.npts > 0 BEGIN
+  UPDATE personal_fts SET lng = (NEW.min_lng + NEW.max_lng)/2, lat = (NEW.min_lat + NEW.max_lat)/2
+    WHERE rowid = (1 << 40) + NEW.track_id;
+END;
+
+INSERT INTO personal_fts(rowid, title, notes, lng, lat) SELECT rowid, title, notes, lng, lat FROM bookmarks;
+INSERT INTO personal_fts(rowid, title, notes, lng, lat) SELECT (1 << 40) + t.rowid, t.title, t.notes,
+  (s.min_lng + s.max_lng)/2, (s.min_lat + s.max_lat)/2 FROM tracks AS t
+  LEFT JOIN track_summary AS s ON s.track_id = t.rowid AND s.npts > 0;
+COMMIT;)SQL";
+
+// replace "{s}" in sql with schema name
+std::string schemaSql(std::string sql, const std::string& schema)
+{
+  for(size_t pos = sql.find("{s}"); pos != std::string::npos; pos = sql.find("{s}", pos))
+    sql.replace(pos, 3, schema);
+  return sql;
+}
+
+// query main DB and shards: "{pois}", etc. in arm are replaced by "<schema>.pois AS pois" and arms are joined
+//  with UNION ALL; params must be numbered (?1, ?2, ...) since they are repeated in each arm
+std::string unionSql(const std::vector<std::string>& schemas, const std::string& arm, const char* tail)
+{
+  std::vector<std::string> arms;
+  for(const std::string& schema : schemas) {
+    std::string sql = arm;
+    for(const char* table : {"pois_fts", "pois_trigram", "pois", "poi_tags", "tag_values"}) {
+      std::string tok = fstring("{%s}", table);
+      for(size_t pos = sql.find(tok); pos != std::string::npos; pos = sql.find(tok, pos))
+        sql.replace(pos, tok.size(), schema + "." + table + " AS " + table);
+    }
+    arms.push_back(std::move(sql));
+  }
+  return joinStr(arms, " UNION ALL ") + tail;
+}
+
+// lower case value with non-alphanumeric chars replaced by spaces, for matching like FTS tokenizer
+std::string tagTokens(const std::string& value)
+{
+  std::string tokens(" ");
+  for(unsigned char c : value) {
+    if(isalnum(c) || c >= 0x80) { tokens.push_back(tolower(c)); }
+    else if(tokens.back() != ' ') { tokens.push_back(' '); }
+  }
+  if(tokens.back() != ' ') { tokens.push_back(' '); }
+  return tokens;
+}
+
+// create tag index tables if needed and prepare insert statements for schema
+bool preparePoiInsert(SQLiteDB& db, const std::string& schema, const std::string& poisql, PoiInsertStmts& st)
+{
+  if(!db.exec(schemaSql(TAG_SCHEMA, schema)))
+    LOGE("Error creating tag index for %s: %s", schema.c_str(), db.errMsg());
+  std::string tagsql = schemaSql("INSERT OR IGNORE INTO {s}.tag_values (key, value, tokens) VALUES (?1, ?2, ?3);", schema);
+  std::string postsql = schemaSql("INSERT OR IGNORE INTO {s}.poi_tags (tag_id, tile_id, poi_id)"
+      " SELECT id, ?3, ?4 FROM {s}.tag_values WHERE key = ?1 AND value = ?2;", schema);
+  if(sqlite3_prepare_v2(db.db, poisql.c_str(), -1, &st.poi, NULL) != SQLITE_OK
+      || sqlite3_prepare_v2(db.db, tagsql.c_str(), -1, &st.tag, NULL) != SQLITE_OK
+      || sqlite3_prepare_v2(db.db, postsql.c_str(), -1, &st.posting, NULL) != SQLITE_OK) {
+    LOGE("sqlite3_prepare_v2 error: %s\n", db.errMsg());
+    st.finalize();
+    st = PoiInsertStmts();
+    return false;
+  }
+  return true;
+}
+
+// add postings for categorical tag values (i.e. search fields other than names) of POI
+void insertPoiTags(const PoiInsertStmts& st, int64_t poiId, int64_t tileId,
+    const std::vector<std::string>& fields, const Tangram::Properties& props)
+{
+  for(const std::string& field : fields) {
+    if(field.find("name") != std::string::npos) { continue; }
+    const std::string& value = props.getString(field);
+    if(value.empty()) { continue; }
+    std::string tokens = tagTokens(value);
+    sqlite3_bind_text(st.tag, 1, field.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(st.tag, 2, value.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(st.tag, 3, tokens.c_str(), -1, SQLITE_STATIC);
+    if(sqlite3_step(st.tag) != SQLITE_DONE)
+      LOGE("sqlite3_step failed: %s\n", sqlite3_errmsg(sqlite3_db_handle(st.tag)));
+    sqlite3_reset(st.tag);
+    sqlite3_bind_text(st.posting, 1, field.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(st.posting, 2, value.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(st.posting, 3, tileId);
+    sqlite3_bind_int64(st.posting, 4, poiId);
+    if(sqlite3_step(st.posting) != SQLITE_DONE)
+      LOGE("sqlite3_step failed: %s\n", sqlite3_errmsg(sqlite3_db_handle(st.posting)));
+    sqlite3_reset(st.posting);
+  }
+}
+
+// insert POI w/ name, tags (values of search fields), and props, and its tag postings; tile_id (param 6 of
+//  st.poi) must be bound by caller
+bool insertPoi(const PoiInsertStmts& st, const std::string& name, LngLat lnglat, int64_t tileId,
+    const std::vector<std::string>& fields, const Tangram::Properties& props)
+{
+  sqlite3_stmt* stmt = st.poi;
+  std::string tags;
+  for(const std::string& field : fields) {
+    const std::string& s = props.getString(field);
+    if(!s.empty())
+      tags.append(s).append(" ");
+  }
+  // insert row
+  sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 2, tags.c_str(), tags.size() - 1, SQLITE_STATIC);  // drop trailing separator
+  std::string blob = propsToBlob(props);
+  if(isPropsBlob(blob.c_str()))
+    sqlite3_bind_blob(stmt, 3, blob.data(), blob.size(), SQLITE_TRANSIENT);
+  else
+    sqlite3_bind_text(stmt, 3, blob.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_double(stmt, 4, lnglat.longitude);
+  sqlite3_bind_double(stmt, 5, lnglat.latitude);
+  bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+  if(!ok)
+    LOGE("sqlite3_step failed: %s\n", sqlite3_errmsg(sqlite3_db_handle(stmt)));
+  else
+    insertPoiTags(st, sqlite3_last_insert_rowid(sqlite3_db_handle(stmt)), tileId, fields, props);
+  //sqlite3_clear_bindings(stmt);  -- retain binding for tile_id set by caller
+  sqlite3_reset(stmt);  // necessary to reuse statement
+  return ok;
+}
+
+// categorical query (OR of words or phrases, as produced by transformQuery) -> LIKE patterns for
+//  tag_values.tokens; returns false for anything else (prefix query, AND, NOT, ...), which uses FTS
+bool parseCategoryQuery(const std::string& queryStr, std::vector<std::string>& patterns)
+{
+  patterns.clear();
+  if(queryStr.empty() || queryStr.back() == '*') { return false; }
+  std::string term;
+  bool joinNext = true;  // true at start and after "+" or "OR"
+  for(std::string word : splitStr<std::vector>(queryStr, " ", true)) {
+    if(word == "OR" || word == "+") {
+      if(term.empty() || joinNext) { return false; }
+      if(word == "OR") {
+        patterns.push_back("% " + term + " %");
+        term.clear();
+      }
+      joinNext = true;
+      continue;
+    }
+    if(!joinNext) { return false; }  // implicit AND
+    if(word.size() > 2 && word.front() == '"' && word.back() == '"')
+      word = word.substr(1, word.size() - 2);
+    if(word == "AND" || word == "NOT" || word == "NEAR") { return false; }
+    for(char& c : word) {
+      if(!isalnum((unsigned char)c)) { return false; }
+      c = tolower(c);
+    }
+    term.append(term.empty() ? "" : " ").append(word);
+    joinNext = false;
+  }
+  if(term.empty() || joinNext) { return false; }
+  patterns.push_back("% " + term + " %");
+  return true;
+}
+
+// condition on POIs having any tag matching patterns, optionally restricted to tile_id ranges, or having name
+//  matching FTS query in nameParam (e.g. "?1"), so POIs like "Joe's Cafe" w/o matching tag are also found
+std::string tagMatchSql(const std::vector<std::string>& patterns, const std::vector<std::string>& tileRanges,
+    const char* nameParam)
+{
+  std::vector<std::string> likes;
+  for(const std::string& pattern : patterns)
+    likes.push_back("tokens LIKE '" + pattern + "'");  // patterns are alphanumeric, so no escaping needed
+  std::string sql = "pois.rowid IN (SELECT poi_id FROM {poi_tags} WHERE tag_id IN (SELECT id FROM {tag_values} WHERE "
+      + joinStr(likes, " OR ") + ")";
+  if(!tileRanges.empty())
+    sql += " AND (" + joinStr(tileRanges, " OR ") + ")";
+  return "(" + sql + ") OR pois.rowid IN (SELECT rowid FROM {pois_fts} WHERE pois_fts MATCH 'name : (' || "
+      + nameParam + " || ')'))";
+}
+
+// tile_id conditions for tiles at lowest indexed zoom covering bounds, coarsened until there are at most
+//  maxTiles; id range of each tile covers all descendants, so tiles indexed at any higher zoom are included
+// - zooms has bit z set if any tiles at zoom z are indexed
+std::vector<std::string> tileRangeSql(LngLat lngLat00, LngLat lngLat11, int maxTiles, unsigned int zooms)
+{
+  std::vector<std::string> tileRanges;
+  if(!zooms) { return tileRanges; }
+  int z = 0;
+  while(!(zooms & (1u << z))) { ++z; }
+  TileID tile00 = lngLatTile(lngLat00, z), tile11 = lngLatTile(lngLat11, z);
+  for(; z > 0 && (tile11.x - tile00.x + 1)*(tile00.y - tile11.y + 1) > maxTiles; --z) {
+    tile00 = lngLatTile(lngLat00, z-1);
+    tile11 = lngLatTile(lngLat11, z-1);
+  }
+  for(int x = tile00.x; x <= tile11.x; ++x) {
+    for(int y = tile11.y; y <= tile00.y; ++y) {  // note y tile index incr for decr latitude
+      int64_t lo, hi;
+      tileIdRange(TileID(x, y, z), lo, hi);
+      tileRanges.push_back(fstring("(tile_id >= %lld AND tile_id < %lld)", (long long)lo, (long long)hi));
+    }
+  }
+  return tileRanges;
+}
+
+// split UTF-8 string into overlapping 3 character substrings (ASCII lower cased, like trigram tokenizer)
+std::vector<std::string> getTrigrams(const std::string& s)
+{
+  std::vector<std::string> chars;
+  for(size_t ii = 0; ii < s.size();) {
+    size_t n = 1;
+    while(ii + n < s.size() && (s[ii + n] & 0xC0) == 0x80) { ++n; }
+    chars.push_back(n == 1 ? std::string(1, char(tolower(s[ii]))) : s.substr(ii, n));
+    ii += n;
+  }
+  std::vector<std::string> trigrams;
+  for(size_t ii = 0; ii + 2 < chars.size(); ++ii)
+    trigrams.push_back(chars[ii] + chars[ii+1] + chars[ii+2]);
+  std::sort(trigrams.begin(), trigrams.end());
+  trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+  return trigrams;
+}
+
+// split into lower case tokens like FTS5 unicode61 tokenizer; returns false if non-ASCII chars present,
+//  since we don't replicate tokenizer's case and diacritic folding
+bool acTokenize(const std::string& s, std::vector<std::string>& tokens)
+{
+  tokens.clear();
+  std::string tok;
+  for(unsigned char c : s) {
+    if(c >= 0x80) { return false; }
+    if(isalnum(c)) { tok.push_back(tolower(c)); }
+    else if(!tok.empty()) { tokens.push_back(std::move(tok)); tok.clear(); }
+  }
+  if(!tok.empty()) { tokens.push_back(std::move(tok)); }
+  return true;
+}
+
+// same as FTS query `name : "w1" AND "w2" ... AND "wn"*`
+bool acMatches(const std::vector<std::string>& words, const std::vector<std::string>& tokens)
+{
+  for(size_t ii = 0; ii < words.size(); ++ii) {
+    bool last = ii + 1 == words.size();
+    auto it = std::find_if(tokens.begin(), tokens.end(), [&](const std::string& tok){
+      return last ? tok.compare(0, words[ii].size(), words[ii]) == 0 : tok == words[ii];
+    });
+    if(it == tokens.end()) { return false; }
+  }
+  return true;
+}
+
+// union of ftsArm over schemas w/o complete tag index and tagArm over the rest (or ftsArm for all schemas if
+//  tagArm is empty); returns false in usedTags if no schemas used tag index
+std::string categoryUnionSql(const std::vector<std::string>& schemas, const SchemaFilter& hasTags,
+    const std::string& ftsArm, const std::string& tagArm, const char* tail, bool* usedTags)
+{
+  std::vector<std::string> fts, tags;
+  for(const std::string& schema : schemas)
+    (!tagArm.empty() && hasTags(schema) ? tags : fts).push_back(schema);
+  if(usedTags) { *usedTags = !tags.empty(); }
+  std::string sql = fts.empty() ? "" : unionSql(fts, ftsArm, "");
+  if(!tags.empty())
+    sql += (sql.empty() ? "" : " UNION ALL ") + unionSql(tags, tagArm, "");
+  return sql + tail;
+}
+
+// POIs in bounds: ?1 = query, ?2 - ?5 = lng0, lat0, lng1, lat1, ?6 = limit; results are rowid, lng, lat, rank,
+//  props ordered by rank; tag matches have no FTS rank, so they are ranked by distance from rank origin
+std::string mapSearchSql(const std::vector<std::string>& schemas, const SchemaFilter& hasTags,
+    const std::string& queryStr, LngLat lngLat00, LngLat lngLat11, unsigned int zooms, bool* usedTags)
+{
+  const char* bounds = " pois.lng >= ?2 AND pois.lat >= ?3 AND pois.lng <= ?4 AND pois.lat <= ?5";
+  std::vector<std::string> cats;
+  std::string tagArm = !parseCategoryQuery(queryStr, cats) ? "" : "SELECT pois.rowid, lng, lat, osmSearchRank(-1.0,"
+      " lng, lat) AS rank, props FROM {pois} WHERE " + tagMatchSql(cats, tileRangeSql(lngLat00, lngLat11, 16, zooms),
+      "?1") + " AND" + bounds;
+  std::string ftsArm = "SELECT pois.rowid, lng, lat, rank, props FROM {pois_fts} JOIN {pois}"
+      " ON pois.ROWID = pois_fts.ROWID WHERE pois_fts MATCH ?1 AND" + std::string(bounds);
+  return categoryUnionSql(schemas, hasTags, ftsArm, tagArm, " ORDER BY rank LIMIT ?6;", usedTags);
+}
+
+// one result per grid cell (best ranked POI and count) for cells in bounds: ?1, ?2 = cell size (lng, lat),
+//  ?3 = query, ?4 - ?7 = lng0, lat0, lng1, lat1; results are cx, cy, count, rowid, lng, lat, score, props
+std::string clusterSearchSql(const std::vector<std::string>& schemas, const SchemaFilter& hasTags,
+    const std::string& queryStr, LngLat lngLat00, LngLat lngLat11, unsigned int zooms)
+{
+  // cells are grouped in each schema, then combined
+  const char* cellSel = "SELECT CAST((lng + 180.0)/?1 AS INTEGER) AS cx, CAST((lat + 90.0)/?2 AS INTEGER) AS cy,"
+      " count(1) AS n, pois.rowid AS id, lng, lat, ";
+  const char* cellWhere = " pois.lng >= ?4 AND pois.lat >= ?5 AND pois.lng < ?6 AND pois.lat < ?7 GROUP BY cx, cy";
+  std::vector<std::string> cats;
+  bool iscat = parseCategoryQuery(queryStr, cats);
+  // tag matches have no FTS rank, so for category queries the representative POI for a cell is the one nearest
+  //  rank origin in both arms - min(score) across schemas must compare scores on the same scale
+  const char* scoreSel = iscat ? "min(osmSearchRank(-1.0, lng, lat)) AS score, props" : "min(rank) AS score, props";
+  std::string tagArm = !iscat ? "" : cellSel + std::string(scoreSel) + " FROM {pois} WHERE "
+      + tagMatchSql(cats, tileRangeSql(lngLat00, lngLat11, 16, zooms), "?3") + " AND" + cellWhere;
+  return "SELECT cx, cy, sum(n), id, lng, lat, min(score), props FROM (" + categoryUnionSql(schemas, hasTags,
+      cellSel + std::string(scoreSel) + " FROM {pois_fts} JOIN {pois} ON pois.ROWID = pois_fts.ROWID"
+      " WHERE pois_fts MATCH ?3 AND" + cellWhere, tagArm, ") GROUP BY cx, cy;");
+}
+
+// nearest/best POIs, and personal data from places DB (attached as "places") if personal is set: ?1 = query,
+//  ?2 = offset; results are rowid, lng, lat, rank, props, srank; personal results have negated rowids
+std::string listSearchSql(const std::vector<std::string>& schemas, const SchemaFilter& hasTags,
+    const std::string& queryStr, bool rankByDist, bool personal, int limit, bool* usedTags)
+{
+  // categorical queries use tag index where available
+  std::vector<std::string> cats;
+  std::string tagArm = !parseCategoryQuery(queryStr, cats) ? "" : "SELECT pois.rowid, lng, lat,"
+      " osmSearchRank(-1.0, lng, lat) AS rank, props, osmSearchRank(-1.0, lng, lat) AS srank FROM {pois} WHERE "
+      + tagMatchSql(cats, {}, "?1");
+  std::string sql = categoryUnionSql(schemas, hasTags, fstring("SELECT pois.rowid, lng, lat, rank, props,"
+      " osmSearchRank(%s, lng, lat) AS srank FROM {pois_fts} JOIN {pois} ON pois.ROWID = pois_fts.ROWID"
+      " WHERE pois_fts MATCH ?1", rankByDist ? "-1.0" : "rank"), tagArm, "", usedTags);
+  // tracks w/o location (no summary yet) are listed after everything else
+  if(personal) {
+    sql += fstring(" UNION ALL SELECT -personal_fts.rowid, personal_fts.lng, personal_fts.lat, personal_fts.rank,"
+        " ifnull(nullif(bookmarks.props, ''), json_object('name', personal_fts.title)), CASE WHEN personal_fts.lng"
+        " IS NULL THEN 0 ELSE osmSearchRank(%s, personal_fts.lng, personal_fts.lat) END AS srank"
+        " FROM places.personal_fts AS personal_fts LEFT JOIN places.bookmarks AS bookmarks"
+        " ON personal_fts.rowid < %lld AND bookmarks.rowid = personal_fts.rowid WHERE personal_fts MATCH ?1",
+        rankByDist ? "-1.0" : fstring("%d*personal_fts.rank", PERSONAL_RANK_SCALE).c_str(), (long long)PERSONAL_TRACK_ID);
+  }
+  return sql + fstring(" ORDER BY srank LIMIT %d OFFSET ?2;", limit);
+}
+
+// autocomplete candidates (unordered): ?1 = query, ?2 = limit; results are rowid, name, lng, lat, rank, props
+std::string autocompleteSql(const std::vector<std::string>& schemas)
+{
+  return unionSql(schemas, "SELECT pois.rowid, pois.name, lng, lat, rank, props FROM {pois_fts}"
+      " JOIN {pois} ON pois.ROWID = pois_fts.ROWID WHERE pois_fts MATCH ?1", " LIMIT ?2;");
+}
+
+// best autocomplete results ranked by DB, if there are too many candidates: ?1 = query; results as above + srank
+std::string autocompleteRankedSql(const std::vector<std::string>& schemas, bool rankByDist, int limit)
+{
+  return unionSql(schemas, fstring("SELECT pois.rowid, pois.name, lng, lat, rank, props,"
+      " osmSearchRank(%s, lng, lat) AS srank FROM {pois_fts} JOIN {pois} ON pois.ROWID = pois_fts.ROWID"
+      " WHERE pois_fts MATCH ?1", rankByDist ? "-1.0" : "rank"), fstring(" ORDER BY srank LIMIT %d;", limit).c_str());
+}
+
+// fuzzy search candidates from trigram index, best bm25 matches first: ?1 = trigramMatchStr(), ?2 = limit;
+//  results are rowid, name, lng, lat, props, rank
+std::string fuzzySearchSql(const std::vector<std::string>& schemas)
+{
+  return unionSql(schemas, "SELECT pois.rowid, pois.name, lng, lat, props, rank FROM {pois_trigram}"
+      " JOIN {pois} ON pois.ROWID = pois_trigram.ROWID WHERE pois_trigram MATCH ?1", " ORDER BY rank LIMIT ?2;");
+}
+
+// FTS query matching any of trigrams
+std::string trigramMatchStr(const std::vector<std::string>& trigrams)
+{
+  std::vector<std::string> terms;
+  for(const std::string& tri : trigrams) {
+    std::string term("\"");
+    for(char c : tri) { term.append(c == '"' ? 2 : 1, c); }  // escape quotes by doubling
+    terms.push_back(term + "\"");
+  }
+  return joinStr(terms, " OR ");
+}
+
+// fraction of query trigrams (sorted, as returned by getTrigrams()) present in name
+float trigramSimilarity(const std::vector<std::string>& qtris, const char* name)
+{
+  if(qtris.empty()) { return 0; }
+  std::vector<std::string> ntris = getTrigrams(name ? name : "");
+  std::vector<std::string> common;
+  std::set_intersection(qtris.begin(), qtris.end(), ntris.begin(), ntris.end(), std::back_inserter(common));
+  return float(common.size())/qtris.size();
+}
@@ -5,6 +5,7 @@
 #include "plugins.h"
 #include "mapsearch.h"
 #include "bookmarks.h"
+#include "offlinemaps.h"
 #include "trackwidgets.h"
 
 #include "gaml/src/yaml.h"
@@ -54,8 +55,12 @@ void MapsTracks::updateLocation(const Location& loc)
     //if(std::isnan(loc.spd))
       locs.back().loc.spd = currSpeed; //dist/dt;
     if(!app->appSuspended) {
-      if(recordedTrack.visible || activeTrack == &recordedTrack)
-        updateTrackMarker(&recordedTrack);  // rebuild marker
+      if(recordedTrack.visible || activeTrack == &recordedTrack) {
+        if(recordedTrack.marker && locs.size() > 2)
+          recordedTrack.marker->appendTrack(&recordedTrack.tracks.front(), recordedTrack.tracks.size());
+        else
+          updateTrackMarker(&recordedTrack);  // rebuild marker
+      }
       if(activeTrack == &recordedTrack || (!activeTrack && tracksPanel->isVisible()))
         updateStats(&recordedTrack);
     }
@@ -65,7 +70,7 @@ void MapsTracks::updateLocation(const Location& loc)
     recordedTrack.modified = !saveTrack(&recordedTrack);
     return;
   }
-  // append point to GPX file in case process is killed - pugixml will ignore the missing closing tags
+  // append point to GPX file in case process is killed - loadGPX() will ignore the missing closing tags
   if(!recordGPXStrm) {
     recordGPXStrm = std::make_unique<FileStream>(recordedTrack.filename.c_str(), "rb+");
     // don't bother truncating since single <trkpt> node is over 30 bytes
@@ -90,11 +95,9 @@ void MapsTracks::updateLocation(const Location& loc)
     }
   }
   if(!recordGPXStrm->is_open()) return;
-  PugiXMLWriter writer(*recordGPXStrm);
-  pugi::xml_document xmldoc;
-  pugi::xml_node trkpt = xmldoc.append_child("trkpt");
-  saveWaypoint(trkpt, locs.back(), recordedTrack.hasSpeed);
-  trkpt.print(writer, "  ", pugi::format_default | pugi::format_no_declaration);
+  std::string trkpt;
+  saveWaypoint(trkpt, "trkpt", locs.back(), recordedTrack.hasSpeed);
+  recordGPXStrm->write(trkpt.data(), trkpt.size());
 }
 
 bool MapsTracks::saveTrack(GpxFile* track)
@@ -115,7 +118,63 @@ bool MapsTracks::saveTrack(GpxFile* track)
     }
   }
   SQLiteStmt(app->bkmkDB, "UPDATE tracks SET notes = ? WHERE rowid = ?;").bind(track->desc, track->rowid).exec();
-  return saveGPX(track);
+  MapsSearch::indexTrack(track);
+  if(!saveGPX(track)) { return false; }
+  saveSummary(track->rowid, calcTrackSummary(track, speedInvTau));
+  return true;
+}
+
+void MapsTracks::saveSummary(int rowid, const TrackSummary& summary)
+{
+  GpxFile* track = recordedTrack.rowid == rowid ? &recordedTrack : NULL;
+  for(GpxFile& t : tracks) {
+    if(t.rowid == rowid) { track = &t;  break; }
+  }
+  // summary calculated in background may be stale if GPX was saved again since
+  if(track && summary.gpxSize > 0) {
+    int64_t mtime = 0, size = 0;
+    if(gpxFileInfo(track->filename, mtime, size) && (mtime != summary.gpxMTime || size != summary.gpxSize)) {
+      LOGD("Discarding stale summary for %s", track->filename.c_str());
+      return;
+    }
+  }
+  if(track)
+    track->summary = summary;
+  if(recordedTrack.rowid == rowid)
+    recordedTrack.summary = summary;
+  tracksIndexDirty = true;
+  if(rowid < 0) { return; }
+  const TrackSummary& s = summary;
+  SQLiteStmt(app->bkmkDB, "INSERT OR REPLACE INTO track_summary (track_id, gpx_mtime, gpx_size, npts, dist,"
+      " duration, ascent, descent, start_time, min_lng, min_lat, max_lng, max_lat) VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?);")
+      .bind(rowid, s.gpxMTime, s.gpxSize, s.npts, s.dist, s.duration, s.ascent, s.descent, s.startTime,
+          s.minLngLat.longitude, s.minLngLat.latitude, s.maxLngLat.longitude, s.maxLngLat.latitude).exec();
+  archiveDirty = true;
+}
+
+// summaries are stored when track is saved, but GPX file may have been replaced or edited outside the app
+void MapsTracks::refreshSummaries(std::vector<GpxFile*> tracklist)
+{
+  struct SummaryKey { int rowid; std::string filename; int64_t mtime, size; };
+  std::vector<SummaryKey> keys;
+  for(GpxFile* track : tracklist)
+    keys.push_back({track->rowid, track->filename, track->summary.gpxMTime, track->summary.gpxSize});
+  double invtau = speedInvTau;
+  MapsOffline::queueOfflineTask(0, [this, invtau, keys=std::move(keys)](){
+    int64_t t0 = mSecSinceEpoch();
+    size_t nupdated = 0;
+    for(const SummaryKey& key : keys) {
+      int64_t mtime = 0, size = 0;
+      if(!gpxFileInfo(key.filename, mtime, size) || (mtime == key.mtime && size == key.size)) { continue; }
+      GpxFile gpx("", "", key.filename);
+      if(!loadGPX(&gpx)) { continue; }
+      TrackSummary summary = calcTrackSummary(&gpx, invtau);
+      MapsApp::runOnMainThread([this, rowid=key.rowid, summary](){ saveSummary(rowid, summary); });
+      ++nupdated;
+    }
+    if(nupdated > 0)
+      LOG("Updated %zu track summaries in %d ms", nupdated, int(mSecSinceEpoch() - t0));
+  });
 }
 
 static void addRouteStepMarker(Map* map, Waypoint& wp, GpxFile* track)
@@ -132,13 +191,20 @@ static void addRouteStepMarker(Map* map, Waypoint& wp, GpxFile* track)
 
 void MapsTracks::updateTrackMarker(GpxFile* track)
 {
-  if(!track->loaded && !track->filename.empty() && !loadGPX(track))
-    MapsApp::messageBox("File not found", fstring("Error opening %s", track->filename.c_str()), {"OK"});
+  if(!track->loaded && !track->filename.empty()) {
+    if(!loadGPXCached(track))
+      MapsApp::messageBox("File not found", fstring("Error opening %s", track->filename.c_str()), {"OK"});
+    else {
+      if(track == activeTrack || track == &recordedTrack)
+        track->expand();
+      MapsSearch::indexTrack(track);
+    }
+  }
 
   Properties props;
   if(!track->marker)
     track->marker = std::make_unique<TrackMarker>();  //app->map.get(), "layers.track.draw.track");
-  if(track->activeWay() && (track->activeWay()->pts.size() > 1 || track->routes.size() > 1)) {
+  if(track->activeWay() && (track->activeWay()->size() > 1 || track->routes.size() > 1)) {
     if(!track->routes.empty())
       track->marker->setTrack(&track->routes.front(), track->routes.size());
     else
@@ -151,6 +217,9 @@ void MapsTracks::updateTrackMarker(GpxFile* track)
     props.set("visible", 0);
   props.set("track_feature_id", track->marker->featureId);
   track->marker->setProperties(std::move(props));
+  // track points for visible tracks (other than active track) are only needed for drawing
+  if(track != activeTrack && track != &recordedTrack && track->visible)
+    track->compact();
 
   if(!track->routes.empty() && track->routeMode != "direct") {
     auto& pts = track->routes.back().pts;
@@ -178,7 +247,7 @@ void MapsTracks::showTrack(GpxFile* track, bool show)  //, const char* styling)
     if(!show) return;
     updateTrackMarker(track);
   }
-  bool hasway = track->activeWay() && track->activeWay()->pts.size() > 1;
+  bool hasway = track->activeWay() && track->activeWay()->size() > 1;
   track->marker->setProperties({{{"visible", show && hasway ? 1 : 0}}});
   for(Waypoint& wp : track->waypoints)
     app->map->markerSetVisible(wp.marker, show);
@@ -254,8 +323,10 @@ Widget* MapsTracks::createTrackEntry(GpxFile* track)
       if(track->archived) {
         if(track->visible)
           setTrackVisible(track, false);
-        if(!archiveLoaded)
+        if(!archiveLoaded) {
           tracks.remove_if([](const GpxFile& t){ return t.archived; });
+          tracksIndexDirty = true;
+        }
         archiveDirty = true;
         populateTrackList();  // update archived count
       }
@@ -268,7 +339,8 @@ Widget* MapsTracks::createTrackEntry(GpxFile* track)
     overflowMenu->addItem("Delete", [=](){
       setTrackVisible(track, false);
       SQLiteStmt(app->bkmkDB, "DELETE FROM tracks WHERE rowid = ?").bind(track->rowid).exec();
-      // move GPX file to trash and add undelete item
+      // move GPX file to trash and add undelete item; cache is recreated if track is restored
+      removeGPXCache(track->filename);
       FSPath fileinfo(track->filename);
       FSPath trashinfo(MapsApp::baseDir, ".trash/" + fileinfo.fileName());
       moveFile(fileinfo, trashinfo);
@@ -284,6 +356,7 @@ Widget* MapsTracks::createTrackEntry(GpxFile* track)
       int rowid = track->rowid;
       // must not access track after this point
       tracks.remove_if([rowid](const GpxFile& t){ return t.rowid == rowid; });
+      tracksIndexDirty = true;
       app->gui->deleteWidget(item);
     });
   }
@@ -295,33 +368,136 @@ Widget* MapsTracks::createTrackEntry(GpxFile* track)
 void MapsTracks::loadTracks(bool archived)
 {
   // order by timestamp for Archived
-  const char* query = "SELECT rowid, title, filename, notes, style"  //strftime('%Y-%m-%d', timestamp, 'unixepoch')
-      " FROM tracks WHERE archived = ? ORDER BY timestamp;";
-  SQLiteStmt(app->bkmkDB, query).bind(archived).exec(
-      [&](int rowid, std::string title, std::string filename, std::string desc, std::string style) {
+  const char* query = "SELECT t.rowid, t.title, t.filename, t.notes, t.style, t.timestamp, IFNULL(s.npts, -1),"
+      " s.gpx_mtime, s.gpx_size, s.dist, s.duration, s.ascent, s.descent, s.start_time,"
+      " s.min_lng, s.min_lat, s.max_lng, s.max_lat FROM tracks AS t"
+      " LEFT JOIN track_summary AS s ON s.track_id = t.rowid WHERE t.archived = ? ORDER BY t.timestamp;";
+  std::vector<GpxFile*> loaded;
+  SQLiteStmt(app->bkmkDB, query).bind(archived).exec([&](int rowid, std::string title, std::string filename,
+      std::string desc, std::string style, int64_t timestamp, int64_t npts, int64_t mtime, int64_t size,
+      double dist, double duration, double ascent, double descent, double starttime,
+      double lng0, double lat0, double lng1, double lat1) {
     FSPath fileinfo(filename);
     if(!fileinfo.isAbsolute())
       fileinfo = FSPath(MapsApp::baseDir, filename);
     tracks.emplace_back(title, desc, fileinfo.path, style, rowid, archived);
+    GpxFile& track = tracks.back();
+    track.timestamp = double(timestamp);
+    TrackSummary& s = track.summary;
+    s.npts = npts;  s.gpxMTime = mtime;  s.gpxSize = size;
+    s.dist = dist;  s.duration = duration;  s.ascent = ascent;  s.descent = descent;  s.startTime = starttime;
+    s.minLngLat = LngLat(lng0, lat0);  s.maxLngLat = LngLat(lng1, lat1);
+    loaded.push_back(&track);
+  });
+  tracksIndexDirty = true;
+  refreshSummaries(std::move(loaded));
+}
+
+void MapsTracks::updateTracksIndex()
+{
+  if(!tracksIndexDirty) { return; }
+  tracksIndexDirty = false;
+  std::vector<BoxIndex::Box> boxes;
+  std::vector<GpxFile*> bounded;
+  unboundedTracks.clear();
+  for(GpxFile& track : tracks) {
+    if(track.summary.valid()) {
+      boxes.emplace_back(track.summary.minLngLat, track.summary.maxLngLat);
+      bounded.push_back(&track);
+    }
+    else
+      unboundedTracks.push_back(&track);
+  }
+  tracksIndex.clear();
+  indexedTracks.clear();
+  for(size_t ii : BoxIndex::sortSTR(boxes)) {
+    tracksIndex.append(boxes[ii]);
+    indexedTracks.push_back(bounded[ii]);
+  }
+}
+
+// returns tracks (excluding recordedTrack and navRoute) which might intersect the given bounds, i.e., all
+//  tracks w/o a summary are included
+std::vector<GpxFile*> MapsTracks::findTracks(LngLat lngLat00, LngLat lngLat11)
+{
+  updateTracksIndex();
+  std::vector<GpxFile*> res(unboundedTracks);
+  BoxIndex::Box q(lngLat00, lngLat11);
+  tracksIndex.search(q, [&](size_t ii){
+    if(indexedTracks[ii]->summary.intersects(lngLat00, lngLat11))
+      res.push_back(indexedTracks[ii]);
   });
+  return res;
+}
+
+// find visible track (other than active track) nearest to pos, within maxDist (km)
+GpxFile* MapsTracks::nearestTrack(LngLat pos, double maxDist)
+{
+  double dlat = maxDist/111.2;  // km per degree latitude
+  double dlng = dlat/std::max(0.01, std::cos(pos.latitude*M_PI/180));
+  GpxFile* best = NULL;
+  for(GpxFile* track : findTracks(LngLat(pos.longitude - dlng, pos.latitude - dlat),
+      LngLat(pos.longitude + dlng, pos.latitude + dlat))) {
+    if(!track->visible || !track->loaded || track == activeTrack) { continue; }
+    for(GpxWay& way : track->routes.empty() ? track->tracks : track->routes) {
+      int idx = way.segIndex.nearest(way, pos, maxDist);
+      if(idx < 0) { continue; }
+      maxDist = lngLatDist(way.lngLat(idx), pos);
+      best = track;
+    }
+  }
+  return best;
 }
 
 void MapsTracks::populateArchived()
 {
   if(!archiveLoaded)
     loadTracks(true);
-  else if(!archiveDirty)
+  else if(!archiveDirty) {
+    filterMapAreaTracks(archivedContent);  // map may have moved while panel was hidden
     return;
+  }
   archiveLoaded = true;
   archiveDirty = false;
-  // needed to handle case of archiving an imported track, maybe some other edge cases
-  tracks.sort([](const GpxFile& a, const GpxFile& b){ return a.timestamp < b.timestamp; });
+  // sort using values from DB so that GPX files need not be loaded
+  std::vector<GpxFile*> archivedTracks;
+  for(GpxFile& track : tracks) {
+    if(track.archived)
+      archivedTracks.push_back(&track);
+  }
+  std::string sort = app->config["tracks"]["archived_sort"].as<std::string>("date");
+  auto trackDate = [](const GpxFile* t){ return t->summary.startTime > 0 ? t->summary.startTime : t->timestamp; };
+  if(sort == "name")
+    std::sort(archivedTracks.begin(), archivedTracks.end(),
+        [](const GpxFile* a, const GpxFile* b){ return a->title < b->title; });
+  else if(sort == "dist")
+    std::sort(archivedTracks.begin(), archivedTracks.end(),
+        [](const GpxFile* a, const GpxFile* b){ return a->summary.dist > b->summary.dist; });
+  else  // Archived ordered from newest to oldest
+    std::sort(archivedTracks.begin(), archivedTracks.end(),
+        [&](const GpxFile* a, const GpxFile* b){ return trackDate(a) > trackDate(b); });
 
   app->gui->deleteContents(archivedContent, ".listitem");
-  // tracks is ordered by ascending timestamp, but we want Archived ordered from newest to oldest
-  for(auto it = tracks.rbegin(); it != tracks.rend(); ++it) {  //for(GpxFile& track : tracks) {
-    if(it->archived)
-      archivedContent->addWidget(createTrackEntry(&(*it)));
+  for(GpxFile* track : archivedTracks)
+    archivedContent->addWidget(createTrackEntry(track));
+  filterMapAreaTracks(archivedContent);
+}
+
+// hide list items for tracks (other than recorded track) not intersecting map area if enabled
+void MapsTracks::filterMapAreaTracks(Widget* content)
+{
+  std::vector<int> inview;
+  if(mapAreaTracks) {
+    LngLat lngLat00, lngLat11;
+    app->getMapBounds(lngLat00, lngLat11);
+    for(GpxFile* track : findTracks(lngLat00, lngLat11))
+      inview.push_back(track->rowid);
+    std::sort(inview.begin(), inview.end());
+  }
+  for(Widget* item : content->select(".listitem")) {
+    int rowid = item->node->getIntAttr("__rowid", INT_MAX);
+    item->setVisible(!mapAreaTracks || rowid == INT_MAX || rowid == recordedTrack.rowid
+        || std::binary_search(inview.begin(), inview.end(), rowid));
   }
 }
 
@@ -349,19 +525,20 @@ void MapsTracks::populateTrackList()
   item->onClicked = [this](){ app->showPanel(archivedPanel, true);  populateArchived(); };
   tracksContent->addItem("-1", item);
   tracksContent->setOrder(order);
+  filterMapAreaTracks(tracksContent);
 }
 
 void MapsTracks::viewEntireTrack(GpxFile* track)
 {
-  if(!track->activeWay() || track->activeWay()->pts.empty()) return;
-  auto& locs = track->activeWay()->pts;
-  LngLat minLngLat(locs.front().lngLat()), maxLngLat(locs.front().lngLat());
-  for(size_t ii = 1; ii < locs.size(); ++ii) {
-    Location& loc = locs[ii].loc;
-    minLngLat.longitude = std::min(minLngLat.longitude, loc.lng);
-    minLngLat.latitude = std::min(minLngLat.latitude, loc.lat);
-    maxLngLat.longitude = std::max(maxLngLat.longitude, loc.lng);
-    maxLngLat.latitude = std::max(maxLngLat.latitude, loc.lat);
+  GpxWay* way = track->activeWay();
+  if(!way || way->size() == 0) return;
+  LngLat minLngLat(way->lngLat(0)), maxLngLat(way->lngLat(0));
+  for(size_t ii = 1; ii < way->size(); ++ii) {
+    LngLat r = way->lngLat(ii);
+    minLngLat.longitude = std::min(minLngLat.longitude, r.longitude);
+    minLngLat.latitude = std::min(minLngLat.latitude, r.latitude);
+    maxLngLat.longitude = std::max(maxLngLat.longitude, r.longitude);
+    maxLngLat.latitude = std::max(maxLngLat.latitude, r.latitude);
   }
   if(!app->map->lngLatToScreenPosition(minLngLat.longitude, minLngLat.latitude)
       || !app->map->lngLatToScreenPosition(maxLngLat.longitude, maxLngLat.latitude)) {
@@ -384,6 +561,8 @@ void MapsTracks::closeActiveTrack()
     if(item)
       item->selectFirst(".detail-text")->setText(activeTrack->desc.c_str());
   }
+  if(activeTrack != &recordedTrack)
+    activeTrack->compact();
   activeTrack = NULL;
   waypointsDirty = false; plotDirty = false;
 }
@@ -418,6 +597,7 @@ void MapsTracks::populateTrack(GpxFile* track)  //TrackView_t view)
   if(activeTrack != track) {
     closeActiveTrack();
     activeTrack = track;
+    track->expand();
     viewEntireTrack(track);
     if(!isRecTrack)
       activeTrack->marker->setProperties({{{"selected", 1}}});  //track->marker->setStylePath("layers.selected-track.draw.track");
@@ -513,63 +693,14 @@ void MapsTracks::updateStats(GpxFile* track)
   if(isRecording)
     totalTime += (mSecSinceEpoch() - lastTrackPtTime)/1000.0;
 
-  double movingTime = isTrack ? 0 : totalTime;
-  double trackDist = 0, trackAscent = 0, trackDescent = 0, ascentTime = 0, descentTime = 0;
-  double estSpeed = 0, maxSpeed = 0, currSlope = 0, movingTimeGps = 0, rawDist = 0, movingDist = 0;
-  size_t prevDistLoc = 0, prevVertLoc = 0;
-  if(!locs.empty()) locs.front().dist = 0;
-  for(size_t ii = 1; ii < locs.size(); ++ii) {
-    Location& loc = locs[ii].loc;
-    double dt = loc.time - locs[ii-1].loc.time;
-    double dist = 1000*lngLatDist(loc.lngLat(), locs[prevDistLoc].lngLat());  //prev.lngLat()
-    double disterr = loc.poserr + locs[prevDistLoc].loc.poserr;
-    double vert = loc.alt - locs[prevVertLoc].loc.alt;
-    double verterr = loc.alterr + locs[prevVertLoc].loc.alterr;
-
-    if(loc.spd > 0.1f)
-      movingTimeGps += dt;
-    //if(dist > minTrackDist || vert > minTrackDist) {  // dt < minTrackTime
-
-    rawDist += 1000*lngLatDist(loc.lngLat(), locs[ii-1].lngLat());
-    disterr = disterr > 0 ? disterr : 10;
-    if(!isTrack)
-      trackDist = rawDist;
-    else if(dist > disterr/2 || ii == locs.size() - 1) {  // be more generous with distance than vert
-      double tdist = loc.time - locs[prevDistLoc].loc.time;
-      trackDist += dist;
-      movingTime += std::min(10.0, tdist);
-
-      if(!track->hasSpeed) {
-        double a = std::exp(-dt*speedInvTau);
-        estSpeed = a*estSpeed + (1-a)*dist/tdist;
-      }
-      //double dd = dist/(ii - prevDistLoc);  -- this isn't really correct
-      //for(++prevDistLoc; prevDistLoc < ii; ++prevDistLoc)
-      //  locs[prevDistLoc].dist = locs[prevDistLoc-1].dist + dd;
-      prevDistLoc = ii;
-    }
-    locs[ii].dist = trackDist;  //if(!origLocs.empty())
-    if(!track->hasSpeed)
-      loc.spd = estSpeed;
-    maxSpeed = std::max(double(loc.spd), maxSpeed);
-
-    verterr = verterr > 0 ? verterr : 20;
-    if(std::abs(vert) > verterr) {
-      double vertdt = dt;  //loc.time - locs[prevVertLoc].loc.time;
-      for(size_t jj = prevVertLoc; jj < ii; ++jj) {
-        // idea here is to try to exclude flat sections
-        if(std::abs(loc.alt - locs[jj+1].loc.alt) <= verterr) {
-          vertdt = loc.time - locs[jj].loc.time;
-          break;
-        }
-      }
-      trackAscent += std::max(0.0, vert);
-      trackDescent += std::min(0.0, vert);
-      ascentTime += vert > 0 ? vertdt : 0;
-      descentTime += vert < 0 ? vertdt : 0;
-      prevVertLoc = ii;
-    }
-  }
+  static TrackStats nostats;
+  TrackStats& stats = track->activeWay() ? track->activeWay()->stats : nostats;
+  stats.update(locs, isTrack, track->hasSpeed, speedInvTau);
+  const TrackStats::State& st = stats.res;
+  double movingTime = isTrack ? st.movingTime : totalTime;
+  double trackDist = st.trackDist, trackAscent = st.trackAscent, trackDescent = st.trackDescent;
+  double ascentTime = st.ascentTime, descentTime = st.descentTime, maxSpeed = st.maxSpeed;
+  double movingTimeGps = st.movingTimeGps, rawDist = st.rawDist, currSlope = 0, movingDist = 0;
 
   //if(!locs.empty()) {
   //  for(size_t ii = locs.size() - 1; ii-- > 0;) {
@@ -637,7 +768,10 @@ void MapsTracks::updateStats(GpxFile* track)
   setStatsText(".track-max-speed", maxSpeed > 0 ? speedToStr(maxSpeed) : notime);
 
   trackSummary = (totalTime > 0 ? (timeStr + " | ") : "") + distStr;
-  trackSpark->setTrack(locs);
+  if(isRecording)
+    trackSpark->appendTrack(locs);
+  else
+    trackSpark->setTrack(locs);
   plotVsTimeBtn->setVisible(totalTime > 0);
 
   if(plotDirty && plotWidgets[0]->isVisible()) {
@@ -645,7 +779,10 @@ void MapsTracks::updateStats(GpxFile* track)
     // if zoomed and scrolled to end of plot, scroll to include possible new location points
     if(trackPlot->zoomScale > 1 && trackPlot->zoomOffset == trackPlot->minOffset)
       trackPlot->zoomOffset = -INFINITY;
-    trackPlot->setTrack(locs, track->waypoints);
+    if(isRecording)
+      trackPlot->appendTrack(locs, track->waypoints);
+    else
+      trackPlot->setTrack(locs, track->waypoints);
   }
 
   if(isRecording) {
@@ -986,6 +1123,19 @@ bool MapsTracks::tapEvent(LngLat location)
   return true;
 }
 
+// feature picking only finds track if tap is directly on line, so also check for nearby tracks; only called
+//  for taps which did not pick anything else
+bool MapsTracks::openNearestTrack(LngLat location)
+{
+  if(stealPickResult || replaceWaypt || (activeTrack && tapToAddWaypt))
+    return false;
+  double maxdist = MapProjection::metersPerPixelAtZoom(app->map->getZoom())*10/1000.0;  // meters to km
+  GpxFile* track = nearestTrack(location, maxdist);
+  if(!track) { return false; }
+  populateTrack(track);
+  return true;
+}
+
 void MapsTracks::fingerEvent(int action, LngLat pos)
 {
   if(!activeTrack) return;
@@ -1004,6 +1154,7 @@ void MapsTracks::fingerEvent(int action, LngLat pos)
     app->getElevation(pos, [this, rteidx, ptidx, track = activeTrack](double ele){
       if(activeTrack != track || track->routes.size() <= rteidx || track->routes[rteidx].pts.size() <= ptidx) return;
       track->routes[rteidx].pts[ptidx].loc.alt = ele;
+      track->routes[rteidx].stats.invalidate(ptidx);
       updateStats(activeTrack);
     });
   }
@@ -1096,14 +1247,10 @@ bool MapsTracks::onFeaturePicked(const Tangram::FeaturePickResult* result)
     if(activeTrack && activeTrack->marker && activeTrack->marker->featureId == id && trackPanel->isVisible() &&
         !trackSliders->editMode && plotWidgets[0]->isVisible() && !std::isnan(app->tapLocation.longitude)) {
       // find the track point closest to chosen position; must be within 10 pixels
-      double mindist = MapProjection::metersPerPixelAtZoom(app->map->getZoom())*10/1000.0;  // meters to km
-      const Waypoint* closestWpt = NULL;
-      for(const Waypoint& pt : activeTrack->activeWay()->pts) {
-        double dist = lngLatDist(pt.lngLat(), app->tapLocation);
-        if(dist > mindist) continue;
-        mindist = dist;
-        closestWpt = &pt;
-      }
+      double maxdist = MapProjection::metersPerPixelAtZoom(app->map->getZoom())*10/1000.0;  // meters to km
+      GpxWay* way = activeTrack->activeWay();
+      int idx = way->segIndex.nearest(*way, app->tapLocation, maxdist);
+      const Waypoint* closestWpt = idx >= 0 && size_t(idx) < way->pts.size() ? &way->pts[idx] : NULL;
       if(closestWpt) {
         trackSliders->trackSlider->setVisible(true);
         trackSliders->trackSlider->setValue(trackPlot->plotVsDist ? closestWpt->dist/trackPlot->maxDist
@@ -1124,6 +1271,10 @@ bool MapsTracks::onFeaturePicked(const Tangram::FeaturePickResult* result)
 void MapsTracks::onMapEvent(MapEvent_t event)
 {
   if(event == MAP_CHANGE) {
+    if(mapAreaTracks && archivedPanel->isVisible())
+      filterMapAreaTracks(archivedContent);
+    else if(mapAreaTracks && tracksPanel->isVisible())
+      filterMapAreaTracks(tracksContent);
     if(!activeTrack) return;
     // update polyline marker in direct mode
     if(directRoutePreview && activeTrack->routeMode == "direct" && !activeTrack->waypoints.empty()) {
@@ -1180,9 +1331,14 @@ void MapsTracks::onMapEvent(MapEvent_t event)
     }
     else {
       if(!activeTrack || !findPickedWaypoint(activeTrack)) {  // navRoute is not in tracks
-        for(GpxFile& track : tracks) {
-          if(!track.visible || &track == activeTrack) continue;
-          if(findPickedWaypoint(&track)) break;
+        // pickResultCoord is position of marker; allow some slack since it is obtained from screen position
+        LngLat pos = app->pickResultCoord;
+        double dlat = MapProjection::metersPerPixelAtZoom(app->map->getZoom())*10/111200.0;  // m per deg lat
+        double dlng = dlat/std::max(0.01, std::cos(pos.latitude*M_PI/180));
+        LngLat lngLat00(pos.longitude - dlng, pos.latitude - dlat), lngLat11(pos.longitude + dlng, pos.latitude + dlat);
+        for(GpxFile* track : findTracks(lngLat00, lngLat11)) {
+          if(!track->visible || track == activeTrack) continue;
+          if(findPickedWaypoint(track)) break;
           //if(track.marker->onPicked(app->pickedMarkerId)) {
           //  populateTrack(&track);
           //  break;
@@ -1388,6 +1544,8 @@ void MapsTracks::updateDB(GpxFile* track)
         .bind(track->title, track->style, relpath, track->rowid).exec();
   track->loaded = true;
   tracksDirty = true;
+  tracksIndexDirty = true;
+  MapsSearch::indexTrack(track);
 }
 
 void MapsTracks::loadTrackGPX(std::unique_ptr<PlatformFile> file)
@@ -1484,6 +1642,9 @@ void MapsTracks::setTrackEdit(bool show)
     app->map->markerSetVisible(trackEndMarker, false);
     if(!origLocs.empty()) {
       activeTrack->activeWay()->pts = std::move(origLocs);
+      activeTrack->activeWay()->stats.invalidate();
+      activeTrack->activeWay()->simplifier.invalidate();
+      activeTrack->activeWay()->segIndex.invalidate();
       updateTrackMarker(activeTrack);  // rebuild marker
       plotDirty = true;
       trackPlot->zoomScale = 1.0;
@@ -1512,6 +1673,7 @@ void MapsTracks::createEditDialog()
       // add entry for original track if making copy
       tracks.emplace_back(activeTrack->title, activeTrack->desc, activeTrack->filename,
           activeTrack->style, activeTrack->rowid, activeTrack->archived);
+      tracksIndexDirty = true;
     }
     activeTrack->title = title;
     activeTrack->style = colorToStr(editTrackColor->color());
@@ -1727,6 +1889,9 @@ void MapsTracks::createPlotContent()
     newlocs.insert(newlocs.end(), locs.begin() + startidx, locs.begin() + endidx);
     newlocs.push_back(endloc);
     locs.swap(newlocs);
+    activeTrack->activeWay()->stats.invalidate();
+    activeTrack->activeWay()->simplifier.invalidate();
+    activeTrack->activeWay()->segIndex.invalidate();
     plotDirty = true;
     trackPlot->zoomScale = 1.0;
     cropStart = 0;  cropEnd = 1;
@@ -1752,6 +1917,9 @@ void MapsTracks::createPlotContent()
       newlocs.insert(newlocs.end(), locs.begin() + endidx, locs.end());
     }
     locs.swap(newlocs);
+    activeTrack->activeWay()->stats.invalidate(std::min(cropStart, cropEnd) > 0 ? startidx : 0);
+    activeTrack->activeWay()->simplifier.invalidate();
+    activeTrack->activeWay()->segIndex.invalidate();
     plotDirty = true;
     trackPlot->zoomScale = 1.0;
     cropStart = 0; cropEnd = 1;
@@ -1775,7 +1943,11 @@ void MapsTracks::createPlotContent()
         if(!way) return;
         if(origLocs.empty()) origLocs = activeTrack->activeWay()->pts;
         auto& locs = activeTrack->activeWay()->pts;
+        bool compacted = way->pts.empty();
+        way->expand();
         locs.insert(locs.end(), way->pts.begin(), way->pts.end());
+        activeTrack->activeWay()->simplifier.invalidate();
+        if(compacted) way->compact();
         updateTrackMarker(activeTrack);  // rebuild marker
         plotDirty = true;
         trackPlot->zoomScale = 1.0;
@@ -1800,6 +1972,9 @@ void MapsTracks::createPlotContent()
     if(origLocs.empty()) origLocs = activeTrack->activeWay()->pts;
     auto& locs = activeTrack->activeWay()->pts;
     std::reverse(locs.begin(), locs.end());
+    activeTrack->activeWay()->stats.invalidate();
+    activeTrack->activeWay()->simplifier.invalidate();
+    activeTrack->activeWay()->segIndex.invalidate();
     updateTrackMarker(activeTrack);  // rebuild marker
     plotDirty = true;
     trackPlot->zoomScale = 1.0;
@@ -1827,6 +2002,7 @@ void MapsTracks::createPlotContent()
         }
         if(!std::isnan(ele)) { way->pts[ptidx].loc.alt = ele; }
         if(--nElevPending == 0) {
+          way->stats.invalidate();
           plotDirty = true;
           trackPlot->zoomScale = 1.0;
           updateStats(activeTrack);
@@ -2087,6 +2263,7 @@ void MapsTracks::createTrackPanel()
     recordedTrack = GpxFile();
     recordTrack = false;
     tracksDirty = true;
+    tracksIndexDirty = true;
     pauseRecordBtn->setChecked(false);
     tracksBtn->setIcon(MapsApp::uiIcon("track"));
     recordTrackBtn->setChecked(false);
@@ -2219,23 +2396,52 @@ void MapsTracks::createTrackListPanel()
       startRecording();
   };
 
+  // map area filter is shared by main and archived track lists
+  Button* mapAreaTracksBtn = createToolbutton(MapsApp::uiIcon("fold-map-pin"), "Tracks in map area only");
+  Button* mapAreaArchivedBtn = createToolbutton(MapsApp::uiIcon("fold-map-pin"), "Tracks in map area only");
+  auto toggleMapAreaTracks = [=](){
+    mapAreaTracks = !mapAreaTracks;
+    mapAreaTracksBtn->setChecked(mapAreaTracks);
+    mapAreaArchivedBtn->setChecked(mapAreaTracks);
+    filterMapAreaTracks(archivedPanel->isVisible() ? archivedContent : tracksContent);
+  };
+  mapAreaTracksBtn->onClicked = toggleMapAreaTracks;
+  mapAreaArchivedBtn->onClicked = toggleMapAreaTracks;
+
   tracksContent = new DragDropList;  //createColumn();
   auto tracksTb = app->createPanelHeader(MapsApp::uiIcon("folder"), "Tracks");
   tracksTb->addWidget(recordTrackBtn);
   tracksTb->addWidget(drawTrackBtn);
   tracksTb->addWidget(loadTrackBtn);
+  tracksTb->addWidget(mapAreaTracksBtn);
   tracksPanel = app->createMapPanel(tracksTb, NULL, tracksContent, false);
 
   tracksPanel->addHandler([=](SvgGui* gui, SDL_Event* event) {
     if(event->type == SvgGui::VISIBLE) {
       if(tracksDirty)
         populateTrackList();
+      else
+        filterMapAreaTracks(tracksContent);  // map may have moved while panel was hidden
     }
     return false;
   });
 
   archivedContent = createColumn();
   auto archivedHeader = app->createPanelHeader(MapsApp::uiIcon("archive"), "Archived Tracks");
+  static const char* archivedSortKeys[] = {"name", "date", "dist"};
+  std::string initSort = app->config["tracks"]["archived_sort"].as<std::string>("date");
+  size_t initSortIdx = 0;
+  while(initSortIdx < 3 && initSort != archivedSortKeys[initSortIdx]) ++initSortIdx;
+  Menu* sortMenu = createRadioMenu({"Name", "Date", "Distance"}, [this](size_t ii){
+    app->config["tracks"]["archived_sort"] = archivedSortKeys[ii];
+    archiveDirty = true;
+    populateArchived();
+  }, initSortIdx);
+  Button* sortBtn = createToolbutton(MapsApp::uiIcon("sort"), "Sort");
+  sortBtn->setMenu(sortMenu);
+
+  archivedHeader->addWidget(sortBtn);
+  archivedHeader->addWidget(mapAreaArchivedBtn);
   archivedPanel = app->createMapPanel(archivedHeader, archivedContent, NULL, false);
 }
 
@@ -2243,10 +2449,16 @@ Button* MapsTracks::createPanel()
 {
   DB_exec(app->bkmkDB, "CREATE TABLE IF NOT EXISTS tracks(title TEXT, filename TEXT, style TEXT,"
       " notes TEXT, timestamp INTEGER DEFAULT (CAST(strftime('%s') AS INTEGER)), archived INTEGER DEFAULT 0);");
+  DB_exec(app->bkmkDB, "CREATE TABLE IF NOT EXISTS track_summary(track_id INTEGER PRIMARY KEY,"
+      " gpx_mtime INTEGER, gpx_size INTEGER, npts INTEGER, dist REAL, duration REAL, ascent REAL, descent REAL,"
+      " start_time REAL, min_lng REAL, min_lat REAL, max_lng REAL, max_lat REAL);");
+  DB_exec(app->bkmkDB, "CREATE TRIGGER IF NOT EXISTS track_summary_delete AFTER DELETE ON tracks BEGIN"
+      " DELETE FROM track_summary WHERE track_id = OLD.rowid; END;");
 
   minTrackDist = app->config["tracks"]["min_distance"].as<double>(0.5);
   minTrackTime = app->config["tracks"]["min_time"].as<double>(5);
   gpsSamplePeriod = app->config["tracks"]["sample_period"].as<float>(0.1f);
+  TrackMarker::defaultSimplifyZoom = app->config["tracks"]["simplify_zoom"].as<int>(18);
 
   createTrackListPanel();
   createTrackPanel();
@@ -2303,7 +2515,7 @@ Button* MapsTracks::createPanel()
     auto it = std::find_if(tracks.begin(), tracks.end(), [&](const GpxFile& t){ return t.rowid == recid; });
     if(it == tracks.end())
       app->config["tracks"].remove("recording");
-    else if(it->tracks.empty() || it->tracks.front().pts.empty()) {
+    else if(it->tracks.empty() || it->tracks.front().size() == 0) {
       app->config["tracks"].remove("recording");
       // have to wait until window created
       MapsApp::messageBox("Restore track",
@@ -2312,6 +2524,7 @@ Button* MapsTracks::createPanel()
     else {
       recordedTrack = std::move(*it);
       tracks.erase(it);
+      tracksIndexDirty = true;
       setTrackVisible(&recordedTrack, true);  // load GPX and show
       recordedTrack.modified = true;  // ensure save if recording resumed
       recordTrackBtn->setChecked(true);
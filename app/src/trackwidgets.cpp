@@ -5,6 +5,8 @@
 
 static constexpr int LEFT_MARGIN = 15;
 
+// TrackPlot
+
 TrackPlot::TrackPlot()  // : CustomWidget()
 {
   addHandler([this](SvgGui* gui, SDL_Event* event){
@@ -89,40 +91,60 @@ real TrackPlot::trackPosToPlotPos(real s) const
 
 void TrackPlot::setTrack(const std::vector<Waypoint>& locs, const std::vector<Waypoint>& wpts)
 {
-  double prevTrackDist = maxDist, prevTrackTime = maxTime - minTime;
-  minAlt = 0;  maxAlt = 0;  minSpd = 0;  maxSpd = 0;
-  minTime = 0;  maxTime = 10;  maxDist = 100;
   altDistPlot.clear();
   altTimePlot.clear();
   spdDistPlot.clear();
   spdTimePlot.clear();
+  nTrackPts = 0;
+  nDistPts = 0;
+  appendTrack(locs, wpts);
+}
+
+void TrackPlot::appendTrack(const std::vector<Waypoint>& locs, const std::vector<Waypoint>& wpts)
+{
+  if(locs.size() < nTrackPts || (nTrackPts > 0 && !(locs.front().lngLat() == trackStart))) {
+    setTrack(locs, wpts);
+    return;
+  }
+  double prevTrackDist = maxDist, prevTrackTime = maxTime - minTime;
+  minAlt = 0;  maxAlt = 0;  minSpd = 0;  maxSpd = 0;
+  minTime = 0;  maxTime = 10;  maxDist = 100;
   if(locs.empty()) return;
-  minAlt = FLT_MAX;  maxAlt = -FLT_MAX;  minSpd = FLT_MAX;  maxSpd = -FLT_MAX;
   minTime = locs.front().loc.time;
   maxTime = std::max(minTime + 10, locs.back().loc.time);
   maxDist = std::max(locs.back().dist, 100.0);
   // keep slider handle in same position for recorded track; handle hidden when changing track, so no
   //  harm in updating position
   sliders->trackSlider->sliderPos *= plotVsDist ? prevTrackDist/maxDist : prevTrackTime/(maxTime - minTime);
-  altDistPlot.addPoint(-1E6, -1000);  //locs.front().dist
-  altTimePlot.addPoint(-1E6, -1000);  //locs.front().loc.time
-  double prevDist = -1;
-  for(auto& wpt : locs) {
+  // dist and spd of last point can change when points are added (see TrackStats), so replace it
+  size_t istart = 0;
+  if(nTrackPts > 0) {
+    istart = nTrackPts - 1;
+    altTimePlot.truncate(istart);
+    spdTimePlot.truncate(istart);
+    altDistPlot.truncate(nDistPts);
+    spdDistPlot.truncate(nDistPts);
+  }
+  double prevDist = istart > 0 ? locs[istart-1].dist : -1;
+  for(size_t ii = istart; ii < locs.size(); ++ii) {
+    const Waypoint& wpt = locs[ii];
     const Location& tpt = wpt.loc;
+    if(ii + 1 == locs.size())
+      nDistPts = altDistPlot.size();
     double alt = MapsApp::metricUnits ? tpt.alt : tpt.alt*3.28084;
-    if(wpt.dist > prevDist) altDistPlot.addPoint(Point(wpt.dist, alt));
-    altTimePlot.addPoint(Point(tpt.time - minTime, alt));
-    minAlt = std::min(minAlt, alt);
-    maxAlt = std::max(maxAlt, alt);
+    if(wpt.dist > prevDist) altDistPlot.addPoint(wpt.dist, alt);
+    altTimePlot.addPoint(tpt.time - minTime, alt);
     double spd = MapsApp::metricUnits ? tpt.spd*3600*0.001 : tpt.spd*3600*0.000621371;
-    if(wpt.dist > prevDist) spdDistPlot.addPoint(Point(wpt.dist, spd));
-    spdTimePlot.addPoint(Point(tpt.time - minTime, spd));
-    minSpd = std::min(minSpd, spd);
-    maxSpd = std::max(maxSpd, spd);
+    if(wpt.dist > prevDist) spdDistPlot.addPoint(wpt.dist, spd);
+    spdTimePlot.addPoint(tpt.time - minTime, spd);
     prevDist = wpt.dist;
   }
-  altDistPlot.addPoint(1E6, -1000);  //locs.back().dist, -1000);
-  altTimePlot.addPoint(1E6, -1000);  //locs.back().loc.time - minTime, -1000);
+  for(PlotSeries* series : {&altDistPlot, &altTimePlot, &spdDistPlot, &spdTimePlot})
+    series->update();
+  nTrackPts = locs.size();
+  trackStart = locs.front().lngLat();
+  altTimePlot.yRange(minAlt, maxAlt);
+  spdTimePlot.yRange(minSpd, maxSpd);
   if(maxTime - minTime <= 0)
     plotVsDist = true;
 
@@ -159,19 +181,15 @@ void TrackPlot::setTrack(const std::vector<Waypoint>& locs, const std::vector<Wa
 //  return std::ceil(x0/quant)*quant;
 //}
 
-static void sparseDrawPath(Painter* p, const Path2D& path)
+// draw x range x0 to x1 of series; if fill is true, path is closed below plot area so it can be filled
+static void drawSeries(Painter* p, const PlotSeries& series, real x0, real x1, bool fill)
 {
   real xscale = p->getTransform().xscale();  // note that this includes paint scale
-  int previdx = 0;
-  p->beginPath();
-  nvgMoveTo(p->vg, path.point(0).x, path.point(0).y);
-  for(int ii = 1; ii < path.size(); ++ii) {
-    if((path.point(ii).x - path.point(previdx).x)*xscale > 0.5) {
-      nvgLineTo(p->vg, path.point(ii).x, path.point(ii).y);
-      previdx = ii;
-    }
-  }
-  p->endPath();
+  Path2D path;
+  if(fill) path.addPoint(-1E6, -1000);
+  series.getPath(path, x0, x1, (x1 - x0)*xscale);
+  if(fill) path.addPoint(1E6, -1000);
+  p->drawPath(path);
 }
 
 // should we highlight zoomed region of track on map?
@@ -275,14 +293,15 @@ void TrackPlot::draw(SvgPainter* svgp) const
   p->scale(plotVsDist ? plotw/maxDist : plotw/(maxTime - minTime), 1);
   p->scale(zoomScale, 1);
   p->translate(zoomOffset, 0);
+  real plotx0 = -zoomOffset;
+  real plotx1 = plotx0 + (plotVsDist ? maxDist : maxTime - minTime)/zoomScale;
   if(plotAlt && !altDistPlot.empty()) {
     p->save();
     p->scale(1, -ploth/(maxAlt - minAlt));
     p->translate(0, -maxAlt);
     p->setFillBrush(Color(altiColor).setAlpha(128));
     p->setStroke(altiColor, 2.0);  //Color::NONE);
-    //p->drawPath(plotVsDist ? altDistPlot : altTimePlot);
-    sparseDrawPath(p, plotVsDist ? altDistPlot : altTimePlot);
+    drawSeries(p, plotVsDist ? altDistPlot : altTimePlot, plotx0, plotx1, true);
     p->restore();
   }
   if(plotSpd && maxSpd > 0) {
@@ -290,8 +309,7 @@ void TrackPlot::draw(SvgPainter* svgp) const
     p->translate(0, -maxSpd);
     p->setFillBrush(Brush::NONE);
     p->setStroke(spdColor, 2.0);
-    //p->drawPath(plotVsDist ? spdDistPlot : spdTimePlot);
-    sparseDrawPath(p, plotVsDist ? spdDistPlot : spdTimePlot);
+    drawSeries(p, plotVsDist ? spdDistPlot : spdTimePlot, plotx0, plotx1, false);
   }
   p->restore();
 
@@ -390,18 +408,27 @@ void TrackPlot::draw(SvgPainter* svgp) const
 void TrackSparkline::setTrack(const std::vector<Waypoint>& locs)
 {
   altDistPlot.clear();
+  appendTrack(locs);
+}
+
+void TrackSparkline::appendTrack(const std::vector<Waypoint>& locs)
+{
+  size_t npts = altDistPlot.size();
+  if(locs.size() < npts || (npts > 0 && !(locs.front().lngLat() == trackStart))) {
+    setTrack(locs);
+    return;
+  }
   minAlt = 0; maxAlt = 0;
   if(locs.empty()) return;
-  minAlt = FLT_MAX; maxAlt = -FLT_MAX;
   maxDist = locs.back().dist;
-  altDistPlot.addPoint(locs.front().dist, -1000);
-  for(auto& wpt : locs) {
-    const Location& tpt = wpt.loc;
-    altDistPlot.addPoint(Point(wpt.dist, tpt.alt));
-    minAlt = std::min(minAlt, tpt.alt);
-    maxAlt = std::max(maxAlt, tpt.alt);
-  }
-  altDistPlot.addPoint(locs.back().dist, -1000);
+  // dist of last point can change when points are added, so replace it
+  size_t istart = npts > 0 ? npts - 1 : 0;
+  altDistPlot.truncate(istart);
+  for(size_t ii = istart; ii < locs.size(); ++ii)
+    altDistPlot.addPoint(locs[ii].dist, locs[ii].loc.alt);
+  altDistPlot.update();
+  trackStart = locs.front().lngLat();
+  altDistPlot.yRange(minAlt, maxAlt);
 }
 
 void TrackSparkline::draw(SvgPainter* svgp) const
@@ -428,7 +455,11 @@ void TrackSparkline::draw(SvgPainter* svgp) const
   p->translate(0, -(maxAlt + 0.05*elev));  // + minAlt);
   p->setFillBrush(plotColor);
   p->setStroke(Color::NONE);
-  p->drawPath(altDistPlot);
+  Path2D path;
+  path.addPoint(0, -1000);
+  altDistPlot.getPath(path, 0, maxDist, maxDist*p->getTransform().xscale());
+  path.addPoint(maxDist, -1000);
+  p->drawPath(path);
   p->restore();
 
   // vertical scale
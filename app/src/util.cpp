@@ -3,6 +3,7 @@
 #include "scene/scene.h"
 #include "sqlite3/sqlite3.h"
 #include "usvg/svgwriter.h"
+#include <unordered_map>
 
 
 template<typename T>
@@ -36,10 +37,57 @@ TileID lngLatTile(LngLat ll, int z)
   return TileID(x, y, z);
 }
 
+// Tile ids are Morton (Z-order) codes, like quadkeys: x and y bits are interleaved and left aligned to
+//  MAX_TILE_ID_ZOOM so that a tile and all its descendants have contiguous ids and nearby tiles are nearby
+//  in index order; zoom goes in the low bits to distinguish a tile from its first child
+static constexpr int MAX_TILE_ID_ZOOM = 24;
+static constexpr int TILE_ID_ZOOM_BITS = 5;
+static constexpr int64_t TILE_ID_MORTON = int64_t(1) << 56;  // flag to distinguish from legacy z<<48|x<<24|y ids
+
+// spread lower 32 bits of v to even bits of result
+static uint64_t spreadBits(uint64_t v)
+{
+  v &= 0xFFFFFFFF;
+  v = (v | (v << 16)) & 0x0000FFFF0000FFFF;
+  v = (v | (v << 8)) & 0x00FF00FF00FF00FF;
+  v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0F;
+  v = (v | (v << 2)) & 0x3333333333333333;
+  v = (v | (v << 1)) & 0x5555555555555555;
+  return v;
+}
+
+static uint32_t compactBits(uint64_t v)
+{
+  v &= 0x5555555555555555;
+  v = (v | (v >> 1)) & 0x3333333333333333;
+  v = (v | (v >> 2)) & 0x0F0F0F0F0F0F0F0F;
+  v = (v | (v >> 4)) & 0x00FF00FF00FF00FF;
+  v = (v | (v >> 8)) & 0x0000FFFF0000FFFF;
+  v = (v | (v >> 16)) & 0x00000000FFFFFFFF;
+  return uint32_t(v);
+}
+
 int64_t packTileId(const TileID& tile)
 {
-  // we could interleave bits of x and y to get something like quadkey (but note we still need to include z)
-  return int64_t(tile.z) << 48 | int64_t(tile.x) << 24 | int64_t(tile.y);
+  uint64_t morton = (spreadBits(tile.x) << 1 | spreadBits(tile.y)) << 2*(MAX_TILE_ID_ZOOM - tile.z);
+  return TILE_ID_MORTON | int64_t(morton << TILE_ID_ZOOM_BITS) | tile.z;
+}
+
+TileID unpackTileId(int64_t id)
+{
+  if(!(id & TILE_ID_MORTON))  // legacy id
+    return TileID(int(id >> 24 & 0xFFFFFF), int(id & 0xFFFFFF), int(id >> 48));
+  int z = int(id & ((1 << TILE_ID_ZOOM_BITS) - 1));
+  uint64_t morton = uint64_t(id & ~TILE_ID_MORTON) >> TILE_ID_ZOOM_BITS >> 2*(MAX_TILE_ID_ZOOM - z);
+  return TileID(compactBits(morton >> 1), compactBits(morton), z);
+}
+
+// ids of tile and all its descendants are in [lo, hi)
+void tileIdRange(const TileID& tile, int64_t& lo, int64_t& hi)
+{
+  int64_t span = int64_t(1) << (2*(MAX_TILE_ID_ZOOM - tile.z) + TILE_ID_ZOOM_BITS);
+  lo = packTileId(tile) & ~(span - 1);
+  hi = lo + span;
 }
 
 static double parseCoord(const char* s, char** endptr)
@@ -174,11 +222,19 @@ std::string osmIdFromJson(const YAML::Node& props)
   return {};
 }
 
-YAML::Node strToJson(const char* json) { return YAML::parse(json, 0, YAML::PARSE_JSON); }
-YAML::Node strToJson(const std::string& json) { return YAML::parse(json, YAML::PARSE_JSON); }
+// strToJson and jsonToProps also accept props blobs (see below) so callers don't need to care about format
+YAML::Node strToJson(const char* json)
+{
+  if(isPropsBlob(json)) { return YAML::parse(propsBlobToJson(json), YAML::PARSE_JSON); }
+  return YAML::parse(json, 0, YAML::PARSE_JSON);
+}
+YAML::Node strToJson(const std::string& json) { return strToJson(json.c_str()); }
 
-Tangram::Properties jsonToProps(const char* json) { return jsonToProps(strToJson(json)); }
-Tangram::Properties jsonToProps(const std::string& json) { return jsonToProps(strToJson(json.c_str())); }
+Tangram::Properties jsonToProps(const char* json)
+{
+  return isPropsBlob(json) ? propsBlobToProps(json) : jsonToProps(strToJson(json));
+}
+Tangram::Properties jsonToProps(const std::string& json) { return jsonToProps(json.c_str()); }
 
 Properties jsonToProps(const YAML::Node& tags)
 {
@@ -193,6 +249,217 @@ Properties jsonToProps(const YAML::Node& tags)
   return props;
 }
 
+// Compact encoding of flat Properties used for pois.props and bookmarks.props in place of JSON
+// - header "\x01\x01" (format, version), then for each item: key, type, value
+// - key is a single byte index (+1) into propsBlobKeys or PROPS_BLOB_KEY followed by key string
+// - value type is 's' (string), 'i' (zigzag int), or 'd' (double bits); numbers are stored as base-64
+//  digits in 0x80 - 0xBF (LSB first); all strings and numbers are terminated by 0xFF
+// - blob never contains '\0' (and 0xFF never appears in UTF-8) so it can be stored and passed around as a C
+//  string, e.g. with sqlite3_column_text(); decoding stops at end of string
+// propsBlobKeys can only be appended to, since existing blobs reference keys by index!
+static const char* propsBlobKeys[] = { "name", "name_en", "class", "subclass", "osm_id", "osm_type",
+  "amenity", "shop", "tourism", "leisure", "historic", "natural", "sport", "cuisine", "religion", "brand",
+  "operator", "ref", "place", "population", "rank", "ele", "altitude", "wiki", "wikipedia", "wikidata",
+  "website", "phone", "email", "opening_hours", "addr:housenumber", "addr:street", "addr:city",
+  "addr:postcode", "addr:country", "building", "level", "access", "highway", "railway", "aeroway",
+  "office", "craft", "healthcare", "information", "description", "note", "network", "capital", "iata" };
+static constexpr size_t NUM_PROPS_BLOB_KEYS = sizeof(propsBlobKeys)/sizeof(propsBlobKeys[0]);
+static constexpr unsigned char PROPS_BLOB_KEY = 0x7F;  // key string follows
+static constexpr unsigned char PROPS_BLOB_END = 0xFF;
+
+static int propsBlobKeyIdx(const char* key)
+{
+  static const std::unordered_map<std::string, int> keyIdx = [](){
+    std::unordered_map<std::string, int> res;
+    for(size_t ii = 0; ii < NUM_PROPS_BLOB_KEYS; ++ii)
+      res.emplace(propsBlobKeys[ii], int(ii));
+    return res;
+  }();
+  auto it = keyIdx.find(key);
+  return it != keyIdx.end() ? it->second : -1;
+}
+
+static void putBlobDigits(std::string& out, uint64_t x)
+{
+  do { out.push_back(char(0x80 | (x & 0x3F))); x >>= 6; } while(x);
+  out.push_back(char(PROPS_BLOB_END));
+}
+
+static uint64_t getBlobDigits(const char*& p)
+{
+  uint64_t x = 0;
+  for(int shift = 0; (unsigned char)(*p) >= 0x80 && (unsigned char)(*p) < 0xC0; shift += 6, ++p)
+    x |= uint64_t(*p & 0x3F) << shift;
+  if((unsigned char)(*p) == PROPS_BLOB_END) { ++p; }
+  return x;
+}
+
+static bool putBlobStr(std::string& out, const std::string& s)
+{
+  if(s.find(char(PROPS_BLOB_END)) != std::string::npos || s.find('\0') != std::string::npos) { return false; }
+  out.append(s).push_back(char(PROPS_BLOB_END));
+  return true;
+}
+
+static bool putBlobItem(std::string& out, const std::string& key, const Tangram::Value& val)
+{
+  int idx = propsBlobKeyIdx(key.c_str());
+  if(idx >= 0)
+    out.push_back(char(idx + 1));
+  else {
+    out.push_back(char(PROPS_BLOB_KEY));
+    if(!putBlobStr(out, key)) { return false; }
+  }
+  if(val.is<std::string>()) {
+    out.push_back('s');
+    return putBlobStr(out, val.get<std::string>());
+  }
+  double d = val.is<double>() ? val.get<double>() : 0;
+  if(d == std::floor(d) && std::abs(d) < 9007199254740992.0) {  // 2^53
+    int64_t n = int64_t(d);
+    out.push_back('i');
+    putBlobDigits(out, (uint64_t(n) << 1) ^ uint64_t(n >> 63));
+  }
+  else {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    out.push_back('d');
+    putBlobDigits(out, bits);
+  }
+  return true;
+}
+
+bool isPropsBlob(const char* s) { return s && s[0] == '\x01' && s[1] == '\x01'; }
+
+// returns JSON if props cannot be encoded (e.g. string containing 0xFF)
+std::string propsToBlob(const Properties& props)
+{
+  std::string out("\x01\x01");
+  out.reserve(128);
+  for(auto& item : props.items()) {
+    if(!putBlobItem(out, item.key, item.value))
+      return props.toJson();
+  }
+  return out;
+}
+
+// returns input unchanged if already a blob or not a flat JSON object (e.g. bookmark place_info array)
+std::string jsonToPropsBlob(const std::string& json)
+{
+  if(json.empty() || isPropsBlob(json.c_str())) { return json; }
+  YAML::Node node = strToJson(json.c_str());
+  if(!node.IsMap()) { return json; }
+  std::string out("\x01\x01");
+  for(auto m : node.pairs()) {
+    if(m.second.isNumber()) {
+      if(!putBlobItem(out, m.first.getString(), Tangram::Value(m.second.getNumber()))) { return json; }
+    }
+    else if(m.second.isString()) {
+      if(!putBlobItem(out, m.first.getString(), Tangram::Value(m.second.getString()))) { return json; }
+    }
+    else
+      return json;
+  }
+  return out;
+}
+
+bool PropsView::next()
+{
+  if(!p || !*p) { return false; }
+  unsigned char k = *p++;
+  if(k == PROPS_BLOB_KEY) {
+    key = p;
+    while(*p && (unsigned char)(*p) != PROPS_BLOB_END) { ++p; }
+    keyLen = p - key;
+    if(*p) { ++p; }
+  }
+  else if(k > 0 && k <= NUM_PROPS_BLOB_KEYS) {
+    key = propsBlobKeys[k-1];
+    keyLen = strlen(key);
+  }
+  else { p = NULL; return false; }  // corrupt blob or unknown key from newer version
+  type = *p ? *p++ : 0;
+  if(type == 's') {
+    str = p;
+    while(*p && (unsigned char)(*p) != PROPS_BLOB_END) { ++p; }
+    strLen = p - str;
+    if(*p) { ++p; }
+  }
+  else if(type == 'i') {
+    uint64_t z = getBlobDigits(p);
+    num = double(int64_t(z >> 1) ^ -int64_t(z & 1));
+  }
+  else if(type == 'd') {
+    uint64_t bits = getBlobDigits(p);
+    memcpy(&num, &bits, sizeof(num));
+  }
+  else { p = NULL; return false; }
+  return true;
+}
+
+bool PropsView::find(const char* k)
+{
+  rewind();
+  size_t klen = strlen(k);
+  while(next()) {
+    if(keyLen == klen && strncmp(key, k, klen) == 0)
+      return true;
+  }
+  return false;
+}
+
+Properties propsBlobToProps(const char* blob)
+{
+  Properties props;
+  PropsView view(blob);
+  while(view.next()) {
+    if(view.isString())
+      props.set(view.keyStr(), view.strValue());
+    else
+      props.set(view.keyStr(), view.num);
+  }
+  return props;
+}
+
+static void jsonEscapeAppend(std::string& out, const char* s, size_t n)
+{
+  out.push_back('"');
+  for(size_t ii = 0; ii < n; ++ii) {
+    char c = s[ii];
+    if(c == '"' || c == '\\') { out.push_back('\\'); out.push_back(c); }
+    else if(c == '\n') { out.append("\\n"); }
+    else if(c == '\r') { out.append("\\r"); }
+    else if(c == '\t') { out.append("\\t"); }
+    else if((unsigned char)c < 0x20) { out.append(fstring("\\u%04x", c)); }
+    else { out.push_back(c); }
+  }
+  out.push_back('"');
+}
+
+std::string propsBlobToJson(const char* blob)
+{
+  std::string out("{");
+  PropsView view(blob);
+  while(view.next()) {
+    if(out.size() > 1) { out.push_back(','); }
+    jsonEscapeAppend(out, view.key, view.keyLen);
+    out.push_back(':');
+    if(view.isString())
+      jsonEscapeAppend(out, view.str, view.strLen);
+    else if(view.type == 'i')
+      out.append(std::to_string(int64_t(view.num)));
+    else
+      out.append(std::isfinite(view.num) ? fstring("%.17g", view.num) : "null");
+  }
+  out.push_back('}');
+  return out;
+}
+
+std::string propsJsonView(const std::string& propstr)
+{
+  return isPropsBlob(propstr.c_str()) ? propsBlobToJson(propstr.c_str()) : propstr;
+}
+
 std::string ftimestr(const char* fmt, int64_t msec_epoch)
 {
   char timestr[64];
@@ -233,11 +500,23 @@ void udf_osmSearchRank(sqlite3_context* context, int argc, sqlite3_value** argv)
   double rank = /*sortByDist ? -1.0 :*/ sqlite3_value_double(argv[0]);
   double lon = sqlite3_value_double(argv[1]);
   double lat = sqlite3_value_double(argv[2]);
-  double dist = lngLatDist(searchRankOrigin, LngLat(lon, lat));  // in kilometers
+  // origin is per-connection (passed as user data) if provided, so searches on other threads don't race
+  auto origin = static_cast<const LngLat*>(sqlite3_user_data(context));
+  double dist = lngLatDist(origin ? *origin : searchRankOrigin, LngLat(lon, lat));  // in kilometers
   // obviously will want a more sophisticated ranking calculation in the future
   sqlite3_result_double(context, rank/log2(1+dist));
 }
 
+// convert legacy tile ids to Morton ids; Morton ids are passed through
+void udf_mortonTileId(sqlite3_context* context, int argc, sqlite3_value** argv)
+{
+  if(argc != 1 || sqlite3_value_type(argv[0]) != SQLITE_INTEGER) {
+    sqlite3_result_error(context, "mortonTileId - integer argument required.", -1);
+    return;
+  }
+  sqlite3_result_int64(context, packTileId(unpackTileId(sqlite3_value_int64(argv[0]))));
+}
+
 // MarkerGroup
 // - we may alter this to use ClientDataSource (at least for alt markers)
 
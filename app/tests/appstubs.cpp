@@ -0,0 +1,5 @@
+#include "mapsapp.h"
+
+// statics from mapsapp.cpp referenced by gpxfile.cpp; tests must not use TrackMarker or other code needing app
+MapsApp* MapsApp::inst = NULL;
+std::string MapsApp::baseDir;
@@ -0,0 +1,164 @@
+#include "catch.hpp"
+#include "gpxfile.h"
+#include <random>
+#include <string>
+#include <cmath>
+#include <ctime>
+
+// parseGpxTime and formatGpxTime must agree w/ libc timegm and strftime (UTC) and reject malformed input
+
+static std::string strftimeUTC(time_t t)
+{
+  char buf[64];
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+  return buf;
+}
+
+TEST_CASE("GPX time round-trip vs timegm and strftime", "[GpxTime]")
+{
+  std::mt19937 rng(45);
+  // 1900 - 2200, including negative times
+  std::uniform_int_distribution<int64_t> dist(-2208988800LL, 7258118400LL);
+  char buf[32];
+  for(int ii = 0; ii < 20000; ++ii) {
+    time_t t = time_t(dist(rng));
+    std::string ref = strftimeUTC(t);
+    REQUIRE(std::string(formatGpxTime(buf, double(t))) == ref);
+    REQUIRE(parseGpxTime(ref.c_str()) == double(t));
+
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    REQUIRE(timegm(&tm) == t);
+  }
+  // day boundaries, leap days, and epoch
+  const char* fixed[] = { "1970-01-01T00:00:00Z", "2000-02-29T23:59:59Z", "2100-03-01T00:00:00Z",
+      "1969-12-31T23:59:59Z", "2024-12-31T12:00:00Z" };
+  for(const char* s : fixed) {
+    struct tm tm = {};
+    REQUIRE(strptime(s, "%Y-%m-%dT%H:%M:%SZ", &tm) != NULL);
+    REQUIRE(parseGpxTime(s) == double(timegm(&tm)));
+    REQUIRE(std::string(formatGpxTime(buf, parseGpxTime(s))) == s);
+  }
+}
+
+TEST_CASE("GPX time fractional seconds", "[GpxTime]")
+{
+  char buf[32];
+  double t0 = parseGpxTime("2023-03-31T20:19:15Z");
+  REQUIRE(t0 == 1680293955.0);
+  REQUIRE(parseGpxTime("2023-03-31T20:19:15.250Z") == Approx(t0 + 0.25).epsilon(1E-12));
+  REQUIRE(parseGpxTime("2023-03-31T20:19:15,5Z") == Approx(t0 + 0.5).epsilon(1E-12));
+  REQUIRE(parseGpxTime("2023-03-31T20:19:15.123456789Z") == Approx(t0 + 0.123456789).epsilon(1E-12));
+  REQUIRE(parseGpxTime("2023-03-31T20:19:15.Z") == t0);
+
+  REQUIRE(std::string(formatGpxTime(buf, t0 + 0.25)) == "2023-03-31T20:19:15.250Z");
+  REQUIRE(std::string(formatGpxTime(buf, t0 + 0.0004)) == "2023-03-31T20:19:15Z");
+  REQUIRE(std::string(formatGpxTime(buf, t0 + 0.9996)) == "2023-03-31T20:19:16Z");
+  REQUIRE(std::string(formatGpxTime(buf, -0.5)) == "1969-12-31T23:59:59.500Z");
+
+  // milliseconds survive round-trip
+  std::mt19937 rng(4545);
+  std::uniform_int_distribution<int64_t> dist(0, 4102444800000LL);
+  for(int ii = 0; ii < 20000; ++ii) {
+    int64_t ms = dist(rng);
+    double t = parseGpxTime(formatGpxTime(buf, ms/1000.0));
+    REQUIRE(int64_t(std::floor(t*1000 + 0.5)) == ms);
+  }
+}
+
+TEST_CASE("GPX time timezone offsets", "[GpxTime]")
+{
+  double utc = parseGpxTime("2023-03-31T20:19:15Z");
+  REQUIRE(parseGpxTime("2023-03-31T20:19:15") == utc);
+  REQUIRE(parseGpxTime("2023-03-31t20:19:15z") == utc);
+  REQUIRE(parseGpxTime("2023-03-31 20:19:15Z") == utc);
+  REQUIRE(parseGpxTime("  2023-03-31T20:19:15Z") == utc);
+  REQUIRE(parseGpxTime("2023-03-31T13:19:15-07:00") == utc);
+  REQUIRE(parseGpxTime("2023-03-31T13:19:15-0700") == utc);
+  REQUIRE(parseGpxTime("2023-03-31T13:19:15-07") == utc);
+  REQUIRE(parseGpxTime("2023-04-01T01:49:15+05:30") == utc);
+  REQUIRE(parseGpxTime("2023-04-01T01:49:15+0530") == utc);
+  REQUIRE(parseGpxTime("2023-03-31T20:19:15+00:00") == utc);
+  REQUIRE(parseGpxTime("2023-03-31T13:19:15.250-07:00") == Approx(utc + 0.25).epsilon(1E-12));
+  // offset crossing year boundary
+  REQUIRE(parseGpxTime("2024-01-01T08:00:00+09:00") == parseGpxTime("2023-12-31T23:00:00Z"));
+  // largest offsets in use
+  REQUIRE(parseGpxTime("2023-04-01T10:19:15+14:00") == utc);
+  REQUIRE(parseGpxTime("2023-03-31T06:19:15-14:00") == utc);
+
+  // random offsets agree w/ shifting UTC time
+  std::mt19937 rng(4546);
+  std::uniform_int_distribution<int64_t> dist(0, 4102444800LL);
+  std::uniform_int_distribution<int> tzdist(-14*4, 14*4);  // quarter hours
+  char buf[32], src[48];
+  for(int ii = 0; ii < 5000; ++ii) {
+    int64_t t = dist(rng);
+    int offset = tzdist(rng)*900;
+    formatGpxTime(buf, double(t + offset));
+    buf[19] = '\0';  // drop Z
+    int aoff = std::abs(offset);
+    snprintf(src, sizeof(src), "%s%c%02d:%02d", buf, offset < 0 ? '-' : '+', aoff/3600, (aoff/60)%60);
+    REQUIRE(parseGpxTime(src) == double(t));
+    snprintf(src, sizeof(src), "%s%c%02d%02d", buf, offset < 0 ? '-' : '+', aoff/3600, (aoff/60)%60);
+    REQUIRE(parseGpxTime(src) == double(t));
+  }
+}
+
+TEST_CASE("GPX time malformed input", "[GpxTime]")
+{
+  const char* bad[] = { NULL, "", " ", "Z", "2023", "2023-03", "2023-03-31", "2023-03-31T", "2023-03-31T20:19",
+      "2023-03-31T20:19:", "2023-03-31T20:19:1", "23-03-31T20:19:15Z", "2023/03/31T20:19:15Z",
+      "2023-3-31T20:19:15Z", "2023-03-31X20:19:15Z", "2023-13-31T20:19:15Z", "2023-00-10T20:19:15Z",
+      "2023-03-32T20:19:15Z", "2023-03-00T20:19:15Z", "2023-03-31T25:19:15Z", "2023-03-31T20:60:15Z",
+      "2023-03-31T20:19:61Z", "2023-03-31T20:19:15+", "2023-03-31T20:19:15-7", "2023-03-31T20:19:15+05:3",
+      "2023-03-31T20:19:15+0x:00", "abcd-ef-ghTij:kl:mnZ", "\xff\xfe\xfd\xfc-01-01T00:00:00Z",
+      // day of month, end of day, and offset ranges
+      "2023-04-31T20:19:15Z", "2023-02-29T20:19:15Z", "2024-02-30T20:19:15Z", "2100-02-29T20:19:15Z",
+      "2023-11-31T20:19:15Z", "2023-03-31T24:00:01Z", "2023-03-31T24:01:00Z", "2023-03-31T24:00:00.5Z",
+      "2023-03-31T20:19:15+14:01", "2023-03-31T20:19:15-15:00", "2023-03-31T20:19:15+05:60",
+      "2023-03-31T20:19:15+9999", "2023-03-31T20:19:15-99:99" };
+  for(const char* s : bad)
+    REQUIRE(parseGpxTime(s) == 0);
+
+  // valid edge cases
+  REQUIRE(parseGpxTime("2024-02-29T12:00:00Z") == parseGpxTime("2024-03-01T12:00:00Z") - 86400);
+  REQUIRE(parseGpxTime("2000-02-29T12:00:00Z") == parseGpxTime("2000-03-01T12:00:00Z") - 86400);
+  REQUIRE(parseGpxTime("2023-03-31T24:00:00Z") == parseGpxTime("2023-04-01T00:00:00Z"));
+  REQUIRE(parseGpxTime("2023-04-30T20:19:15Z") != 0);
+
+  // every truncation of a valid time before end of seconds is invalid
+  const char* full = "2023-03-31T13:19:15.250-07:00";
+  for(size_t n = 0; n < 19; ++n)
+    REQUIRE(parseGpxTime(std::string(full, n).c_str()) == 0);
+
+  // random mutations of valid strings and random bytes: must not crash, and any accepted value
+  //  must be finite and within the range of 4 digit years
+  std::mt19937 rng(4547);
+  std::uniform_int_distribution<int> byte(1, 255);
+  const char alphabet[] = "0123456789-+:.,TZtz ";
+  std::uniform_int_distribution<int> achar(0, sizeof(alphabet) - 2);
+  const double tmin = parseGpxTime("0000-01-01T00:00:00+14:00") - 1;
+  const double tmax = parseGpxTime("9999-12-31T23:59:60.999-14:00") + 1;
+  for(int ii = 0; ii < 200000; ++ii) {
+    std::string s(full);
+    int nedits = 1 + ii%4;
+    for(int jj = 0; jj < nedits; ++jj) {
+      size_t pos = rng() % (s.size() + 1);
+      int op = rng() % 3;
+      char c = ii%2 ? char(byte(rng)) : alphabet[achar(rng)];
+      if(op == 0 && pos < s.size()) { s[pos] = c; }
+      else if(op == 1) { s.insert(s.begin() + pos, c); }
+      else if(pos < s.size()) { s.erase(pos, 1); }
+    }
+    if(ii%8 == 0) {
+      s.resize(rng() % 40);
+      for(char& c : s) { c = char(byte(rng)); }
+    }
+    double t = parseGpxTime(s.c_str());
+    REQUIRE(std::isfinite(t));
+    REQUIRE(t >= tmin);
+    REQUIRE(t <= tmax);
+  }
+}
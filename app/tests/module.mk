@@ -0,0 +1,26 @@
+## app tests - GUI-free app sources, run with tangram-es tests (tests.mk), which provide Catch main and platform
+MODULE_BASE := .
+
+MODULE_SOURCES = \
+  app/tests/appstubs.cpp        \
+  app/tests/trackstatstests.cpp \
+  app/tests/gpxtimetests.cpp    \
+  app/src/gpxfile.cpp           \
+  app/src/util.cpp              \
+  $(STYLUSLABS_DEPS)/ulib/geom.cpp           \
+  $(STYLUSLABS_DEPS)/ulib/image.cpp          \
+  $(STYLUSLABS_DEPS)/ulib/path2d.cpp         \
+  $(STYLUSLABS_DEPS)/ulib/painter.cpp        \
+  $(STYLUSLABS_DEPS)/usvg/svgnode.cpp        \
+  $(STYLUSLABS_DEPS)/usvg/svgstyleparser.cpp \
+  $(STYLUSLABS_DEPS)/usvg/svgparser.cpp      \
+  $(STYLUSLABS_DEPS)/usvg/svgpainter.cpp     \
+  $(STYLUSLABS_DEPS)/usvg/svgwriter.cpp      \
+  $(STYLUSLABS_DEPS)/usvg/cssparser.cpp      \
+  $(STYLUSLABS_DEPS)/nanovgXC/src/nanovg.c   \
+  $(STYLUSLABS_DEPS)/pugixml/src/pugixml.cpp
+
+MODULE_INC_PRIVATE = $(STYLUSLABS_DEPS) $(STYLUSLABS_DEPS)/nanovgXC/src $(STYLUSLABS_DEPS)/pugixml/src app/src app/include tangram-es/tests/catch
+MODULE_DEFS_PRIVATE = PUGIXML_NO_XPATH PUGIXML_NO_EXCEPTIONS SVGGUI_NO_SDL
+
+include $(ADD_MODULE)
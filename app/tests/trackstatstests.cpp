@@ -0,0 +1,111 @@
+#include "catch.hpp"
+#include "gpxfile.h"
+#include <random>
+
+// incremental TrackStats must give same results as processing all points w/ a fresh TrackStats
+
+static Waypoint randomPoint(std::mt19937& rng, const Waypoint* prev)
+{
+  std::uniform_real_distribution<double> u(0, 1);
+  Location loc = prev ? prev->loc : Location{1.6E9, 45, -122, 5, 100, 5, 0, 0, 0, 0};
+  loc.time += 0.5 + 2*u(rng);
+  loc.lat += (u(rng) - 0.4)*1E-4;
+  loc.lng += (u(rng) - 0.4)*1E-4;
+  loc.alt += (u(rng) - 0.5)*10;
+  loc.poserr = float(2 + 20*u(rng));
+  loc.alterr = float(u(rng) < 0.2 ? 0 : 3 + 10*u(rng));
+  loc.spd = float(u(rng)*3);
+  return Waypoint(loc);
+}
+
+static void checkStats(TrackStats& stats, std::vector<Waypoint>& pts, bool isTrack, bool hasSpeed)
+{
+  stats.update(pts, isTrack, hasSpeed, 0.2);
+  std::vector<Waypoint> copy(pts);
+  TrackStats fresh;
+  fresh.update(copy, isTrack, hasSpeed, 0.2);
+  const TrackStats::State& a = stats.res;
+  const TrackStats::State& b = fresh.res;
+  REQUIRE(a.next == b.next);
+  REQUIRE(a.trackDist == b.trackDist);
+  REQUIRE(a.rawDist == b.rawDist);
+  REQUIRE(a.movingTime == b.movingTime);
+  REQUIRE(a.movingTimeGps == b.movingTimeGps);
+  REQUIRE(a.trackAscent == b.trackAscent);
+  REQUIRE(a.trackDescent == b.trackDescent);
+  REQUIRE(a.ascentTime == b.ascentTime);
+  REQUIRE(a.descentTime == b.descentTime);
+  REQUIRE(a.maxSpeed == b.maxSpeed);
+  for(size_t ii = 0; ii < pts.size(); ++ii) {
+    REQUIRE(pts[ii].dist == copy[ii].dist);
+    REQUIRE(pts[ii].loc.spd == copy[ii].loc.spd);
+  }
+}
+
+static void randomEdits(unsigned int seed, bool isTrack, bool hasSpeed)
+{
+  std::mt19937 rng(seed);
+  std::vector<Waypoint> pts;
+  TrackStats stats;
+  checkStats(stats, pts, isTrack, hasSpeed);
+  for(int op = 0; op < 150; ++op) {
+    int kind = rng() % 10;
+    size_t n = pts.size();
+    if(kind < 5 || n < 4) {
+      // append (as when recording); sometimes one point, sometimes past a checkpoint boundary
+      size_t nadd = rng() % 3 == 0 ? 1 + rng() % 600 : 1;
+      for(size_t ii = 0; ii < nadd; ++ii)
+        pts.push_back(randomPoint(rng, pts.empty() ? NULL : &pts.back()));
+    }
+    else if(kind < 7) {
+      // edit points from idx to end (e.g. drag waypoint, reverse)
+      size_t idx = rng() % n;
+      for(size_t ii = idx; ii < n && ii < idx + 1 + rng() % 3; ++ii)
+        pts[ii].loc.alt += 50;
+      stats.invalidate(idx);
+    }
+    else if(kind < 8) {
+      // insert points in the middle
+      size_t idx = 1 + rng() % (n - 1);
+      Waypoint wpt = randomPoint(rng, &pts[idx-1]);
+      wpt.loc.time = (pts[idx-1].loc.time + pts[idx].loc.time)/2;  // keep times increasing
+      pts.insert(pts.begin() + idx, wpt);
+      stats.invalidate(idx);
+    }
+    else {
+      // crop end, w/ or w/o invalidate() - removal must be detected either way
+      size_t newsize = 1 + rng() % (n - 1);
+      pts.erase(pts.begin() + newsize, pts.end());
+      if(kind == 8)
+        stats.invalidate(newsize);
+    }
+    checkStats(stats, pts, isTrack, hasSpeed);
+  }
+}
+
+TEST_CASE("TrackStats incremental update matches full recompute", "[TrackStats]")
+{
+  for(unsigned int seed = 1; seed <= 8; ++seed) {
+    randomEdits(seed, true, false);
+    randomEdits(seed, true, true);
+    randomEdits(seed, false, false);
+  }
+}
+
+TEST_CASE("TrackStats unchanged points are not reprocessed", "[TrackStats]")
+{
+  std::mt19937 rng(99);
+  std::vector<Waypoint> pts;
+  for(int ii = 0; ii < 1000; ++ii)
+    pts.push_back(randomPoint(rng, pts.empty() ? NULL : &pts.back()));
+  TrackStats stats;
+  stats.update(pts, true, false, 0.2);
+  double dist = stats.res.trackDist;
+  // changing a point w/o invalidate() is only detected for last point, so stale result shows update was skipped
+  pts[500].loc.lat += 1;
+  stats.update(pts, true, false, 0.2);
+  REQUIRE(stats.res.trackDist == dist);
+  stats.invalidate(500);
+  stats.update(pts, true, false, 0.2);
+  REQUIRE(stats.res.trackDist > dist);
+}
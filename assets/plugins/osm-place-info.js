@@ -24,6 +24,8 @@ function getPlaceType(_props)
   }
   return type;
 }
+// app uses an equivalent native implementation unless getPlaceType is redefined by another plugin
+getPlaceType.nativeRules = true;
 
 // from https://github.com/osmlab/jsopeninghours
 // - see https://wiki.openstreetmap.org/wiki/Key:opening_hours for more sophisticated (and far more complex) parsers
@@ -0,0 +1,26 @@
+# Linux makefile for Ascend Maps benchmarks - `make -f bench.mk run BENCH="search --sizes=100k,1M"`
+# - no GPU or network needed; data is generated in $BENCH_TMPDIR (default /tmp/ascend-bench)
+
+TARGET ?= bench.out
+DEBUG ?= 0
+BUILDDIR ?= build/Bench
+
+include make/shared.mk
+
+DEFS += LOG_LEVEL=2
+
+## modules
+include tangram-es/core/module.mk
+include app/bench/module.mk
+
+LIBS = -pthread -lOpenGL -lGLX -lfontconfig -lcurl -ldl
+DEFS += TANGRAM_LINUX
+
+include make/unix.mk
+
+.DEFAULT_GOAL := run
+
+.PHONY: run
+
+run: all
+	$(BUILDDIR)/$(TARGET) $(BENCH)
@@ -11,7 +11,9 @@ MODULE_SOURCES = \
   app/src/touchhandler.cpp \
   app/src/tracks.cpp       \
   app/src/trackwidgets.cpp \
+  app/src/plotseries.cpp   \
   app/src/gpxfile.cpp      \
+  app/src/searchdb.cpp     \
   app/src/util.cpp         \
   app/src/plugins.cpp      \
   app/src/mapwidgets.cpp   \
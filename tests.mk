@@ -11,6 +11,7 @@ DEFS += LOG_LEVEL=3
 ## modules
 include tangram-es/core/module.mk
 include tangram-es/tests/module.mk
+include app/tests/module.mk
 
 LIBS = -pthread -lOpenGL -lfontconfig -lcurl
 DEFS += TANGRAM_LINUX